@@ -0,0 +1,45 @@
+#pragma once
+
+#include "cinder/Cinder.h"
+
+#include <chrono>
+#include <string>
+
+namespace videodromm
+{
+	// stores the pointer to the VDBenchmark instance
+	typedef std::shared_ptr<class VDBenchmark> VDBenchmarkRef;
+
+	// Throughput run over a fixed number of frames, for the headless mode.
+	// Frames are timed with a monotonic clock, per-stage timings come from VDProfiler;
+	// frames before start() and the first warmup frames after it are not counted
+	// (shader compiles, first allocations).
+	class VDBenchmark {
+	public:
+		VDBenchmark(int frames, int warmup);
+		static VDBenchmarkRef	create(int frames, int warmup = 30) { return std::make_shared<VDBenchmark>(frames, warmup); }
+
+		// once the pipeline is ready to run at full speed
+		void			start();
+		bool			isRunning() const { return mRunning; }
+		void			beginFrame();
+		void			endFrame();
+		// past the warmup and not done yet
+		bool			isMeasuring() const { return mRunning && mWarmed >= mWarmup && !isDone(); }
+		bool			isDone() const { return mMeasured >= mFrames; }
+		int				getMeasuredFrames() const { return mMeasured; }
+
+		double			getSeconds() const;
+		double			getFps() const;
+		// frame time (mean, min, max in ms) and the totals
+		std::string		report() const;
+	private:
+		typedef std::chrono::steady_clock	Clock;
+
+		int						mFrames, mWarmup;
+		int						mWarmed, mMeasured;
+		bool					mRunning;
+		Clock::time_point		mFrameBegin, mFirstFrame, mLastFrame;
+		double					mFrameMin, mFrameMax;
+	};
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "cinder/Cinder.h"
+#include "cinder/Vector.h"
+#include "cinder/gl/gl.h"
+#include "cinder/gl/Fbo.h"
+#include "cinder/gl/GlslProg.h"
+#include "cinder/gl/Pbo.h"
+
+#include <vector>
+
+#include "VDFramePool.h"
+
+namespace videodromm
+{
+	// stores the pointer to the VDChangeDetector instance
+	typedef std::shared_ptr<class VDChangeDetector> VDChangeDetectorRef;
+
+	// Cheap content signatures, to tell a repeated frame (title card, paused clip) from a
+	// new one. Two frames with the same signature are taken as equal, 0 means unknown.
+	// Pixels: the frame is compared with the last one that got a new signature, one tile
+	// per cell of a grid; the tile moves within its cell every frame, so a change between
+	// this frame's tiles is caught by a later one, and every refresh frames the whole
+	// frame is compared.
+	// Textures: a shader sums every texel of each cell into a tiny float target, copied
+	// into a pixel buffer and hashed whole one frame later, so the GPU is never waited on;
+	// the signature is the previous frame's and a change shows one frame late. Every
+	// refresh frames the signature changes regardless, for sums that happen to match.
+	class VDChangeDetector {
+	public:
+		struct Format {
+			Format() : mTiles(16, 9), mTileSize(16), mSignatureSize(64, 36), mRefresh(30) {}
+
+			//! grid of cells sampled on the pixel path
+			Format&	tiles(const ci::ivec2 &tiles) { mTiles = tiles; return *this; }
+			//! side of the square hashed in each cell, in pixels
+			Format&	tileSize(int32_t size) { mTileSize = size; return *this; }
+			//! reduction target of the texture path
+			Format&	signatureSize(const ci::ivec2 &size) { mSignatureSize = size; return *this; }
+			//! frames between full comparisons, the longest a change can go unnoticed
+			Format&	refresh(int32_t frames) { mRefresh = frames; return *this; }
+
+			ci::ivec2	mTiles;
+			int32_t		mTileSize;
+			ci::ivec2	mSignatureSize;
+			int32_t		mRefresh;
+		};
+
+		VDChangeDetector(const Format &format);
+		static VDChangeDetectorRef	create(const Format &format = Format()) { return std::make_shared<VDChangeDetector>(format); }
+
+		// keeps a reference to the frame while its signature is current
+		uint64_t		signature(const VDFrameHandle &frame);
+		// render thread: the signature of the texture of the previous call, 0 on the first
+		// call and after a size change
+		uint64_t		signature(const ci::gl::Texture2dRef &texture);
+
+		// one tile per cell, placed by phase, of two 4 byte per pixel frames of the same size
+		static bool		equalTiles(const VDFrameBuffer &a, const VDFrameBuffer &b, const ci::ivec2 &tiles, int32_t tileSize, uint32_t phase);
+		static bool		equalFrames(const VDFrameBuffer &a, const VDFrameBuffer &b);
+		static uint64_t	hashBytes(const void *data, size_t bytes, uint64_t seed);
+	private:
+		Format				mFormat;
+		// pixel path: the frame the current signature was issued for
+		VDFrameHandle		mReference;
+		uint64_t			mSignature;
+		uint64_t			mFrames;
+		uint64_t			mTextureFrames;
+		ci::gl::GlslProgRef	mGlsl;
+		ci::gl::FboRef		mTarget;
+		// texture path: sums in flight, written on alternate calls
+		ci::gl::PboRef		mSums[2];
+		uint64_t			mSumsFrame[2];	// mTextureFrames + 1 when written, 0 for never
+		ci::ivec2			mSumsSize[2];	// of the texture summed
+	};
+}
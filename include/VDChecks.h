@@ -0,0 +1,59 @@
+#pragma once
+
+#include "cinder/Cinder.h"
+
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace videodromm
+{
+	// stores the pointer to the VDChecks instance
+	typedef std::shared_ptr<class VDChecks> VDChecksRef;
+
+	// Self checks and microbenchmarks for the headless mode: --check=<name>[,<name>] or
+	// --check=all. A check passes or fails with its measurements in the report, a
+	// benchmark only reports. The CPU checks are registered on creation, the app adds
+	// the ones that need its GL context, shaders or session.
+	class VDChecks {
+	public:
+		struct Result {
+			Result() : passed(true) {}
+			// fails the check, every reason is kept in the report
+			void		fail(const std::string &reason) { passed = false; report += "FAIL " + reason + "\n"; }
+			void		line(const std::string &text) { report += text + "\n"; }
+
+			bool		passed;
+			std::string	report;
+		};
+		typedef std::function<Result()> Check;
+
+		VDChecks();
+		static VDChecksRef	create() { return std::make_shared<VDChecks>(); }
+
+		void				add(const std::string &name, const Check &check);
+		// the named checks in registration order, "all" for every one; an unknown name
+		// counts as a failure. Returns the failures, report gets every check's lines
+		int					run(const std::vector<std::string> &names, std::string &report) const;
+		std::vector<std::string>	getNames() const;
+
+		// output worker on a slow VDMockSink: push never blocks, the queue stays bounded,
+		// every frame is sent or counted as dropped, drop-oldest delivers the newest
+		static Result		ndiQueue();
+		// adaptive output on a sink slower than the frame budget: the stream degrades,
+		// and metadata pushed on skipped frames still reaches the sink
+		static Result		ndiAdaptive();
+		// metadata channel per frame cost with unchanged and with changing fields, next to
+		// the per-frame XmlTree it replaced; an unchanged frame must not rebuild or send
+		static Result		metadataBench();
+		// uniform store with 1k to 100k parameters, a quarter animated every frame: batch
+		// set and the walk over the changed runs, which must visit exactly those slots
+		static Result		uniformStoreBench();
+		// recording codec on the load generator patterns at 1080p: ratio, encode and decode
+		// MB/s on the worker pool, and every frame must decode to the input
+		static Result		codecBench();
+	private:
+		std::vector<std::pair<std::string, Check>>	mChecks;
+	};
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "VDFramePool.h"
+#include "VDWorkerPool.h"
+
+namespace videodromm
+{
+	// CPU version of the post.glsl effects, for frames that arrive as pixels
+	// (Spout memory or CPU share, synthetic input) so they are processed before upload
+	// instead of uploaded, shaded and read back.
+	// Same uniforms and order as the shader, per output pixel:
+	//   chromatic	red from x + d, blue from x - d, d = iChromatic * CHROMATIC_SCALE * width
+	//   sobel		mix(color, |sobel(luma)|, iSobel), 3x3 on the input luma (Rec.601 weights)
+	//   exposure	color * iExposure
+	// SSE2 for the channel shifts and the mix/exposure, row bands on the worker pool.
+	class VDCpuEffects {
+	public:
+		struct Params {
+			Params() : exposure(1.0f), sobel(0.0f), chromatic(0.0f) {}
+			Params(float exposure, float sobel, float chromatic) : exposure(exposure), sobel(sobel), chromatic(chromatic) {}
+			float	exposure;	// iExposure
+			float	sobel;		// iSobel
+			float	chromatic;	// iChromatic
+		};
+
+		// src and dst must have the same size, BGRA
+		static void		process(const VDFrameBuffer &src, VDFrameBuffer &dst, const Params &params, VDWorkerPool *workers = nullptr);
+		// channel offset in pixels for a frame width
+		static int32_t	chromaticShift(float chromatic, int32_t width);
+
+		static const float		CHROMATIC_SCALE;
+		// below this many pixels the frame is processed on the calling thread
+		static const int32_t	PARALLEL_THRESHOLD = 640 * 360;
+	private:
+		static void		processRows(const VDFrameBuffer &src, VDFrameBuffer &dst, const Params &params, int32_t y0, int32_t y1);
+	};
+}
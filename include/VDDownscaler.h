@@ -0,0 +1,25 @@
+#pragma once
+
+#include "VDFramePool.h"
+#include "VDWorkerPool.h"
+
+namespace videodromm
+{
+	// CPU downscaling of BGRA frame buffers for the proxy outputs.
+	// Integer ratios use a box filter (SSE2 for 2:1), anything else is bilinear.
+	// Large frames are split into row bands on the worker pool.
+	class VDDownscaler {
+	public:
+		// dst size is taken from dst, both buffers must be 4 bytes per pixel
+		static void		downscale(const VDFrameBuffer &src, VDFrameBuffer &dst, VDWorkerPool *workers = nullptr);
+		// size of a scaled output, never below 1x1
+		static int32_t	scaledSize(int32_t size, float scale);
+
+		// below this many source pixels the frame is scaled on the calling thread
+		static const int32_t	PARALLEL_THRESHOLD = 1280 * 720;
+	private:
+		static void		box2x(const VDFrameBuffer &src, VDFrameBuffer &dst, int32_t y0, int32_t y1);
+		static void		boxN(const VDFrameBuffer &src, VDFrameBuffer &dst, int32_t factor, int32_t y0, int32_t y1);
+		static void		bilinear(const VDFrameBuffer &src, VDFrameBuffer &dst, int32_t y0, int32_t y1);
+	};
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <vector>
+
+namespace videodromm
+{
+	// stores the pointer to the VDFramePacer instance
+	typedef std::shared_ptr<class VDFramePacer> VDFramePacerRef;
+
+	// Paces the render loop to an output rate of its own instead of the display's.
+	// Each frame has a deadline on a fixed grid; the loop sleeps until the predicted
+	// work (receive, shader, readback, push, from recent history) would just finish
+	// by it, so the frame received is as fresh as possible. A slot that can no longer
+	// be met is skipped rather than produced late and queued behind the next one.
+	class VDFramePacer {
+	public:
+		struct Format {
+			Format() : mRate(60.0), mHistory(32), mMarginMs(1.0) {}
+
+			//! output frames per second
+			Format&	rate(double fps) { mRate = fps; return *this; }
+			//! frames of work duration the prediction is taken from
+			Format&	history(int frames) { mHistory = frames; return *this; }
+			//! added to the prediction, absorbs wake-up latency
+			Format&	margin(double ms) { mMarginMs = ms; return *this; }
+
+			double	mRate;
+			int		mHistory;
+			double	mMarginMs;
+		};
+
+		VDFramePacer(const Format &format);
+		static VDFramePacerRef	create(const Format &format = Format()) { return std::make_shared<VDFramePacer>(format); }
+
+		// blocks until the next frame should start, returns the slots skipped to get there
+		int				waitForSlot();
+		// the frame is out: records its duration and how far from the deadline it landed
+		void			frameDone();
+
+		double			getRate() const { return mFormat.mRate; }
+		double			getPredictedMs() const { return mPredictedMs; }
+		// over the history window: deviation of frame intervals from the period
+		double			getJitterMs() const;
+		// over the history window: completion relative to the deadline, negative is early
+		double			getMeanLatenessMs() const;
+		double			getMaxLatenessMs() const;
+		uint64_t		getFrameCount() const { return mFrames; }
+		uint64_t		getSkippedCount() const { return mSkipped; }
+	private:
+		typedef std::chrono::steady_clock	Clock;
+
+		void			predict();
+		void			sleepUntil(Clock::time_point time) const;
+
+		Format					mFormat;
+		Clock::duration			mPeriod;
+		Clock::time_point		mDeadline, mWorkBegin, mLastDone;
+		bool					mStarted;
+		// rings of the last mHistory frames, in ms
+		std::vector<double>		mDurations, mLateness, mIntervalErrors;
+		size_t					mNext, mCount;
+		double					mPredictedMs;
+		uint64_t				mFrames, mSkipped;
+	};
+}
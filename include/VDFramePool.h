@@ -0,0 +1,125 @@
+#pragma once
+
+#include "cinder/Cinder.h"
+#include "cinder/Surface.h"
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+namespace videodromm
+{
+	class VDFramePool;
+
+	// Pixel buffer owned by a VDFramePool.
+	// Data and rows are 64-byte aligned; rowBytes may be larger than width * 4.
+	// Refcounted through VDFrameHandle, returns to the pool when the last handle goes away.
+	class VDFrameBuffer {
+	public:
+		uint8_t*					getData() { return mData; }
+		const uint8_t*				getData() const { return mData; }
+		int32_t						getWidth() const { return mWidth; }
+		int32_t						getHeight() const { return mHeight; }
+		ptrdiff_t					getRowBytes() const { return mRowBytes; }
+		size_t						getDataSize() const { return mDataSize; }
+		ci::SurfaceChannelOrder		getChannelOrder() const { return mChannelOrder; }
+		// non-owning view on the pixels, created once with the buffer
+		ci::Surface&				getSurface() { return mSurface; }
+		// in-place row swap, for bottom-up GL readbacks
+		void						flipVertical();
+	private:
+		friend class VDFramePool;
+		friend class VDFrameHandle;
+		struct Shared;
+
+		VDFrameBuffer(const std::shared_ptr<Shared> &shared, int32_t width, int32_t height, ci::SurfaceChannelOrder channelOrder);
+		~VDFrameBuffer();
+
+		void						addRef() { mRefCount.fetch_add(1, std::memory_order_relaxed); }
+		void						release();
+
+		std::shared_ptr<Shared>		mShared;
+		std::atomic<int>			mRefCount;
+		uint8_t*					mData;
+		int32_t						mWidth, mHeight;
+		ptrdiff_t					mRowBytes;
+		size_t						mDataSize;
+		ci::SurfaceChannelOrder		mChannelOrder;
+		ci::Surface					mSurface;
+		uint64_t					mReleasedAt;	// pool acquires when it went back on the free list
+	};
+
+	// Counted reference to a pooled buffer, cheap to copy between threads
+	class VDFrameHandle {
+	public:
+		VDFrameHandle() : mBuffer(nullptr) {}
+		VDFrameHandle(const VDFrameHandle &other) : mBuffer(other.mBuffer) { if (mBuffer) mBuffer->addRef(); }
+		VDFrameHandle(VDFrameHandle &&other) : mBuffer(other.mBuffer) { other.mBuffer = nullptr; }
+		~VDFrameHandle() { reset(); }
+
+		VDFrameHandle& operator=(const VDFrameHandle &other) {
+			if (other.mBuffer) other.mBuffer->addRef();
+			reset();
+			mBuffer = other.mBuffer;
+			return *this;
+		}
+		VDFrameHandle& operator=(VDFrameHandle &&other) {
+			if (this != &other) {
+				reset();
+				mBuffer = other.mBuffer;
+				other.mBuffer = nullptr;
+			}
+			return *this;
+		}
+
+		void					reset() { if (mBuffer) { mBuffer->release(); mBuffer = nullptr; } }
+		explicit operator bool() const { return mBuffer != nullptr; }
+		VDFrameBuffer*			operator->() const { return mBuffer; }
+		VDFrameBuffer&			operator*() const { return *mBuffer; }
+		VDFrameBuffer*			get() const { return mBuffer; }
+	private:
+		friend class VDFramePool;
+		// takes over the reference acquired by the pool
+		explicit VDFrameHandle(VDFrameBuffer *buffer) : mBuffer(buffer) {}
+
+		VDFrameBuffer*			mBuffer;
+	};
+
+	// stores the pointer to the VDFramePool instance
+	typedef std::shared_ptr<class VDFramePool> VDFramePoolRef;
+
+	// Recycles frame buffers for the output path (readback, conversion, NDI, recorder).
+	// After warm-up every acquire() is served from the free list, allocations stays flat.
+	// Several sizes can share a pool (program output and proxies); a free buffer is only
+	// deleted once STALE_ACQUIRES acquires went by without it, e.g. after a resize.
+	class VDFramePool {
+	public:
+		struct Stats {
+			Stats() : allocations(0), allocatedBytes(0), acquires(0), reuses(0), inUse(0), peakInUse(0) {}
+			uint64_t	allocations;	// buffers created since start
+			uint64_t	allocatedBytes;	// bytes currently held by the pool, free or in use
+			uint64_t	acquires;
+			uint64_t	reuses;			// acquires served without allocating
+			uint32_t	inUse;
+			uint32_t	peakInUse;
+		};
+
+		VDFramePool(const std::string &name);
+		~VDFramePool();
+		static VDFramePoolRef	create(const std::string &name) { return std::make_shared<VDFramePool>(name); }
+
+		// thread safe; reuses a free buffer of the same size and channel order
+		VDFrameHandle			acquire(int32_t width, int32_t height, ci::SurfaceChannelOrder channelOrder = ci::SurfaceChannelOrder::BGRA);
+		// releases free buffers, in-use buffers are deleted when their last handle goes away
+		void					trim();
+
+		Stats					getStats() const;
+		const std::string&		getName() const { return mName; }
+
+		static const size_t		ALIGNMENT = 64;
+		static const uint64_t	STALE_ACQUIRES = 240;
+	private:
+		std::string						mName;
+		std::shared_ptr<VDFrameBuffer::Shared>	mShared;
+	};
+}
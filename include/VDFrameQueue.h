@@ -0,0 +1,104 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace videodromm
+{
+	// what to do when the render thread pushes into a full queue
+	enum class VDDropPolicy {
+		DropOldest,	// discard the frame waiting longest, keep the new one (lowest latency)
+		DropNewest	// keep what is queued, discard the new frame
+	};
+
+	// Bounded lock-free frame queue.
+	// One producer (render thread) and one consumer (output worker). Each slot carries
+	// a sequence number so the producer can also pop to drop the oldest frame without
+	// racing the consumer: a slot is only reused once its reader has released it.
+	template<typename T>
+	class VDFrameQueue {
+	public:
+		VDFrameQueue(size_t capacity, VDDropPolicy policy = VDDropPolicy::DropOldest)
+			: mSlots(capacity < 1 ? 1 : capacity)
+			, mPolicy(policy)
+			, mWritePos(0)
+			, mReadPos(0)
+		{
+			for (size_t i = 0; i < mSlots.size(); i++) {
+				mSlots[i].sequence.store(i, std::memory_order_relaxed);
+			}
+		}
+
+		// producer side, returns false if the new frame was dropped
+		// dropped counts every frame discarded by this call (old or new)
+		bool push(T &&item, size_t &dropped) {
+			dropped = 0;
+			if (tryPush(item)) return true;
+			if (mPolicy == VDDropPolicy::DropOldest) {
+				T oldest;
+				if (tryPop(oldest)) dropped++;
+				if (tryPush(item)) return true;
+			}
+			// queue still full (consumer is mid-read) or DropNewest
+			dropped++;
+			return false;
+		}
+		// consumer side (the producer uses it too when dropping the oldest)
+		bool tryPop(T &item) {
+			size_t pos = mReadPos.load(std::memory_order_relaxed);
+			for (;;) {
+				Slot &slot = mSlots[pos % mSlots.size()];
+				size_t seq = slot.sequence.load(std::memory_order_acquire);
+				std::ptrdiff_t diff = (std::ptrdiff_t)seq - (std::ptrdiff_t)(pos + 1);
+				if (diff == 0) {
+					if (mReadPos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+						item = std::move(slot.item);
+						slot.item = T();
+						slot.sequence.store(pos + mSlots.size(), std::memory_order_release);
+						return true;
+					}
+				}
+				else if (diff < 0) {
+					return false; // empty
+				}
+				else {
+					pos = mReadPos.load(std::memory_order_relaxed);
+				}
+			}
+		}
+
+		size_t			size() const {
+			size_t w = mWritePos.load(std::memory_order_acquire);
+			size_t r = mReadPos.load(std::memory_order_acquire);
+			return w > r ? w - r : 0;
+		}
+		size_t			capacity() const { return mSlots.size(); }
+		bool			empty() const { return size() == 0; }
+		VDDropPolicy	getDropPolicy() const { return mPolicy; }
+		void			setDropPolicy(VDDropPolicy policy) { mPolicy = policy; }
+	private:
+		struct Slot {
+			Slot() : sequence(0) {}
+			std::atomic<size_t>	sequence;
+			T					item;
+		};
+
+		bool tryPush(T &item) {
+			size_t pos = mWritePos.load(std::memory_order_relaxed);
+			Slot &slot = mSlots[pos % mSlots.size()];
+			size_t seq = slot.sequence.load(std::memory_order_acquire);
+			if (seq != pos) return false; // full, or the slot is still being read
+			slot.item = std::move(item);
+			slot.sequence.store(pos + 1, std::memory_order_release);
+			mWritePos.store(pos + 1, std::memory_order_release);
+			return true;
+		}
+
+		std::vector<Slot>		mSlots;
+		VDDropPolicy			mPolicy;
+		std::atomic<size_t>		mWritePos;
+		std::atomic<size_t>		mReadPos;
+	};
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "cinder/Cinder.h"
+#include "cinder/Surface.h"
+#include "cinder/Xml.h"
+
+#include <atomic>
+#include <string>
+
+// ndi
+#include "CinderNDISender.h"
+
+namespace videodromm
+{
+	// stores the pointer to the VDFrameSink instance
+	typedef std::shared_ptr<class VDFrameSink> VDFrameSinkRef;
+
+	// Destination of the output worker, called on the worker thread only
+	class VDFrameSink {
+	public:
+		virtual ~VDFrameSink() {}
+		virtual void		sendSurface(ci::Surface &surface, long long timecode) = 0;
+		virtual void		sendMetadata(const ci::XmlTree &metadata, long long timecode) = 0;
+		virtual std::string	getName() const = 0;
+	};
+
+	// NDI sender, owned by the output worker
+	typedef std::shared_ptr<class VDNDISink> VDNDISinkRef;
+
+	class VDNDISink : public VDFrameSink {
+	public:
+		VDNDISink(const std::string &name);
+		static VDNDISinkRef create(const std::string &name) { return std::make_shared<VDNDISink>(name); }
+
+		void		sendSurface(ci::Surface &surface, long long timecode) override;
+		void		sendMetadata(const ci::XmlTree &metadata, long long timecode) override;
+		std::string	getName() const override { return mName; }
+	private:
+		std::string			mName;
+		CinderNDISender		mNDISender;
+	};
+
+	// Stand-in for the NDI sender: blocks for a configurable time per frame
+	// to simulate a slow network or receiver
+	typedef std::shared_ptr<class VDMockSink> VDMockSinkRef;
+
+	class VDMockSink : public VDFrameSink {
+	public:
+		VDMockSink(const std::string &name, int delayMs);
+		static VDMockSinkRef create(const std::string &name, int delayMs = 0) { return std::make_shared<VDMockSink>(name, delayMs); }
+
+		void		sendSurface(ci::Surface &surface, long long timecode) override;
+		void		sendMetadata(const ci::XmlTree &metadata, long long timecode) override;
+		std::string	getName() const override { return mName; }
+
+		void		setDelay(int delayMs) { mDelayMs = delayMs; }
+		int			getDelay() const { return mDelayMs; }
+		uint64_t	getFramesReceived() const { return mFramesReceived; }
+		uint64_t	getMetadataReceived() const { return mMetadataReceived; }
+		long long	getLastTimecode() const { return mLastTimecode; }
+		//! timecode of the frame the last metadata came with
+		long long	getLastMetadataTimecode() const { return mLastMetadataTimecode; }
+	private:
+		std::string				mName;
+		std::atomic<int>		mDelayMs;
+		std::atomic<uint64_t>	mFramesReceived;
+		std::atomic<uint64_t>	mMetadataReceived;
+		std::atomic<long long>	mLastTimecode;
+		std::atomic<long long>	mLastMetadataTimecode;
+	};
+}
@@ -0,0 +1,148 @@
+#pragma once
+
+#include "cinder/Cinder.h"
+#include "cinder/Filesystem.h"
+#include "cinder/gl/gl.h"
+#include "cinder/gl/Fbo.h"
+#include "cinder/gl/Texture.h"
+
+#include <string>
+#include <vector>
+
+#include "VDFramePool.h"
+#include "VDFrameStamp.h"
+#include "VDSharedFrame.h"
+
+// Spout
+#include "CiSpoutIn.h"
+
+namespace videodromm
+{
+	// stores the pointer to the VDFrameSource instance
+	typedef std::shared_ptr<class VDFrameSource> VDFrameSourceRef;
+
+	// Where the render thread gets its input frames, called on the render thread only
+	class VDFrameSource {
+	public:
+		virtual ~VDFrameSource() {}
+		// the current frame, null while nothing is received
+		virtual ci::gl::Texture2dRef	receive() = 0;
+		virtual std::string				getName() const = 0;
+		// interactive sender selection, where the source has one
+		virtual void					select() {}
+		// frames arrive as pixels, receivePixels() gets them without a texture upload
+		virtual bool					hasPixels() const { return false; }
+		// the current frame as BGRA, empty while nothing is received
+		virtual VDFrameHandle			receivePixels(VDFramePool &pool) { return VDFrameHandle(); }
+		// look for VDFrameStamps in the frames, for sources where that costs something
+		virtual void					setReadStamps(bool read) {}
+		// the sender's stamp of the frame last received, false when it carries none
+		virtual bool					getStamp(VDFrameStamp &stamp) const { return false; }
+	};
+
+	// Live Spout receiver.
+	// Senders that fall back to memory or CPU share hand over pixels, receivePixels()
+	// reads those without going through a texture.
+	// Stamps are decoded from the pixel block; for texture frames that takes a small
+	// synchronous read of the block's rows, so it is off unless asked for.
+	typedef std::shared_ptr<class VDSpoutSource> VDSpoutSourceRef;
+
+	class VDSpoutSource : public VDFrameSource {
+	public:
+		VDSpoutSource() : mPixels(false), mReadStamps(false), mHasStamp(false) {}
+		static VDSpoutSourceRef create() { return std::make_shared<VDSpoutSource>(); }
+
+		ci::gl::Texture2dRef	receive() override;
+		std::string				getName() const override { return mSpoutIn.getSenderName(); }
+		// SpoutPanel.exe must be in the executable path
+		void					select() override { mSpoutIn.getSpoutReceiver().SelectSenderPanel(); }
+		// known once a sender is connected
+		bool					hasPixels() const override { return mPixels; }
+		VDFrameHandle			receivePixels(VDFramePool &pool) override;
+		void					setReadStamps(bool read) override { mReadStamps = read; }
+		bool					getStamp(VDFrameStamp &stamp) const override { stamp = mStamp; return mHasStamp; }
+	private:
+		// memory share or cpu mode, re-read after every receive as the sender may change
+		void					updateMode();
+		// the block from the texture's top and bottom rows
+		void					readStamp(const ci::gl::Texture2dRef &texture);
+
+		SpoutIn					mSpoutIn;
+		bool					mPixels;
+		// frames whose rows do not match the pool's row pitch
+		std::vector<uint8_t>	mScratch;
+		bool					mReadStamps;
+		bool					mHasStamp;
+		VDFrameStamp			mStamp;
+		ci::gl::FboRef			mStampFbo;
+	};
+
+	// Portable shared memory sender (VDSharedFrameWriter, e.g. VDLoadGenerator) by name.
+	// Pixels like a memory share sender; the stamp comes from the segment header, with
+	// the writer's frame number as sequence.
+	typedef std::shared_ptr<class VDSharedFrameSource> VDSharedFrameSourceRef;
+
+	class VDSharedFrameSource : public VDFrameSource {
+	public:
+		VDSharedFrameSource(const std::string &name) : mName(name), mTextureFrame(0) {}
+		static VDSharedFrameSourceRef create(const std::string &name) { return std::make_shared<VDSharedFrameSource>(name); }
+
+		ci::gl::Texture2dRef	receive() override;
+		std::string				getName() const override { return mName; }
+		bool					hasPixels() const override { return true; }
+		VDFrameHandle			receivePixels(VDFramePool &pool) override;
+		bool					getStamp(VDFrameStamp &stamp) const override { stamp = mStamp; return mStamp.isValid(); }
+	private:
+		// opens the segment once the writer has created it
+		bool					connect();
+
+		std::string				mName;
+		VDSharedFrameReader		mReader;
+		// the last frame read, handed out again until the writer publishes the next
+		VDFrameHandle			mFrame;
+		VDFramePoolRef			mTexturePool;	// receive() without a caller's pool
+		ci::gl::Texture2dRef	mTexture;
+		uint64_t				mTextureFrame;
+		VDFrameStamp			mStamp;
+	};
+
+	// Generated test pattern, a moving bar over a gradient with the frame number in it.
+	// Frames are prepared once and cycled, so receive() costs nothing and benchmarks
+	// measure the pipeline only.
+	// With pixels the frames are kept in memory instead, like a memory share sender:
+	// receivePixels() copies one out, receive() uploads it.
+	typedef std::shared_ptr<class VDSyntheticSource> VDSyntheticSourceRef;
+
+	class VDSyntheticSource : public VDFrameSource {
+	public:
+		VDSyntheticSource(const ci::ivec2 &size, int frameCount, bool pixels);
+		static VDSyntheticSourceRef create(const ci::ivec2 &size, int frameCount = 60, bool pixels = false) { return std::make_shared<VDSyntheticSource>(size, frameCount, pixels); }
+
+		ci::gl::Texture2dRef	receive() override;
+		std::string				getName() const override { return "synthetic"; }
+		bool					hasPixels() const override { return !mSurfaces.empty(); }
+		VDFrameHandle			receivePixels(VDFramePool &pool) override;
+	private:
+		std::vector<ci::gl::Texture2dRef>	mFrames;
+		std::vector<ci::Surface8u>			mSurfaces;
+		ci::gl::Texture2dRef				mTexture;
+		size_t								mIndex;
+	};
+
+	// Recorded frames: the images of a folder in name order, loaded up front and looped
+	typedef std::shared_ptr<class VDImageSequenceSource> VDImageSequenceSourceRef;
+
+	class VDImageSequenceSource : public VDFrameSource {
+	public:
+		VDImageSequenceSource(const ci::fs::path &folder, size_t maxFrames);
+		static VDImageSequenceSourceRef create(const ci::fs::path &folder, size_t maxFrames = 300) { return std::make_shared<VDImageSequenceSource>(folder, maxFrames); }
+
+		ci::gl::Texture2dRef	receive() override;
+		std::string				getName() const override { return mName; }
+		size_t					getFrameCount() const { return mFrames.size(); }
+	private:
+		std::string							mName;
+		std::vector<ci::gl::Texture2dRef>	mFrames;
+		size_t								mIndex;
+	};
+}
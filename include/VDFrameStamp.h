@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace videodromm
+{
+	// Sequence number and send time a sender puts into its frames, so the receiver can
+	// measure latency hop by hop. Memory senders with a header of their own carry it there
+	// (VDSharedFrameHeader); texture senders draw it as a pixel block (write, read).
+	// Times are on the now() clock, which every process on the machine shares.
+	struct VDFrameStamp {
+		VDFrameStamp() : sequence(0), sendNs(0), receiveNs(0) {}
+
+		bool			isValid() const { return sendNs != 0; }
+
+		uint32_t		sequence;
+		int64_t			sendNs;		// by the sender, just before the frame went out
+		int64_t			receiveNs;	// by the receiver, when the sequence first arrived
+
+		// monotonic nanoseconds, QueryPerformanceCounter or CLOCK_MONOTONIC
+		static int64_t	now();
+
+		// block of BLOCK_COLUMNS x BLOCK_ROWS black or white cells of CELL pixels, top left,
+		// into 4 byte pixels: sync byte, sequence, send time, check byte
+		static void		write(uint8_t *pixels, ptrdiff_t rowBytes, int32_t width, int32_t height, uint32_t sequence, int64_t sendNs);
+		// looks top left, then bottom left upside down; false without a valid block
+		static bool		read(const uint8_t *pixels, ptrdiff_t rowBytes, int32_t width, int32_t height, VDFrameStamp &stamp);
+
+		static const int32_t	CELL = 4;
+		static const int32_t	BLOCK_COLUMNS = 28;
+		static const int32_t	BLOCK_ROWS = 4;
+		static const int32_t	BLOCK_WIDTH = BLOCK_COLUMNS * CELL;
+		static const int32_t	BLOCK_HEIGHT = BLOCK_ROWS * CELL;
+	};
+}
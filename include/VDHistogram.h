@@ -0,0 +1,35 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace videodromm
+{
+	// Lock-free duration histogram, safe to add to from any thread.
+	// Log-scale buckets, eight per octave from 1 us to about 4 s, so percentiles are
+	// exact to within 9%. Reads are not a consistent snapshot while writers are busy,
+	// which is fine for monitoring.
+	class VDHistogram {
+	public:
+		VDHistogram() { reset(); }
+
+		void			add(double ms);
+		void			reset();
+
+		uint64_t		getCount() const { return mCount.load(std::memory_order_relaxed); }
+		double			getMeanMs() const;
+		double			getMaxMs() const { return mMaxUs.load(std::memory_order_relaxed) / 1000.0; }
+		// p in [0, 1], 0 without samples
+		double			getPercentileMs(double p) const;
+
+		static const int	BUCKETS = 8 * 22 + 1;
+	private:
+		static int		bucketOf(uint64_t us);
+		static double	bucketMs(int bucket);
+
+		std::atomic<uint32_t>	mBuckets[BUCKETS];
+		std::atomic<uint64_t>	mCount;
+		std::atomic<uint64_t>	mSumUs;
+		std::atomic<uint64_t>	mMaxUs;
+	};
+}
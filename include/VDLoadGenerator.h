@@ -0,0 +1,144 @@
+#pragma once
+
+#include "cinder/Cinder.h"
+#include "cinder/Vector.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "VDHistogram.h"
+
+namespace videodromm
+{
+	enum class VDLoadPattern { Static, Noise, Gradient };
+	// Spout memory share (Windows), or VDSharedFrame segments anywhere
+	enum class VDLoadBackend { Spout, SharedMemory };
+
+	// stores the pointer to the VDLoadGenerator instance
+	typedef std::shared_ptr<class VDLoadGenerator> VDLoadGeneratorRef;
+
+	// Synthetic senders for stress testing the receive path without VJ software.
+	// Every sender runs on its own thread at its own rate and stamps each frame with a
+	// sequence number and its send time (VDFrameStamp pixel block, and the shared memory
+	// header), so a receiver can count the frames it dropped and measure latency.
+	// Senders are named "<prefix>-<index>". They share the Format's size, rate and pattern
+	// unless Format::sender() gives one its own, for mixed resolution and rate loads.
+	class VDLoadGenerator {
+	public:
+		// what one sender sends
+		struct SenderFormat {
+			SenderFormat() : mIndex(-1), mSize(0), mRate(60.0), mPattern(VDLoadPattern::Gradient) {}
+
+			int				mIndex;
+			ci::ivec2		mSize;
+			double			mRate;
+			VDLoadPattern	mPattern;
+		};
+
+		struct Format {
+			Format() : mSenders(1), mSize(1280, 720), mRate(60.0), mPattern(VDLoadPattern::Gradient), mBackend(VDLoadBackend::SharedMemory), mPrefix("vdload") {}
+
+			Format&	senders(int senders) { mSenders = senders; return *this; }
+			Format&	size(const ci::ivec2 &size) { mSize = size; return *this; }
+			//! frames per second, per sender
+			Format&	rate(double rate) { mRate = rate; return *this; }
+			Format&	pattern(VDLoadPattern pattern) { mPattern = pattern; return *this; }
+			Format&	backend(VDLoadBackend backend) { mBackend = backend; return *this; }
+			Format&	prefix(const std::string &prefix) { mPrefix = prefix; return *this; }
+			//! size, rate and pattern of sender index, the others keep the values above
+			Format&	sender(int index, const ci::ivec2 &size, double rate, VDLoadPattern pattern);
+
+			//! the override for index, or the shared values
+			SenderFormat	getSender(int index) const;
+
+			int				mSenders;
+			ci::ivec2		mSize;
+			double			mRate;
+			VDLoadPattern	mPattern;
+			VDLoadBackend	mBackend;
+			std::string		mPrefix;
+			std::vector<SenderFormat>	mOverrides;
+		};
+
+		VDLoadGenerator(const Format &format);
+		~VDLoadGenerator();
+		static VDLoadGeneratorRef create(const Format &format = Format()) { return std::make_shared<VDLoadGenerator>(format); }
+
+		void				stop();
+		const Format&		getFormat() const { return mFormat; }
+		std::string			getSenderName(int index) const { return mFormat.mPrefix + "-" + ci::toString(index); }
+		// senders that could not be created are left out
+		int					getSenderCount() const { return (int)mSenders.size(); }
+		uint64_t			getFramesSent() const;
+		// frames sent after their deadline, the sender could not keep its rate
+		uint64_t			getFramesLate() const;
+
+		static const char*	getPatternName(VDLoadPattern pattern);
+		// false, and pattern unchanged, for an unknown name
+		static bool			parsePattern(const std::string &name, VDLoadPattern &pattern);
+		// the frames of a pattern, BGRA: a gradient with a hue per sender index (static
+		// and gradient), or random pixels seeded by the index (noise)
+		static void			fillPattern(VDLoadPattern pattern, int index, uint8_t *pixels, ptrdiff_t rowBytes, int32_t width, int32_t height);
+		static const char*	getBackendName(VDLoadBackend backend);
+
+		// a generator and a VDLoadProbe for each sender count in turn, measured for seconds
+		// each; one line per count: frames sent and received per second, drops, torn
+		// copies, registry and read cost
+		static std::string	scalingReport(const Format &format, const std::vector<int> &senderCounts, double seconds);
+	private:
+		struct Sender;
+
+		void				run(Sender &sender);
+
+		Format				mFormat;
+		std::atomic<bool>	mRunning;
+		std::vector<std::unique_ptr<Sender>>	mSenders;
+	};
+
+	// stores the pointer to the VDLoadProbe instance
+	typedef std::shared_ptr<class VDLoadProbe> VDLoadProbeRef;
+
+	// Receiver side of a load test: polls every sender of a generator's naming and
+	// checks the stamped sequence numbers.
+	// Registry time is what finding and checking a sender costs per poll (the Spout
+	// sender names map, or opening the shared segment), read time is the pixel copy.
+	class VDLoadProbe {
+	public:
+		struct Stats {
+			Stats() : mFrames(0), mDropped(0), mTorn(0), mBytes(0), mPolls(0), mRegistryNs(0), mReadNs(0) {}
+
+			uint64_t	mFrames;		// new frames received
+			uint64_t	mDropped;		// sequence numbers skipped between them
+			uint64_t	mTorn;			// copies overlapped by a write, or without a valid stamp
+			uint64_t	mBytes;
+			uint64_t	mPolls;			// sender polls, one per sender per poll()
+			uint64_t	mRegistryNs;
+			uint64_t	mReadNs;		// copies that delivered a frame
+		};
+
+		VDLoadProbe(const VDLoadGenerator::Format &format);
+		~VDLoadProbe();
+		static VDLoadProbeRef create(const VDLoadGenerator::Format &format) { return std::make_shared<VDLoadProbe>(format); }
+
+		// one pass over every sender, returns the new frames
+		int					poll();
+		const Stats&		getStats() const { return mStats; }
+		// send to receive, per new frame
+		const VDHistogram&	getLatency() const { return mLatency; }
+		void				resetStats() { mStats = Stats(); mLatency.reset(); }
+	private:
+		struct Receiver;
+
+		VDLoadGenerator::Format	mFormat;
+		std::vector<std::unique_ptr<Receiver>>	mReceivers;
+		std::vector<uint8_t>	mPixels;
+		Stats					mStats;
+		VDHistogram				mLatency;
+	};
+}
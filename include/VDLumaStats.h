@@ -0,0 +1,70 @@
+#pragma once
+
+#include "VDFramePool.h"
+#include "VDWorkerPool.h"
+
+namespace videodromm
+{
+	// Luma statistics of one frame: a 256 bin histogram of Rec.601 luma (the weights
+	// VDCpuEffects uses for its sobel), and mean, min, max and percentiles from it.
+	// compute() samples every rowStep-th row of a BGRA or RGBA buffer, 8 pixels at a
+	// time with SSE2, large frames in row bands on the worker pool.
+	struct VDLumaStats {
+		VDLumaStats() { reset(); }
+
+		void			reset();
+		// luma below which fraction of the samples lie, 0..255
+		int				percentile(float fraction) const;
+
+		uint32_t		histogram[256];
+		uint64_t		samples;
+		float			mean;
+		int				min, max;
+
+		static void		compute(const VDFrameBuffer &frame, VDLumaStats &stats, int32_t rowStep = 2, VDWorkerPool *workers = nullptr);
+
+		// below this many sampled pixels the frame is measured on the calling thread
+		static const int32_t	PARALLEL_THRESHOLD = 640 * 360;
+	private:
+		// into 4 interleaved histograms, so repeated values do not stall on one counter
+		static void		accumulate(const VDFrameBuffer &frame, int32_t y0, int32_t y1, int32_t rowStep, uint32_t (*histograms)[256]);
+	};
+
+	// stores the pointer to the VDExposureController instance
+	typedef std::shared_ptr<class VDExposureController> VDExposureControllerRef;
+
+	// Auto-exposure: moves iExposure so the mean output luma settles at a target.
+	// The correction is multiplicative, in the log domain, with a time constant so cuts
+	// between dark and bright sources fade rather than jump. Inside the tolerance the
+	// exposure is left alone, a settled exposure stops changing (and static frames stay
+	// static, see VDChangeDetector).
+	class VDExposureController {
+	public:
+		struct Format {
+			Format() : mTarget(0.45f), mSeconds(1.0f), mMin(0.25f), mMax(4.0f), mTolerance(0.05f) {}
+
+			//! mean output luma to settle at, 0..1
+			Format&	target(float target) { mTarget = target; return *this; }
+			//! time constant of the correction
+			Format&	seconds(float seconds) { mSeconds = seconds; return *this; }
+			Format&	range(float min, float max) { mMin = min; mMax = max; return *this; }
+			//! relative luma error that is not corrected
+			Format&	tolerance(float tolerance) { mTolerance = tolerance; return *this; }
+
+			float	mTarget;
+			float	mSeconds;
+			float	mMin, mMax;
+			float	mTolerance;
+		};
+
+		VDExposureController(const Format &format);
+		static VDExposureControllerRef	create(const Format &format = Format()) { return std::make_shared<VDExposureController>(format); }
+
+		// the exposure for the next frames, from stats of a frame shaded with exposure,
+		// elapsed seconds after the previous update
+		float			update(const VDLumaStats &stats, float exposure, double elapsed);
+		const Format&	getFormat() const { return mFormat; }
+	private:
+		Format			mFormat;
+	};
+}
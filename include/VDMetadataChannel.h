@@ -0,0 +1,59 @@
+#pragma once
+
+#include "cinder/Cinder.h"
+#include "cinder/Xml.h"
+
+#include <string>
+#include <vector>
+
+namespace videodromm
+{
+	// stores the pointer to the VDMetadataChannel instance
+	typedef std::shared_ptr<class VDMetadataChannel> VDMetadataChannelRef;
+
+	// Structured NDI metadata.
+	// Fields are registered once, setters only compare values; the XmlTree payload is
+	// rebuilt when a field actually changed and is handed out on change or every
+	// keep-alive interval, so unchanged frames carry no metadata at all.
+	class VDMetadataChannel {
+	public:
+		VDMetadataChannel(const std::string &tag, double keepAliveSeconds);
+		static VDMetadataChannelRef	create(const std::string &tag = "ci_meta", double keepAliveSeconds = 1.0) { return std::make_shared<VDMetadataChannel>(tag, keepAliveSeconds); }
+
+		// returns the index to pass to the setters
+		int							addField(const std::string &name);
+		// uniform fields go into <uniform name="..." value="..."/> children
+		int							addUniform(const std::string &name);
+
+		void						set(int index, const std::string &value);
+		void						set(int index, int value);
+		void						set(int index, float value);
+		void						set(int index, bool value) { set(index, value ? 1 : 0); }
+		// text content of the root element, kept for receivers of the old "NN fps VDViz" payload
+		void						setText(const std::string &text);
+
+		// payload to send this frame, or null when nothing is due
+		std::shared_ptr<ci::XmlTree>	poll(double time);
+
+		void						setKeepAlive(double seconds) { mKeepAliveSeconds = seconds; }
+		uint64_t					getRebuildCount() const { return mRebuilds; }
+		uint64_t					getSendCount() const { return mSends; }
+	private:
+		struct Field {
+			std::string		name;
+			bool			uniform;
+			std::string		value;
+		};
+		void						setValue(int index, const char *value);
+
+		std::string						mTag;
+		std::string						mText;
+		std::vector<Field>				mFields;
+		std::shared_ptr<ci::XmlTree>	mPayload;
+		bool							mDirty;
+		double							mKeepAliveSeconds;
+		double							mLastSent;
+		uint64_t						mRebuilds;
+		uint64_t						mSends;
+	};
+}
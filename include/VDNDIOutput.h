@@ -0,0 +1,116 @@
+#pragma once
+
+#include "cinder/Cinder.h"
+#include "cinder/Surface.h"
+#include "cinder/Xml.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "VDFramePool.h"
+#include "VDFrameQueue.h"
+#include "VDFrameSink.h"
+#include "VDOutputController.h"
+#include "VDProfiler.h"
+#include "VDWorkerPool.h"
+
+namespace videodromm
+{
+	// frame handed from the render thread to the output worker
+	struct VDOutputFrame {
+		VDOutputFrame() : timecode(0), receiveNs(0), metadataSerial(0) {}
+		VDFrameHandle					buffer;
+		long long						timecode;
+		int64_t							receiveNs;	// VDFrameStamp::now() at receive, 0 when not measured
+		std::shared_ptr<ci::XmlTree>	metadata;	// optional, sent before the surface
+		uint64_t						metadataSerial;	// a payload already sent is not sent again
+	};
+
+	// stores the pointer to the VDNDIOutput instance
+	typedef std::shared_ptr<class VDNDIOutput> VDNDIOutputRef;
+
+	// Output worker: owns the sink (NDI sender) and sends on its own thread so
+	// encoding and network backpressure never stall draw().
+	// With a scale below 1 the worker downscales the shared readback itself (proxy output).
+	// When adaptive, the stream drops to half rate then half resolution under backpressure.
+	// Metadata is carried forward over skipped and dropped frames until the worker has sent
+	// it, a newer payload replaces one still waiting.
+	class VDNDIOutput {
+	public:
+		struct Format {
+			Format() : mQueueSize(3), mDropPolicy(VDDropPolicy::DropOldest), mScale(1.0f), mAdaptive(false), mProfilerStage(-1), mLatencyStage(-1) {}
+
+			Format&	queueSize(size_t size) { mQueueSize = size; return *this; }
+			Format&	dropPolicy(VDDropPolicy policy) { mDropPolicy = policy; return *this; }
+			//! fraction of the pushed frame size, e.g. 0.5 for a quarter resolution proxy
+			Format&	scale(float scale) { mScale = scale; return *this; }
+			//! threads used to scale large frames, optional
+			Format&	workers(const VDWorkerPoolRef &workers) { mWorkers = workers; return *this; }
+			//! watch send latency and queue depth and degrade the stream instead of queueing
+			Format&	adaptive(const VDOutputController::Format &controller) { mAdaptive = true; mController = controller; return *this; }
+			//! records the worker's time per frame (scale and send) as a cpu sample of stage
+			Format&	profiler(const VDProfilerRef &profiler, int stage) { mProfiler = profiler; mProfilerStage = stage; return *this; }
+			//! records receive to sent for frames pushed with a receive time, into stage of the profiler
+			Format&	latency(int stage) { mLatencyStage = stage; return *this; }
+
+			size_t			mQueueSize;
+			VDDropPolicy	mDropPolicy;
+			float			mScale;
+			VDWorkerPoolRef	mWorkers;
+			bool						mAdaptive;
+			VDOutputController::Format	mController;
+			VDProfilerRef				mProfiler;
+			int							mProfilerStage;
+			int							mLatencyStage;
+		};
+
+		VDNDIOutput(const VDFrameSinkRef &sink, const Format &format);
+		~VDNDIOutput();
+		static VDNDIOutputRef	create(const VDFrameSinkRef &sink, const Format &format = Format()) { return std::make_shared<VDNDIOutput>(sink, format); }
+
+		// render thread, never blocks; returns false if the frame was dropped or skipped,
+		// its metadata then goes out with a later frame
+		bool					push(const VDFrameHandle &buffer, long long timecode, const std::shared_ptr<ci::XmlTree> &metadata = nullptr, int64_t receiveNs = 0);
+		void					stop();
+
+		const VDFrameSinkRef&	getSink() const { return mSink; }
+		float					getScale() const { return mScale; }
+		//! null unless the output is adaptive
+		const VDOutputControllerRef&	getController() const { return mController; }
+		VDDropPolicy			getDropPolicy() const { return mQueue.getDropPolicy(); }
+		void					setDropPolicy(VDDropPolicy policy) { mQueue.setDropPolicy(policy); }
+		size_t					getQueueDepth() const { return mQueue.size(); }
+		uint64_t				getEnqueuedCount() const { return mEnqueued; }
+		uint64_t				getSentCount() const { return mSent; }
+		uint64_t				getDroppedCount() const { return mDropped; }
+		//! frames left out by the adaptive rate reduction
+		uint64_t				getSkippedCount() const { return mSkipped; }
+	private:
+		void					run();
+
+		VDFrameSinkRef					mSink;
+		float							mScale;
+		VDWorkerPoolRef					mWorkers;
+		VDFramePoolRef					mScaledPool;
+		VDOutputControllerRef			mController;
+		VDProfilerRef					mProfiler;
+		int								mProfilerStage;
+		int								mLatencyStage;
+		uint64_t						mPushCount;
+		// newest payload pushed, render thread; mMetadataSent is written by the worker
+		std::shared_ptr<ci::XmlTree>	mMetadata;
+		uint64_t						mMetadataSerial;
+		std::atomic<uint64_t>			mMetadataSent;
+		VDFrameQueue<VDOutputFrame>		mQueue;
+		std::atomic<uint64_t>			mEnqueued;
+		std::atomic<uint64_t>			mSent;
+		std::atomic<uint64_t>			mDropped;
+		std::atomic<uint64_t>			mSkipped;
+		std::atomic<bool>				mRunning;
+		std::mutex						mWakeMutex;
+		std::condition_variable			mWake;
+		std::thread						mThread;
+	};
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string>
+
+namespace videodromm
+{
+	// stores the pointer to the VDOutputController instance
+	typedef std::shared_ptr<class VDOutputController> VDOutputControllerRef;
+
+	// Degrades an output stream under backpressure and restores it when capacity returns.
+	// Fed by the output worker after every send, read by the render thread on push.
+	class VDOutputController {
+	public:
+		enum Level {
+			FULL,				// every frame, full size
+			HALF_RATE,			// every other frame
+			HALF_RATE_HALF_RES,	// every other frame, half width and height
+			LEVEL_COUNT
+		};
+
+		struct Format {
+			Format() : mBudgetMs(1000.0f / 60.0f), mDownSamples(8), mUpSamples(180) {}
+
+			//! time available per frame at full rate
+			Format&	budget(float ms) { mBudgetMs = ms; return *this; }
+			//! consecutive overloaded frames before stepping down
+			Format&	downSamples(int count) { mDownSamples = count; return *this; }
+			//! consecutive healthy frames before stepping up, larger than downSamples for hysteresis
+			Format&	upSamples(int count) { mUpSamples = count; return *this; }
+
+			float	mBudgetMs;
+			int		mDownSamples;
+			int		mUpSamples;
+		};
+
+		VDOutputController(const std::string &name, const Format &format);
+		static VDOutputControllerRef	create(const std::string &name, const Format &format = Format()) { return std::make_shared<VDOutputController>(name, format); }
+
+		// worker thread: processing time of the last frame and queue depth after it
+		void				addSample(float sendMs, size_t queueDepth, size_t queueCapacity);
+
+		Level				getLevel() const { return mLevel; }
+		int					getRateDivisor() const { return getLevel() == FULL ? 1 : 2; }
+		float				getScale() const { return getLevel() == HALF_RATE_HALF_RES ? 0.5f : 1.0f; }
+		float				getAverageSendMs() const { return mAverageMs; }
+		static const char*	getLevelName(Level level);
+	private:
+		void				setLevel(Level level, const char *reason);
+
+		std::string				mName;
+		Format					mFormat;
+		std::atomic<Level>		mLevel;
+		std::atomic<float>		mAverageMs;
+		int						mOverloaded;
+		int						mHealthy;
+	};
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include "cinder/Cinder.h"
+#include "cinder/Filesystem.h"
+#include "cinder/Xml.h"
+#include "cinder/gl/gl.h"
+#include "cinder/gl/Fbo.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "VDRenderTargets.h"
+#include "VDShaderManager.h"
+#include "VDUniformBinding.h"
+
+namespace videodromm
+{
+	// stores the pointer to the VDPostGraph instance
+	typedef std::shared_ptr<class VDPostGraph> VDPostGraphRef;
+
+	// Chain of named post passes, the last one renders into the output Fbo.
+	// Each intermediate pass draws at its own fraction of the output size and color
+	// format into a transient VDRenderTargets target, so a blur or glow can run at half
+	// resolution; passes whose outputs are never alive together share one target.
+	// Inputs are bound to iChannel0..N in declaration order, either "source" or an
+	// earlier pass. A pass is skipped, and its previous output reused, when its
+	// program, inputs, size and the uniforms it reads are all unchanged and no aliased
+	// pass wrote over its target since.
+	//
+	// Declared in settings as
+	// <postgraph>
+	//   <pass name="glow" fragment="glow.glsl" scale="0.5" format="rgba16f" inputs="source" uniforms="iExposure" />
+	//   <pass name="post" fragment="post.glsl" inputs="source,glow" />
+	// </postgraph>
+	class VDPostGraph {
+	public:
+		class PassFormat {
+		public:
+			PassFormat(const std::string &name) : mName(name), mScale(1.0f), mInternalFormat(GL_RGBA8) {}
+
+			PassFormat&		vertex(const ci::fs::path &path) { mVertex = path; return *this; }
+			PassFormat&		fragment(const ci::fs::path &path) { mFragment = path; return *this; }
+			// "source" or the name of an earlier pass, bound to the next iChannel
+			PassFormat&		input(const std::string &name) { mInputs.push_back(name); return *this; }
+			// of the output size, ignored for the last pass
+			PassFormat&		scale(float scale) { mScale = scale; return *this; }
+			PassFormat&		internalFormat(GLint format) { mInternalFormat = format; return *this; }
+			// VDUniformBinding names the pass depends on, all of them when none are given
+			PassFormat&		uniform(const std::string &name) { mUniforms.push_back(name); return *this; }
+		private:
+			friend class VDPostGraph;
+			std::string					mName;
+			ci::fs::path				mVertex, mFragment;
+			std::vector<std::string>	mInputs;
+			float						mScale;
+			GLint						mInternalFormat;
+			std::vector<std::string>	mUniforms;
+		};
+
+		VDPostGraph(const VDShaderManagerRef &shaders, const VDUniformBindingRef &uniforms, const VDRenderTargetsRef &targets);
+		static VDPostGraphRef	create(const VDShaderManagerRef &shaders, const VDUniformBindingRef &uniforms, const VDRenderTargetsRef &targets) { return std::make_shared<VDPostGraph>(shaders, uniforms, targets); }
+
+		// returns false, and adds nothing, if an input is unknown
+		bool			addPass(const PassFormat &format);
+		// <postgraph> as above, shader paths relative to baseDir, vertex defaults to defaultVertex
+		bool			load(const ci::XmlTree &graph, const ci::fs::path &baseDir, const ci::fs::path &defaultVertex);
+		void			clear();
+
+		// call once per received frame, bumps the source version unless signature, a
+		// VDChangeDetector signature of the frame, is the same as the last one (0: unknown)
+		void			setSource(const ci::gl::Texture2dRef &texture, uint64_t signature = 0);
+		// renders the passes that are out of date, returns false until every program is ready
+		bool			render(const ci::gl::FboRef &output);
+
+		// every pass has a linked program
+		bool			isReady() const;
+		// the compile or link error of the first pass without a program, empty if none failed
+		std::string		getError() const;
+		size_t			getPassCount() const { return mPasses.size(); }
+		uint64_t		getRenderedCount() const { return mRendered; }
+		uint64_t		getSkippedCount() const { return mSkipped; }
+		// bumped every time the last pass draws into the output
+		uint64_t		getOutputVersion() const { return mPasses.empty() ? 0 : mPasses.back().version; }
+
+		static GLint	parseFormat(const std::string &name);
+	private:
+		struct Pass {
+			std::string				name;
+			VDShaderRef				shader;
+			std::vector<int>		inputs;		// pass index, -1 for the source
+			std::vector<int>		uniforms;	// VDUniformBinding indices
+			bool					allUniforms;
+			float					scale;
+			GLint					internalFormat;
+			int						transient;	// VDRenderTargets handle, -1 for the last pass
+			ci::gl::FboRef			target;
+			uint64_t				version;	// bumped on every render
+			std::vector<uint64_t>	key;		// what the current output was made from
+			uint64_t				programId;	// sampler units last set for this program
+			GLint					resolutionLocation;
+		};
+
+		void				makeKey(const Pass &pass, const ci::gl::FboRef &fbo, std::vector<uint64_t> &key) const;
+		// sizes the intermediates for this output and lets the allocator alias them
+		void				plan(const ci::ivec2 &outputSize);
+
+		VDShaderManagerRef			mShaders;
+		VDUniformBindingRef			mUniforms;
+		VDRenderTargetsRef			mTargets;
+		std::vector<Pass>			mPasses;
+		ci::gl::Texture2dRef		mSource;
+		uint64_t					mSourceVersion;
+		uint64_t					mSourceSignature;
+		bool						mPlanned;
+		ci::ivec2					mPlannedSize;
+		// pass that last drew into each intermediate
+		std::map<const ci::gl::Fbo*, size_t>	mWriters;
+		uint64_t					mRendered, mSkipped;
+		std::vector<uint64_t>		mKey;
+	};
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "cinder/Cinder.h"
+#include "cinder/Rect.h"
+#include "cinder/gl/gl.h"
+#include "cinder/gl/Batch.h"
+#include "cinder/gl/Fbo.h"
+
+#include <vector>
+
+namespace videodromm
+{
+	// stores the pointer to the VDPreviewCompositor instance
+	typedef std::shared_ptr<class VDPreviewCompositor> VDPreviewCompositorRef;
+
+	// Multi-view preview in one instanced draw.
+	// Each source is copied once per new frame into a mipmapped target no larger than
+	// twice the biggest tile, tiles then sample it trilinearly. Per-tile rect, uv and
+	// source live in uniform arrays indexed by gl_InstanceID.
+	class VDPreviewCompositor {
+	public:
+		struct Tile {
+			Tile() : source(0), flipH(false), flipV(false) {}
+			Tile(const ci::Rectf &rect, int source, bool flipH = false, bool flipV = false) : rect(rect), source(source), flipH(flipH), flipV(flipV) {}
+			ci::Rectf	rect;	// window pixels
+			int			source;	// 0 or 1
+			bool		flipH, flipV;
+		};
+
+		VDPreviewCompositor();
+		static VDPreviewCompositorRef	create() { return std::make_shared<VDPreviewCompositor>(); }
+
+		// cols x rows cells of tileSize, separated by margin, from the top left corner
+		static std::vector<ci::Rectf>	grid(int cols, int rows, const ci::vec2 &tileSize, float margin);
+
+		// at most MAX_TILES
+		void			setTiles(const std::vector<Tile> &tiles);
+		// call once per new frame; a null texture hides the tiles of that source
+		void			setSource(int index, const ci::gl::Texture2dRef &texture);
+		void			draw();
+
+		static const int	MAX_TILES = 16;
+		static const int	MAX_SOURCES = 2;
+	private:
+		std::vector<Tile>		mTiles;
+		ci::ivec2				mMaxTileSize;
+		ci::gl::FboRef			mTargets[MAX_SOURCES];
+		bool					mVisible[MAX_SOURCES];
+		ci::gl::GlslProgRef		mGlsl;
+		ci::gl::BatchRef		mBatch;
+		// uniform arrays
+		std::vector<ci::vec4>	mRects, mUvs;
+		std::vector<int>		mSources;
+	};
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "cinder/Cinder.h"
+#include "cinder/gl/gl.h"
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "VDHistogram.h"
+
+namespace videodromm
+{
+	// stores the pointer to the VDProfiler instance
+	typedef std::shared_ptr<class VDProfiler> VDProfilerRef;
+
+	// Per-stage CPU and GPU timings of the frame pipeline.
+	// CPU time comes from a monotonic clock around the scope. GPU time comes from a
+	// pair of GL timestamp queries per scope, kept in a small ring and read back
+	// frames later, only once the driver reports them available, so it never stalls.
+	// Both go into lock-free histograms (p50/p95/p99) that other threads may feed too.
+	class VDProfiler {
+	public:
+		VDProfiler();
+		~VDProfiler();
+		static VDProfilerRef	create() { return std::make_shared<VDProfiler>(); }
+
+		// before any thread records into it
+		int					addStage(const std::string &name);
+
+		// render thread only, with the GL context current
+		void				beginGpu(int stage);
+		void				endGpu(int stage);
+		// render thread, once per frame: folds in the GPU results that are ready
+		void				collect();
+		// any thread
+		void				addCpuSample(int stage, double ms) { mStages[stage]->cpu.add(ms); }
+		void				reset();
+
+		size_t				getStageCount() const { return mStages.size(); }
+		const std::string&	getStageName(int stage) const { return mStages[stage]->name; }
+		const VDHistogram&	getCpu(int stage) const { return mStages[stage]->cpu; }
+		const VDHistogram&	getGpu(int stage) const { return mStages[stage]->gpu; }
+		// GPU scopes not measured because the ring was still waiting on the driver
+		uint64_t			getGpuMissed() const { return mGpuMissed; }
+		// one line per stage, for the hud
+		std::string			getSummary(int stage) const;
+		// table of every stage, for the log and dump files
+		std::string			report() const;
+
+		// times the scope on the CPU, and on the GPU when asked, and traces it (VDTracer);
+		// no-op without a profiler
+		class ScopedTimer {
+		public:
+			ScopedTimer(VDProfiler *profiler, int stage, bool gpu = false);
+			~ScopedTimer();
+		private:
+			VDProfiler								*mProfiler;
+			int										mStage;
+			bool									mGpu;
+			std::chrono::steady_clock::time_point	mBegin;
+		};
+
+		// frames a GPU result may take before its slot is needed again
+		static const int	GPU_LATENCY = 4;
+	private:
+		struct Stage {
+			std::string		name;
+			VDHistogram		cpu, gpu;
+			GLuint			queries[GPU_LATENCY][2];
+			bool			pending[GPU_LATENCY];
+			bool			created;	// queries are generated on first GPU use
+			int				next;		// slot of the next scope
+			bool			active;		// between beginGpu and endGpu
+		};
+		bool				collect(Stage &stage, int slot);
+
+		// histograms are atomic and cannot move
+		std::vector<std::unique_ptr<Stage>>	mStages;
+		uint64_t							mGpuMissed;
+	};
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+
+namespace videodromm
+{
+	// Layout of the .vdraw recordings (VDRecordingSink writes, replay reads).
+	// Little endian, every record starts on a VDRAW_ALIGNMENT boundary:
+	//   file header, padded to VDRAW_ALIGNMENT
+	//   per frame: VDRawFrameHeader, then the payload, padded: height rows of rowBytes pixel
+	//   bytes, or a VDTileCodec payload of payloadBytes when compression is VDRAW_TILE_LZ
+	//   index: one VDRawIndexEntry per frame, padded so that the VDRawFooter ends the file
+	// A file without footer (the recorder did not close it) can be rebuilt by walking the
+	// frame headers from the first record.
+	const uint32_t	VDRAW_ALIGNMENT = 4096;
+	const uint32_t	VDRAW_VERSION = 1;
+
+	// VDRawFrameHeader::compression
+	const uint32_t	VDRAW_RAW = 0;
+	const uint32_t	VDRAW_TILE_LZ = 1;
+
+	struct VDRawFileHeader {
+		char		magic[8];		// "VDRAW\0\0\0"
+		uint32_t	version;
+		uint32_t	alignment;
+		int64_t		createdUnix;	// seconds
+		char		name[64];		// source or sender, zero terminated
+		uint8_t		reserved[40];
+	};
+
+	struct VDRawFrameHeader {
+		char		magic[4];		// "VDFR"
+		uint32_t	width;
+		uint32_t	height;
+		uint32_t	rowBytes;		// width * 4, rows are packed
+		uint32_t	channelOrder;	// ci::SurfaceChannelOrder code
+		uint32_t	compression;	// VDRAW_RAW or VDRAW_TILE_LZ
+		int64_t		timecode;		// as pushed by the render thread
+		int64_t		timeNs;			// since the first frame of the file
+		uint64_t	frameIndex;
+		uint64_t	recordBytes;	// header, pixels and padding: the offset of the next record
+		uint64_t	payloadBytes;	// compressed size, 0 for raw frames
+	};
+
+	struct VDRawIndexEntry {
+		uint64_t	offset;			// of the VDRawFrameHeader
+		int64_t		timecode;
+		int64_t		timeNs;
+		uint32_t	width;
+		uint32_t	height;
+	};
+
+	struct VDRawFooter {
+		char		magic[8];		// "VDRAWIDX"
+		uint64_t	frameCount;
+		uint64_t	indexOffset;
+		uint64_t	indexBytes;
+		uint8_t		reserved[32];
+	};
+
+	static_assert(sizeof(VDRawFileHeader) == 128, "VDRawFileHeader layout");
+	static_assert(sizeof(VDRawFrameHeader) == 64, "VDRawFrameHeader layout");
+	static_assert(sizeof(VDRawIndexEntry) == 32, "VDRawIndexEntry layout");
+	static_assert(sizeof(VDRawFooter) == 64, "VDRawFooter layout");
+}
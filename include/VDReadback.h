@@ -0,0 +1,27 @@
+#pragma once
+
+#include "cinder/Cinder.h"
+#include "cinder/gl/gl.h"
+#include "cinder/gl/Texture.h"
+
+#include "VDFramePool.h"
+
+namespace videodromm
+{
+	// stores the pointer to the VDReadback instance
+	typedef std::shared_ptr<class VDReadback> VDReadbackRef;
+
+	// GPU to CPU copy of the output texture into pooled buffers, render thread only
+	class VDReadback {
+	public:
+		VDReadback(const VDFramePoolRef &pool);
+		static VDReadbackRef	create(const VDFramePoolRef &pool) { return std::make_shared<VDReadback>(pool); }
+
+		// BGRA, rows top-down like ci::Surface
+		VDFrameHandle			read(const ci::gl::Texture2dRef &texture);
+
+		const VDFramePoolRef&	getPool() const { return mPool; }
+	private:
+		VDFramePoolRef			mPool;
+	};
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "cinder/Cinder.h"
+#include "cinder/Filesystem.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "VDFrameSink.h"
+#include "VDRawContainer.h"
+#include "VDWorkerPool.h"
+
+namespace videodromm
+{
+	// stores the pointer to the VDRecordingSink instance
+	typedef std::shared_ptr<class VDRecordingSink> VDRecordingSinkRef;
+
+	// Writes every frame it is sent into a .vdraw file (VDRawContainer.h).
+	// Meant to sit behind a VDNDIOutput, whose queue keeps draw() from waiting on the disk
+	// and counts the frames dropped when the disk cannot keep up.
+	// Records are gathered in an aligned staging buffer and written WRITE_SIZE at a time,
+	// unbuffered (O_DIRECT, FILE_FLAG_NO_BUFFERING) where the file system allows it.
+	// Compressed recordings code each frame with VDTileCodec, tile-parallel on the workers.
+	// Metadata is not recorded.
+	class VDRecordingSink : public VDFrameSink {
+	public:
+		struct Format {
+			Format() : mCompress(false) {}
+
+			//! stored in the file header, the file name when empty
+			Format&	name(const std::string &name) { mName = name; return *this; }
+			//! lossless tile compression, smaller files for some encode time per frame
+			Format&	compress(bool compress) { mCompress = compress; return *this; }
+			//! pool that encodes the tiles, the sending thread alone when null
+			Format&	workers(const VDWorkerPoolRef &workers) { mWorkers = workers; return *this; }
+
+			std::string		mName;
+			bool			mCompress;
+			VDWorkerPoolRef	mWorkers;
+		};
+
+		VDRecordingSink(const ci::fs::path &path, const Format &format);
+		~VDRecordingSink();
+		static VDRecordingSinkRef create(const ci::fs::path &path, const Format &format = Format()) { return std::make_shared<VDRecordingSink>(path, format); }
+
+		void		sendSurface(ci::Surface &surface, long long timecode) override;
+		void		sendMetadata(const ci::XmlTree &metadata, long long timecode) override {}
+		std::string	getName() const override { return mName; }
+
+		// writes what is staged and the index; call once the worker has stopped
+		void		close();
+
+		bool		isOpen() const { return mFile != INVALID; }
+		bool		isUnbuffered() const { return mUnbuffered; }
+		bool		isCompressed() const { return mCompress; }
+		const ci::fs::path&	getPath() const { return mPath; }
+		uint64_t	getFramesWritten() const { return mFramesWritten; }
+		uint64_t	getBytesWritten() const { return mBytesWritten; }
+		uint64_t	getWriteErrors() const { return mWriteErrors; }
+		// time spent inside write calls
+		double		getWriteSeconds() const { return mWriteNs / 1.0e9; }
+		// bytes written per second of write time, what the disk sustains
+		double		getThroughputMBps() const;
+		// frame bytes before compression over the record bytes they took, about 1 when raw
+		double		getCompressionRatio() const;
+		double		getEncodeSeconds() const { return mEncodeNs / 1.0e9; }
+
+		static const size_t	WRITE_SIZE = 4 << 20;
+	private:
+		// appends to the staging buffer, growing it when needed
+		uint8_t*	stage(size_t bytes);
+		bool		flush();
+
+		static const intptr_t	INVALID = -1;
+
+		ci::fs::path			mPath;
+		std::string				mName;
+		intptr_t				mFile;		// fd, or HANDLE on Windows
+		bool					mUnbuffered;
+		bool					mCompress;
+		VDWorkerPoolRef			mWorkers;
+		std::vector<uint8_t>	mPayload;	// the last compressed frame
+		std::unique_ptr<uint8_t[]>	mStagingMemory;
+		uint8_t					*mStaging;	// VDRAW_ALIGNMENT aligned view on mStagingMemory
+		size_t					mStagingCapacity;
+		size_t					mStaged;
+		uint64_t				mFileOffset;	// of the staging buffer's first byte
+		std::vector<VDRawIndexEntry>	mIndex;
+		std::chrono::steady_clock::time_point	mFirstFrame;
+		std::atomic<uint64_t>	mFramesWritten;
+		std::atomic<uint64_t>	mBytesWritten;
+		std::atomic<uint64_t>	mWriteErrors;
+		std::atomic<uint64_t>	mWriteNs;
+		std::atomic<uint64_t>	mEncodeNs;
+		std::atomic<uint64_t>	mPixelBytes;	// frame bytes before compression
+		std::atomic<uint64_t>	mRecordBytes;	// record bytes they took
+	};
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "cinder/Cinder.h"
+#include "cinder/gl/gl.h"
+#include "cinder/gl/Fbo.h"
+
+#include <string>
+#include <vector>
+
+namespace videodromm
+{
+	// stores the pointer to the VDRenderTargets instance
+	typedef std::shared_ptr<class VDRenderTargets> VDRenderTargetsRef;
+
+	// Creates Fbos on demand from (size, color format, depth) descriptors.
+	// Named targets live until their descriptor changes. Transient targets are
+	// declared per plan with the span of steps that use them; requests whose spans do
+	// not overlap share one Fbo, so a chain of passes needs as many targets as are
+	// alive at once, not one per pass. Every Fbo is accounted in bytes of VRAM.
+	class VDRenderTargets {
+	public:
+		struct Desc {
+			Desc() : size(0), internalFormat(GL_RGBA8), depth(false) {}
+			Desc(const ci::ivec2 &size, GLint internalFormat = GL_RGBA8, bool depth = false) : size(size), internalFormat(internalFormat), depth(depth) {}
+			bool operator==(const Desc &other) const { return size == other.size && internalFormat == other.internalFormat && depth == other.depth; }
+			bool operator!=(const Desc &other) const { return !(*this == other); }
+
+			ci::ivec2	size;
+			GLint		internalFormat;
+			bool		depth;
+		};
+		struct Usage {
+			std::string	name;	// transients sharing the target are joined with '+'
+			Desc		desc;
+			size_t		bytes;
+			bool		transient;
+		};
+
+		VDRenderTargets();
+		static VDRenderTargetsRef	create() { return std::make_shared<VDRenderTargets>(); }
+
+		// whole-session target, reallocated only when desc differs from the last call
+		ci::gl::FboRef			acquire(const std::string &name, const Desc &desc);
+		void					release(const std::string &name);
+
+		// transients: beginPlan, addTransient for every request, endPlan, then getTransient
+		void					beginPlan();
+		// used from step firstUse to lastUse included, returns the request handle
+		int						addTransient(const std::string &name, const Desc &desc, int firstUse, int lastUse);
+		// assigns Fbos, keeping the ones of the previous plan where they still fit
+		void					endPlan();
+		ci::gl::FboRef			getTransient(int handle) const { return mTargets[mRequests[handle].target].fbo; }
+
+		// per target, for the hud and the log
+		std::vector<Usage>		getUsage() const;
+		size_t					getBytes() const;
+		static size_t			bytesPerPixel(GLint internalFormat);
+	private:
+		struct Target {
+			std::string		name;
+			Desc			desc;
+			ci::gl::FboRef	fbo;
+			size_t			bytes;
+			bool			transient;
+			int				busyUntil;	// last step of the requests assigned in this plan
+		};
+		struct Request {
+			std::string		name;
+			Desc			desc;
+			int				firstUse, lastUse;
+			int				target;
+		};
+
+		int						allocate(const std::string &name, const Desc &desc, bool transient);
+		void					logTotal(const char *reason) const;
+
+		std::vector<Target>		mTargets;
+		std::vector<Request>	mRequests;
+	};
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "VDFrameSource.h"
+#include "VDRawContainer.h"
+#include "VDWorkerPool.h"
+
+#include <chrono>
+
+namespace videodromm
+{
+	// stores the pointer to the VDReplaySource instance
+	typedef std::shared_ptr<class VDReplaySource> VDReplaySourceRef;
+
+	// A .vdraw recording (VDRecordingSink) played back as if a sender produced it.
+	// The file is memory mapped: textures are uploaded straight from the mapping and the
+	// next frames are announced to the OS for readahead, so replay reads no more than it shows.
+	// In real time, frames come at their recorded times and receive() repeats the current
+	// one in between; otherwise every frame is delivered once per receive(), in order.
+	// Compressed frames are decoded tile-parallel on a pool of the source's own.
+	class VDReplaySource : public VDFrameSource {
+	public:
+		struct Format {
+			Format() : mRealtime(true), mLoop(true), mPixels(false), mReadahead(4) {}
+
+			//! recorded timing, or as fast as receive() is called
+			Format&	realtime(bool realtime) { mRealtime = realtime; return *this; }
+			//! start over after the last frame, otherwise receive() returns null from then on
+			Format&	loop(bool loop) { mLoop = loop; return *this; }
+			//! hand frames over as pixels (receivePixels) like a memory share sender
+			Format&	pixels(bool pixels) { mPixels = pixels; return *this; }
+			//! frames ahead of the current one to prefetch
+			Format&	readahead(int frames) { mReadahead = frames; return *this; }
+
+			bool	mRealtime;
+			bool	mLoop;
+			bool	mPixels;
+			int		mReadahead;
+		};
+
+		// a frame in the mapping, valid while the source lives
+		struct Frame {
+			const VDRawFrameHeader	*header;
+			const uint8_t			*pixels;	// packed rows, or the VDTileCodec payload
+		};
+
+		VDReplaySource(const ci::fs::path &path, const Format &format);
+		~VDReplaySource();
+		static VDReplaySourceRef create(const ci::fs::path &path, const Format &format = Format()) { return std::make_shared<VDReplaySource>(path, format); }
+
+		ci::gl::Texture2dRef	receive() override;
+		std::string				getName() const override { return mName; }
+		bool					hasPixels() const override { return mPixels; }
+		VDFrameHandle			receivePixels(VDFramePool &pool) override;
+
+		size_t					getFrameCount() const { return mIndex.size(); }
+		Frame					getFrame(size_t index) const;
+		// the frame's pixels into rows of rowBytes, decoding compressed frames
+		bool					readPixels(const Frame &frame, uint8_t *pixels, ptrdiff_t rowBytes);
+		// the last frame handed out
+		size_t					getPosition() const { return mPosition; }
+		bool					isOpen() const { return !mIndex.empty(); }
+	private:
+		// the frame to deliver now, or -1 while the current one stays or replay has ended
+		int64_t					advance();
+		void					prefetch(size_t index);
+		// a frame header at offset whose record, and pixels for raw frames, fit in the file
+		bool					isValidRecord(uint64_t offset) const;
+
+		std::string				mName;
+		bool					mRealtime;
+		bool					mLoop;
+		bool					mPixels;
+		int						mReadahead;
+		intptr_t				mFile;
+		intptr_t				mMapping;
+		const uint8_t			*mData;
+		uint64_t				mSize;
+		std::vector<VDRawIndexEntry>	mIndex;
+		size_t					mPosition;
+		bool					mStarted;
+		bool					mEnded;		// not looping and past the last frame
+		std::chrono::steady_clock::time_point	mStart;	// playback time 0 of the current loop
+		ci::gl::Texture2dRef	mTexture;
+		VDWorkerPoolRef			mWorkers;	// created with the first compressed frame
+		std::vector<uint8_t>	mDecoded;	// the texture upload of a compressed frame
+	};
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "cinder/Cinder.h"
+#include "cinder/Filesystem.h"
+#include "cinder/gl/gl.h"
+#include "cinder/gl/Context.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "VDShaderProgram.h"
+
+namespace videodromm
+{
+	// stores the pointer to the VDShader instance
+	typedef std::shared_ptr<class VDShader> VDShaderRef;
+
+	// A vertex/fragment pair managed by VDShaderManager.
+	// getProgram() is the last program that linked; it stays valid while a newer
+	// version compiles and is swapped only once the new one is ready.
+	class VDShader {
+	public:
+		VDShader(const std::string &name, const ci::fs::path &vertexPath, const ci::fs::path &fragmentPath);
+
+		const VDShaderProgramRef&	getProgram() const { return mProgram; }
+		bool						isReady() const { return (bool)mProgram; }
+		const std::string&			getName() const { return mName; }
+		const std::string&			getError() const { return mError; }
+		int							getVersion() const { return mVersion; }
+	private:
+		friend class VDShaderManager;
+
+		std::string				mName;
+		ci::fs::path			mVertexPath, mFragmentPath;
+		int64_t					mVertexTime, mFragmentTime;
+		VDShaderProgramRef		mProgram;
+		std::string				mError;
+		int						mVersion;
+		bool					mPending;
+	};
+
+	// stores the pointer to the VDShaderManager instance
+	typedef std::shared_ptr<class VDShaderManager> VDShaderManagerRef;
+
+	// Compiles shaders on a background GL context shared with the render context, so
+	// startup and edits never stall a frame. Linked programs are cached on disk as
+	// program binaries keyed by a hash of the sources and the driver string; a cache
+	// hit skips compilation entirely. Source files are watched and hot swapped.
+	class VDShaderManager {
+	public:
+		// render thread, needs the current GL context to share with
+		VDShaderManager(const ci::fs::path &cacheDir);
+		~VDShaderManager();
+		static VDShaderManagerRef	create(const ci::fs::path &cacheDir) { return std::make_shared<VDShaderManager>(cacheDir); }
+
+		// queues the first compile, the program is null until it is ready
+		VDShaderRef			load(const std::string &name, const ci::fs::path &vertexPath, const ci::fs::path &fragmentPath);
+		// render thread, once per frame: swaps in finished programs, polls the files
+		void				update();
+
+		void				setWatchInterval(double seconds) { mWatchInterval = seconds; }
+		uint64_t			getCacheHits() const { return mCacheHits; }
+		uint64_t			getCompiles() const { return mCompiles; }
+	private:
+		struct Job {
+			VDShaderRef		shader;
+			ci::fs::path	vertexPath, fragmentPath;
+		};
+		struct Result {
+			VDShaderRef		shader;
+			GLuint			handle;
+			GLsync			fence;
+			std::string		error;
+		};
+
+		void				run();
+		void				queue(const VDShaderRef &shader);
+		GLuint				build(const std::string &vertex, const std::string &fragment, std::string &error);
+		GLuint				loadBinary(const ci::fs::path &path);
+		void				saveBinary(GLuint handle, const ci::fs::path &path);
+
+		ci::fs::path				mCacheDir;
+		std::string					mDriver;
+		ci::gl::ContextRef			mBackgroundContext;
+		std::vector<VDShaderRef>	mShaders;
+		std::deque<Job>				mJobs;
+		std::vector<Result>			mResults;
+		std::mutex					mMutex;
+		std::condition_variable		mCondition;
+		bool						mRunning;
+		std::thread					mThread;
+		double						mWatchInterval;
+		double						mLastWatch;
+		std::atomic<uint64_t>		mCacheHits;
+		std::atomic<uint64_t>		mCompiles;
+	};
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "cinder/Cinder.h"
+#include "cinder/Rect.h"
+#include "cinder/gl/gl.h"
+#include "cinder/gl/Vao.h"
+#include "cinder/gl/Vbo.h"
+
+#include <string>
+
+namespace videodromm
+{
+	// stores the pointer to the VDShaderProgram instance
+	typedef std::shared_ptr<class VDShaderProgram> VDShaderProgramRef;
+
+	// Linked post-processing program, owned as a plain GL handle.
+	// Built by VDShaderManager (compiled or loaded from a program binary, which
+	// gl::GlslProg cannot do). Attributes are bound to fixed locations before link so
+	// shaders written for Cinder (ciPosition, ciTexCoord0, ciColor,
+	// ciModelViewProjection) work unchanged.
+	class VDShaderProgram {
+	public:
+		VDShaderProgram(GLuint handle, const std::string &name);
+		~VDShaderProgram();
+		// takes ownership of the handle
+		static VDShaderProgramRef	create(GLuint handle, const std::string &name) { return std::make_shared<VDShaderProgram>(handle, name); }
+
+		GLuint				getHandle() const { return mHandle; }
+		// unique per program object, handles can be recycled by the driver
+		uint64_t			getId() const { return mId; }
+		const std::string&	getName() const { return mName; }
+		GLint				getUniformLocation(const char *name) const { return glGetUniformLocation(mHandle, name); }
+
+		// textured quad over rect with the current Cinder matrices, program must be in use
+		void				drawRect(const ci::Rectf &rect);
+
+		enum { ATTRIB_POSITION = 0, ATTRIB_TEXCOORD0 = 1, ATTRIB_COLOR = 2 };
+		// call between glAttachShader and glLinkProgram
+		static void			bindAttribLocations(GLuint handle);
+	private:
+		GLuint				mHandle;
+		uint64_t			mId;
+		std::string			mName;
+		GLint				mMvpLocation;
+		ci::gl::VaoRef		mVao;
+		ci::gl::VboRef		mVbo;
+	};
+
+	// Makes a VDShaderProgram current and keeps Cinder's program cache in step
+	class VDScopedProgram {
+	public:
+		VDScopedProgram(const VDShaderProgramRef &program);
+		~VDScopedProgram();
+	};
+}
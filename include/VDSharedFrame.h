@@ -0,0 +1,87 @@
+#pragma once
+
+#include "cinder/Cinder.h"
+#include "cinder/Vector.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace videodromm
+{
+	// Portable frame sharing through a named shared memory segment, one writer, any
+	// number of readers: a VDSharedFrameHeader, then height packed rows of BGRA.
+	// The header's sequence is a seqlock: odd while the writer fills the frame, so a
+	// reader that overlapped a write sees the sequence change and drops the copy.
+	// The size is fixed when the writer creates the segment. Every frame carries its send
+	// time in the header, for latency measurement (VDFrameStamp).
+	struct VDSharedFrameHeader {
+		char					magic[8];	// "VDSHFRM\0"
+		uint32_t				width;
+		uint32_t				height;
+		std::atomic<uint64_t>	sequence;	// twice the frames written, odd during a write
+		std::atomic<int64_t>	sendNs;		// VDFrameStamp::now() when the frame was published
+		uint8_t					reserved[32];
+	};
+
+	static_assert(sizeof(VDSharedFrameHeader) == 64, "VDSharedFrameHeader layout");
+
+	// stores the pointer to the VDSharedFrameWriter instance
+	typedef std::shared_ptr<class VDSharedFrameWriter> VDSharedFrameWriterRef;
+
+	class VDSharedFrameWriter {
+	public:
+		VDSharedFrameWriter(const std::string &name, const ci::ivec2 &size);
+		~VDSharedFrameWriter();
+		static VDSharedFrameWriterRef create(const std::string &name, const ci::ivec2 &size) { return std::make_shared<VDSharedFrameWriter>(name, size); }
+
+		bool				isOpen() const { return mHeader != nullptr; }
+		// the frame to fill, packed rows of getSize().x * 4 bytes; endFrame() publishes it
+		uint8_t*			beginFrame();
+		void				endFrame();
+
+		const std::string&	getName() const { return mName; }
+		ci::ivec2			getSize() const { return mSize; }
+		uint64_t			getFramesWritten() const { return mFramesWritten; }
+	private:
+		std::string			mName;
+		ci::ivec2			mSize;
+		intptr_t			mHandle;	// fd, or the mapping HANDLE on Windows
+		size_t				mBytes;
+		VDSharedFrameHeader	*mHeader;
+		uint64_t			mFramesWritten;
+	};
+
+	// stores the pointer to the VDSharedFrameReader instance
+	typedef std::shared_ptr<class VDSharedFrameReader> VDSharedFrameReaderRef;
+
+	class VDSharedFrameReader {
+	public:
+		VDSharedFrameReader();
+		~VDSharedFrameReader();
+		static VDSharedFrameReaderRef create() { return std::make_shared<VDSharedFrameReader>(); }
+
+		// maps the writer's segment, false while it does not exist
+		bool				open(const std::string &name);
+		void				close();
+		bool				isOpen() const { return mHeader != nullptr; }
+		ci::ivec2			getSize() const { return mSize; }
+		// copies a frame newer than the last one read; false when there is none or the
+		// copy was torn by a write (counted, the next call tries again)
+		bool				read(uint8_t *pixels, ptrdiff_t rowBytes);
+		// frame number of the last read, counted from 1 by the writer
+		uint64_t			getFrameNumber() const { return mLastSequence / 2; }
+		// the writer's send time of the last read, VDFrameStamp::now() clock
+		int64_t				getSendNs() const { return mSendNs; }
+		uint64_t			getTornReads() const { return mTornReads; }
+	private:
+		ci::ivec2			mSize;
+		intptr_t			mHandle;
+		size_t				mBytes;
+		const VDSharedFrameHeader	*mHeader;
+		uint64_t			mLastSequence;
+		int64_t				mSendNs;
+		uint64_t			mTornReads;
+	};
+}
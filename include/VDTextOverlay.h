@@ -0,0 +1,57 @@
+#pragma once
+
+#include "cinder/Cinder.h"
+#include "cinder/Color.h"
+#include "cinder/Font.h"
+#include "cinder/gl/gl.h"
+#include "cinder/gl/TextureFont.h"
+
+#include <string>
+#include <vector>
+
+namespace videodromm
+{
+	// stores the pointer to the VDTextOverlay instance
+	typedef std::shared_ptr<class VDTextOverlay> VDTextOverlayRef;
+
+	// HUD text from glyph atlases.
+	// Each font size is rasterised once into a gl::TextureFont atlas; labels keep their
+	// glyph placements until their text changes, and all visible labels of a size are
+	// drawn as a single batch. Replaces per-frame gl::drawString, which rasterises and
+	// uploads a new texture for every string.
+	class VDTextOverlay {
+	public:
+		VDTextOverlay(const std::string &fontName);
+		static VDTextOverlayRef	create(const std::string &fontName = "Verdana") { return std::make_shared<VDTextOverlay>(fontName); }
+
+		// returns the label id, size in pixels
+		int						addLabel(float size, const ci::ColorA &color = ci::ColorA::white());
+		// hides every label, call once per frame before the setText calls
+		void					beginFrame();
+		// shows the label this frame; pos is the top left corner like gl::drawString
+		void					setText(int id, const std::string &text, const ci::vec2 &pos);
+		void					draw();
+	private:
+		struct Label {
+			size_t											font;
+			ci::ColorA8u									color;
+			std::string										text;
+			ci::vec2										pos;
+			bool											visible;
+			bool											wasVisible;
+			std::vector<std::pair<ci::Font::Glyph, ci::vec2>>	placements;
+		};
+		struct Batch {
+			ci::gl::TextureFontRef							font;
+			float											size;
+			std::vector<std::pair<ci::Font::Glyph, ci::vec2>>	glyphs;
+			std::vector<ci::ColorA8u>						colors;
+		};
+		void					rebuild();
+
+		std::string				mFontName;
+		std::vector<Label>		mLabels;
+		std::vector<Batch>		mBatches;
+		bool					mDirty;
+	};
+}
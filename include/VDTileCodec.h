@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "VDWorkerPool.h"
+
+namespace videodromm
+{
+	// Lossless frame compression for recordings, 4 bytes per pixel.
+	// The frame is cut into bands of TILE_ROWS rows that are coded independently, so
+	// encode and decode both run tile-parallel on a worker pool. Per tile:
+	//   filter	each byte minus the gradient prediction left + up - upleft (mod 256)
+	//   LZ		LZ4-style sequences over the residuals: literal run, 16-bit offset, match length
+	// Payload: uint32 tile rows, uint32 tile count, uint32 compressed size per tile, the tiles.
+	class VDTileCodec {
+	public:
+		// replaces out with the payload; out keeps its capacity across frames
+		static void		encode(const uint8_t *pixels, ptrdiff_t rowBytes, int32_t width, int32_t height, std::vector<uint8_t> &out, VDWorkerPool *workers = nullptr);
+		// false if the payload is damaged or does not match the size
+		static bool		decode(const uint8_t *payload, size_t bytes, int32_t width, int32_t height, uint8_t *pixels, ptrdiff_t rowBytes, VDWorkerPool *workers = nullptr);
+
+		// LZ stage alone, exposed for checks; returns the compressed size, dst holds compressBound(size)
+		static size_t	compress(const uint8_t *src, size_t size, uint8_t *dst);
+		static bool		decompress(const uint8_t *src, size_t size, uint8_t *dst, size_t dstSize);
+		static size_t	compressBound(size_t size) { return size + size / 255 + 16; }
+
+		static const int32_t	TILE_ROWS = 32;
+	};
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "cinder/Cinder.h"
+#include "cinder/Filesystem.h"
+
+#include <cstdint>
+#include <string>
+
+namespace videodromm
+{
+	// Begin/end events of the frame pipeline, written as Chrome trace-event JSON
+	// (chrome://tracing, ui.perfetto.dev).
+	// Every thread records into a ring of its own, preallocated on its first event, so
+	// recording is a clock read and three stores with no lock or allocation. The rings
+	// keep the last RING_SIZE events per thread; write() exports the last seconds of them.
+	// Event names are stored as pointers and must outlive the tracer (literals, or
+	// strings owned by long-lived objects).
+	class VDTracer {
+	public:
+		static void		setEnabled(bool enabled);
+		static bool		isEnabled();
+		// shown instead of the thread number, call from the thread itself
+		static void		setThreadName(const std::string &name);
+
+		static void		begin(const char *name);
+		static void		end(const char *name);
+		static void		instant(const char *name);
+
+		// pauses recording while copying, returns false if the file cannot be written
+		static bool		write(const ci::fs::path &path, double seconds);
+
+		class Scope {
+		public:
+			Scope(const char *name) : mName(name) { begin(mName); }
+			~Scope() { end(mName); }
+		private:
+			const char		*mName;
+		};
+
+		static const size_t	RING_SIZE = 1 << 16;
+	};
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "cinder/Cinder.h"
+#include "cinder/gl/gl.h"
+#include "cinder/gl/Ubo.h"
+
+#include <string>
+#include <vector>
+
+// Session
+#include "VDSession.h"
+
+#include "VDShaderProgram.h"
+#include "VDUniformStore.h"
+
+namespace videodromm
+{
+	// stores the pointer to the VDUniformBinding instance
+	typedef std::shared_ptr<class VDUniformBinding> VDUniformBindingRef;
+
+	// Typed uniform values for the post shaders.
+	// Values live in a VDUniformStore; its changed runs are packed into a CPU-side std140
+	// block mirrored to a Ubo. Programs that declare the block get the dirty byte range
+	// uploaded once and bound to a binding point; other programs get plain glUniform calls
+	// at locations resolved once per program, and only for values they have not seen yet.
+	class VDUniformBinding {
+	public:
+		VDUniformBinding(const std::string &blockName, GLuint bindingPoint);
+		static VDUniformBindingRef	create(const std::string &blockName = "VDUniforms", GLuint bindingPoint = 0) { return std::make_shared<VDUniformBinding>(blockName, bindingPoint); }
+
+		// declaration order is the std140 member order of the block
+		int				addFloat(const std::string &name, float value = 0.0f);
+		int				addVec3(const std::string &name, const ci::vec3 &value = ci::vec3(0));
+		int				addInt(const std::string &name, int value = 0);
+		// float mirrored from VDSession::getFloatUniformValueByIndex on every pull()
+		int				addSessionFloat(const std::string &name, unsigned int sessionIndex);
+
+		void			setFloat(int index, float value);
+		void			setVec3(int index, const ci::vec3 &value);
+		void			setInt(int index, int value);
+		float			getFloat(int index) const;
+		// copies the session floats in, one batch over the registered indices
+		void			pull(const VDSessionRef &session);
+		// the values, for batch access by slot; slots follow declaration order per type
+		VDUniformStore&	getStore() { return mStore; }
+
+		// uploads what changed for this program, which must be in use (VDScopedProgram)
+		void			apply(const VDShaderProgramRef &program);
+
+		int				getIndex(const std::string &name) const;
+		size_t			getCount() const { return mEntries.size(); }
+		// bumped every time the value changes, lets callers skip work on unchanged uniforms
+		uint32_t		getVersion(int index) const { return mStore.getVersion(mEntries[index].type, mEntries[index].slot); }
+		uint64_t		getUploadCount() const { return mUploads; }
+	private:
+		typedef VDUniformStore::Type Type;
+		struct Entry {
+			std::string		name;
+			Type			type;
+			int				slot;		// in the store array of its type
+			size_t			offset;		// std140 offset in mData
+			size_t			size;
+			int				sessionIndex;
+		};
+		struct Program {
+			std::weak_ptr<VDShaderProgram>	program;
+			uint64_t				id;
+			bool					usesBlock;
+			std::vector<GLint>		locations;
+			std::vector<uint32_t>	versions;	// last value uploaded per entry
+		};
+
+		int				add(const std::string &name, Type type, int slot, size_t size, size_t alignment, const void *value);
+		// packs the changed runs of the store into mData
+		void			sync();
+		Program&		resolve(const VDShaderProgramRef &program);
+
+		std::string				mBlockName;
+		GLuint					mBindingPoint;
+		std::vector<Entry>		mEntries;
+		VDUniformStore			mStore;
+		// entry index per store slot, per type
+		std::vector<int>		mSlotEntries[VDUniformStore::TYPE_COUNT];
+		std::vector<int>		mSessionSlots;
+		std::vector<unsigned int>	mSessionIndices;
+		std::vector<float>		mSessionValues;
+		std::vector<uint8_t>	mData;
+		size_t					mDirtyBegin, mDirtyEnd;
+		// largest GL_UNIFORM_BLOCK_DATA_SIZE of the programs seen, the Ubo is at least this big
+		size_t					mBlockSize;
+		ci::gl::UboRef			mUbo;
+		std::vector<Program>	mPrograms;
+		uint64_t				mUploads;
+	};
+}
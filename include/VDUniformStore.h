@@ -0,0 +1,102 @@
+#pragma once
+
+#include "cinder/Cinder.h"
+#include "cinder/Vector.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace videodromm
+{
+	// stores the pointer to the VDUniformStore instance
+	typedef std::shared_ptr<class VDUniformStore> VDUniformStoreRef;
+
+	// Uniform values as structure of arrays: one contiguous array per type, each with a
+	// change version per slot and a dirty bit per slot.
+	// Setters only mark slots whose value actually changed, so many animated parameters
+	// can be written in one batch and the consumer visits just the changed runs.
+	// Dirty bits belong to one consumer (clearDirty); others compare versions.
+	class VDUniformStore {
+	public:
+		enum Type { FLOAT, VEC3, INT, TYPE_COUNT };
+
+		VDUniformStore() {}
+		static VDUniformStoreRef	create() { return std::make_shared<VDUniformStore>(); }
+
+		// returns the slot in the array of that type
+		int					addFloat(float value = 0.0f) { return mFloats.add(value); }
+		int					addVec3(const ci::vec3 &value = ci::vec3(0)) { return mVec3s.add(value); }
+		int					addInt(int value = 0) { return mInts.add(value); }
+
+		void				setFloat(int slot, float value) { mFloats.set(slot, value); }
+		void				setVec3(int slot, const ci::vec3 &value) { mVec3s.set(slot, value); }
+		void				setInt(int slot, int value) { mInts.set(slot, value); }
+		float				getFloat(int slot) const { return mFloats.values[slot]; }
+		const ci::vec3&		getVec3(int slot) const { return mVec3s.values[slot]; }
+		int					getInt(int slot) const { return mInts.values[slot]; }
+
+		// batches over consecutive slots
+		void				setFloats(int first, const float *values, size_t count) { mFloats.set(first, values, count); }
+		void				setVec3s(int first, const ci::vec3 *values, size_t count) { mVec3s.set(first, values, count); }
+		void				setInts(int first, const int *values, size_t count) { mInts.set(first, values, count); }
+		void				getFloats(int first, float *values, size_t count) const { mFloats.get(first, values, count); }
+		void				getVec3s(int first, ci::vec3 *values, size_t count) const { mVec3s.get(first, values, count); }
+		void				getInts(int first, int *values, size_t count) const { mInts.get(first, values, count); }
+		// batch over scattered slots
+		void				setFloats(const int *slots, const float *values, size_t count) { mFloats.set(slots, values, count); }
+		// the whole array, for uploads straight from the store
+		const float*		getFloatData() const { return mFloats.values.data(); }
+		const ci::vec3*		getVec3Data() const { return mVec3s.values.data(); }
+		const int*			getIntData() const { return mInts.values.data(); }
+
+		size_t				getCount(Type type) const;
+		// bumped every time the value changes
+		uint32_t			getVersion(Type type, int slot) const;
+		// any slot in [first, first + count) changed since clearDirty()
+		bool				isDirty(Type type, int first, size_t count = 1) const;
+		bool				isDirty() const;
+		// fn(first, count) for every run of changed slots, in slot order
+		void				forEachDirtyRange(Type type, const std::function<void(int first, int count)> &fn) const;
+		void				clearDirty();
+	private:
+		template<typename T>
+		struct Array {
+			std::vector<T>			values;
+			std::vector<uint32_t>	versions;
+			std::vector<uint64_t>	dirty;	// one bit per slot
+
+			int		add(const T &value) {
+				int slot = (int)values.size();
+				values.push_back(value);
+				versions.push_back(1);
+				if ((size_t)(slot >> 6) >= dirty.size()) dirty.push_back(0);
+				// new slots start dirty, the consumer has not seen them yet
+				dirty[slot >> 6] |= 1ull << (slot & 63);
+				return slot;
+			}
+			void	set(int slot, const T &value) {
+				if (values[slot] == value) return;
+				values[slot] = value;
+				versions[slot]++;
+				dirty[slot >> 6] |= 1ull << (slot & 63);
+			}
+			void	set(int first, const T *source, size_t count) {
+				for (size_t i = 0; i < count; i++) set(first + (int)i, source[i]);
+			}
+			void	set(const int *slots, const T *source, size_t count) {
+				for (size_t i = 0; i < count; i++) set(slots[i], source[i]);
+			}
+			void	get(int first, T *target, size_t count) const {
+				std::copy(values.begin() + first, values.begin() + first + count, target);
+			}
+		};
+
+		const std::vector<uint64_t>&	getDirtyBits(Type type) const;
+
+		Array<float>		mFloats;
+		Array<ci::vec3>		mVec3s;
+		Array<int>			mInts;
+	};
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace videodromm
+{
+	// stores the pointer to the VDWorkerPool instance
+	typedef std::shared_ptr<class VDWorkerPool> VDWorkerPoolRef;
+
+	// Persistent threads for data-parallel pixel work (scaling, effects, compression).
+	// parallelFor may be called from several threads at once, the caller runs
+	// its share of the work instead of sleeping.
+	class VDWorkerPool {
+	public:
+		VDWorkerPool(const std::string &name, size_t threadCount);
+		~VDWorkerPool();
+		// threadCount 0: one per hardware thread, minus the caller
+		static VDWorkerPoolRef	create(const std::string &name, size_t threadCount = 0) { return std::make_shared<VDWorkerPool>(name, threadCount); }
+
+		// splits [0, count) into up to getConcurrency() chunks, returns when all ran
+		void					parallelFor(size_t count, const std::function<void(size_t begin, size_t end)> &fn);
+		// threads available to a parallelFor, caller included
+		size_t					getConcurrency() const { return mThreads.size() + 1; }
+		const std::string&		getName() const { return mName; }
+	private:
+		struct Batch;
+		struct Task {
+			Batch	*batch;
+			size_t	begin, end;
+		};
+
+		void							run();
+		static void						execute(const Task &task);
+
+		std::string						mName;
+		std::vector<std::thread>		mThreads;
+		std::deque<Task>				mTasks;
+		std::mutex						mMutex;
+		std::condition_variable			mCondition;
+		bool							mRunning;
+	};
+}
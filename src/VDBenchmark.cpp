@@ -0,0 +1,70 @@
+#include "VDBenchmark.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <limits>
+
+using namespace videodromm;
+
+namespace {
+	double milliseconds(std::chrono::steady_clock::duration duration)
+	{
+		return std::chrono::duration<double, std::milli>(duration).count();
+	}
+}
+
+VDBenchmark::VDBenchmark(int frames, int warmup)
+	: mFrames(std::max(frames, 1))
+	, mWarmup(std::max(warmup, 0))
+	, mWarmed(0)
+	, mMeasured(0)
+	, mRunning(false)
+	, mFrameMin(std::numeric_limits<double>::max())
+	, mFrameMax(0.0)
+{
+}
+void VDBenchmark::start()
+{
+	mRunning = true;
+}
+void VDBenchmark::beginFrame()
+{
+	mFrameBegin = Clock::now();
+	if (isMeasuring() && mMeasured == 0) mFirstFrame = mFrameBegin;
+}
+void VDBenchmark::endFrame()
+{
+	if (!mRunning || isDone()) return;
+	if (mWarmed < mWarmup) {
+		mWarmed++;
+		return;
+	}
+	mLastFrame = Clock::now();
+	double ms = milliseconds(mLastFrame - mFrameBegin);
+	mFrameMin = std::min(mFrameMin, ms);
+	mFrameMax = std::max(mFrameMax, ms);
+	mMeasured++;
+}
+double VDBenchmark::getSeconds() const
+{
+	return mMeasured > 0 ? milliseconds(mLastFrame - mFirstFrame) / 1000.0 : 0.0;
+}
+double VDBenchmark::getFps() const
+{
+	double seconds = getSeconds();
+	return seconds > 0.0 ? mMeasured / seconds : 0.0;
+}
+std::string VDBenchmark::report() const
+{
+	std::string text;
+	char line[160];
+	std::snprintf(line, sizeof(line), "%-12s %10s %10s %10s\n", "", "mean ms", "min ms", "max ms");
+	text += line;
+	if (mMeasured > 0) {
+		std::snprintf(line, sizeof(line), "%-12s %10.3f %10.3f %10.3f\n", "frame", getSeconds() * 1000.0 / mMeasured, mFrameMin, mFrameMax);
+		text += line;
+	}
+	std::snprintf(line, sizeof(line), "%d frames in %.3f s, %.1f fps\n", mMeasured, getSeconds(), getFps());
+	text += line;
+	return text;
+}
@@ -0,0 +1,178 @@
+#include "VDChangeDetector.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace ci;
+using namespace videodromm;
+
+namespace {
+	const char *vertexShader = R"(
+#version 150
+uniform mat4	ciModelViewProjection;
+in vec4			ciPosition;
+void main() {
+	gl_Position = ciModelViewProjection * ciPosition;
+}
+)";
+	const char *fragmentShader = R"(
+#version 150
+uniform sampler2D	uTex0;
+uniform ivec2		uCell;
+out vec4			oColor;
+void main() {
+	ivec2 origin = ivec2(gl_FragCoord.xy) * uCell;
+	ivec2 end = min(origin + uCell, textureSize(uTex0, 0));
+	float count = float(uCell.x * uCell.y);
+	vec4 sum = vec4(0.0);
+	for (int y = origin.y; y < end.y; y++) {
+		for (int x = origin.x; x < end.x; x++) {
+			vec3 c = texelFetch(uTex0, ivec2(x, y), 0).rgb;
+			// luma weighted by position, so content moving within a cell counts too
+			float position = float((y - origin.y) * uCell.x + x - origin.x) / count;
+			sum += vec4(c, dot(c, vec3(0.299, 0.587, 0.114)) * (1.0 + position));
+		}
+	}
+	oColor = sum;
+}
+)";
+	const uint64_t K = 0x9E3779B97F4A7C15ULL;
+
+	inline uint64_t mix(uint64_t h)
+	{
+		h ^= h >> 32;
+		h *= K;
+		h ^= h >> 29;
+		return h;
+	}
+}
+
+VDChangeDetector::VDChangeDetector(const Format &format)
+	: mFormat(format)
+	, mSignature(0)
+	, mFrames(0)
+	, mTextureFrames(0)
+{
+	mFormat.mTiles = glm::max(mFormat.mTiles, ivec2(1));
+	mFormat.mTileSize = std::max(mFormat.mTileSize, 1);
+	mFormat.mSignatureSize = glm::max(mFormat.mSignatureSize, ivec2(1));
+	mFormat.mRefresh = std::max(mFormat.mRefresh, 1);
+	for (int i = 0; i < 2; i++) {
+		mSumsFrame[i] = 0;
+		mSumsSize[i] = ivec2(0);
+	}
+}
+uint64_t VDChangeDetector::hashBytes(const void *data, size_t bytes, uint64_t seed)
+{
+	const uint8_t *p = static_cast<const uint8_t*>(data);
+	// two independent lanes, the multiplies overlap
+	uint64_t a = seed, b = seed ^ K;
+	size_t i = 0;
+	for (; i + 16 <= bytes; i += 16) {
+		uint64_t x, y;
+		std::memcpy(&x, p + i, 8);
+		std::memcpy(&y, p + i + 8, 8);
+		a = (a ^ x) * K;
+		b = (b ^ y) * K;
+		a ^= a >> 32;
+		b ^= b >> 29;
+	}
+	for (; i < bytes; i++) {
+		a = (a ^ p[i]) * K;
+	}
+	return mix(a ^ (b << 31 | b >> 33) ^ bytes);
+}
+bool VDChangeDetector::equalTiles(const VDFrameBuffer &a, const VDFrameBuffer &b, const ivec2 &tiles, int32_t tileSize, uint32_t phase)
+{
+	const int32_t width = a.getWidth(), height = a.getHeight();
+	for (int32_t ty = 0; ty < tiles.y; ty++) {
+		int32_t y0 = (int32_t)((int64_t)ty * height / tiles.y);
+		int32_t y1 = (int32_t)((int64_t)(ty + 1) * height / tiles.y);
+		int32_t tileHeight = std::min(tileSize, y1 - y0);
+		for (int32_t tx = 0; tx < tiles.x; tx++) {
+			int32_t x0 = (int32_t)((int64_t)tx * width / tiles.x);
+			int32_t x1 = (int32_t)((int64_t)(tx + 1) * width / tiles.x);
+			int32_t tileWidth = std::min(tileSize, x1 - x0);
+			if (tileWidth <= 0 || tileHeight <= 0) continue;
+			// one of 8 x 8 places in the cell, a different one per cell and per phase
+			uint32_t place = ((uint32_t)tx * 73856093u ^ (uint32_t)ty * 19349663u ^ phase * 83492791u) * 0x9E3779B1u;
+			int32_t x = x0 + (x1 - x0 - tileWidth) * (int32_t)(place >> 29) / 7;
+			int32_t y = y0 + (y1 - y0 - tileHeight) * (int32_t)(place >> 26 & 7) / 7;
+			for (int32_t row = y; row < y + tileHeight; row++) {
+				if (std::memcmp(a.getData() + row * a.getRowBytes() + x * 4, b.getData() + row * b.getRowBytes() + x * 4, (size_t)tileWidth * 4) != 0) return false;
+			}
+		}
+	}
+	return true;
+}
+bool VDChangeDetector::equalFrames(const VDFrameBuffer &a, const VDFrameBuffer &b)
+{
+	for (int32_t row = 0; row < a.getHeight(); row++) {
+		if (std::memcmp(a.getData() + row * a.getRowBytes(), b.getData() + row * b.getRowBytes(), (size_t)a.getWidth() * 4) != 0) return false;
+	}
+	return true;
+}
+uint64_t VDChangeDetector::signature(const VDFrameHandle &frame)
+{
+	if (!frame) return 0;
+	mFrames++;
+	bool same = mReference && mReference->getWidth() == frame->getWidth() && mReference->getHeight() == frame->getHeight()
+		&& mReference->getChannelOrder().getCode() == frame->getChannelOrder().getCode();
+	// a source repeating its buffer is the same frame without looking
+	if (same && mReference.get() != frame.get()) {
+		same = mFrames % (uint64_t)mFormat.mRefresh == 0 ? equalFrames(*mReference, *frame) : equalTiles(*mReference, *frame, mFormat.mTiles, mFormat.mTileSize, (uint32_t)mFrames);
+	}
+	if (!same) {
+		mReference = frame;
+		// only told apart from earlier signatures, the content was compared already
+		mSignature = mix(mFrames ^ K);
+		if (!mSignature) mSignature = 1;
+	}
+	return mSignature;
+}
+uint64_t VDChangeDetector::signature(const gl::Texture2dRef &texture)
+{
+	if (!texture) return 0;
+	const size_t bytes = (size_t)mFormat.mSignatureSize.x * mFormat.mSignatureSize.y * 4 * sizeof(float);
+	if (!mGlsl) {
+		mGlsl = gl::GlslProg::create(gl::GlslProg::Format().vertex(vertexShader).fragment(fragmentShader));
+		mGlsl->uniform("uTex0", 0);
+		gl::Fbo::Format format;
+		format.colorTexture(gl::Texture2d::Format().internalFormat(GL_RGBA32F).minFilter(GL_NEAREST).magFilter(GL_NEAREST)).disableDepth();
+		mTarget = gl::Fbo::create(mFormat.mSignatureSize.x, mFormat.mSignatureSize.y, format);
+		for (auto &sums : mSums) sums = gl::Pbo::create(GL_PIXEL_PACK_BUFFER, bytes, nullptr, GL_STREAM_READ);
+	}
+	const ivec2 size = mTarget->getSize();
+	ivec2 cell = (texture->getSize() + size - ivec2(1)) / size;
+	const uint64_t frame = mTextureFrames++;
+	const int write = (int)(frame & 1), read = write ^ 1;
+	{
+		gl::ScopedFramebuffer scpFb(mTarget);
+		gl::ScopedViewport scpVp(ivec2(0), size);
+		gl::ScopedMatrices scpMat;
+		gl::setMatricesWindow(size);
+		gl::ScopedDepth scpDepth(false);
+		gl::ScopedBlend scpBlend(false);
+		gl::ScopedTextureBind scpTex(texture, 0);
+		gl::ScopedGlslProg scpGlsl(mGlsl);
+		mGlsl->uniform("uCell", cell);
+		gl::drawSolidRect(Rectf(mTarget->getBounds()));
+		// into the buffer, the copy is queued behind the draw and nothing waits for it
+		gl::ScopedBuffer scpSums(mSums[write]);
+		glPixelStorei(GL_PACK_ALIGNMENT, 4);
+		glReadPixels(0, 0, size.x, size.y, GL_RGBA, GL_FLOAT, nullptr);
+	}
+	mSumsFrame[write] = frame + 1;
+	mSumsSize[write] = texture->getSize();
+	// the previous call's sums, finished while that frame was shown; a gap in the calls or
+	// a new size leaves nothing to go by
+	if (frame == 0 || mSumsFrame[read] != frame || mSumsSize[read] != texture->getSize()) return 0;
+	gl::ScopedBuffer scpSums(mSums[read]);
+	const void *sums = mSums[read]->mapBufferRange(0, bytes, GL_MAP_READ_BIT);
+	if (!sums) return 0;
+	uint64_t h = hashBytes(sums, bytes, mix((uint64_t)mSumsSize[read].x << 32 | (uint32_t)mSumsSize[read].y));
+	mSums[read]->unmap();
+	// a forced change once per refresh period, in case the sums matched for different content
+	h = mix(h ^ ((frame - 1) / (uint64_t)mFormat.mRefresh));
+	return h ? h : 1;
+}
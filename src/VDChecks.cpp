@@ -0,0 +1,306 @@
+#include "VDChecks.h"
+
+#include "cinder/Log.h"
+#include "cinder/Utilities.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include <thread>
+
+#include "VDFramePool.h"
+#include "VDFrameQueue.h"
+#include "VDFrameSink.h"
+#include "VDLoadGenerator.h"
+#include "VDMetadataChannel.h"
+#include "VDNDIOutput.h"
+#include "VDTileCodec.h"
+#include "VDUniformStore.h"
+
+using namespace ci;
+using namespace videodromm;
+
+namespace {
+	typedef std::chrono::steady_clock Clock;
+
+	double milliseconds(Clock::duration duration)
+	{
+		return std::chrono::duration<double, std::milli>(duration).count();
+	}
+	std::string format(const char *fmt, ...)
+	{
+		char text[256];
+		va_list args;
+		va_start(args, fmt);
+		std::vsnprintf(text, sizeof(text), fmt, args);
+		va_end(args);
+		return text;
+	}
+	// polls until done() or the timeout, false on timeout
+	bool waitFor(const std::function<bool()> &done, double seconds)
+	{
+		auto deadline = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds));
+		while (!done()) {
+			if (Clock::now() > deadline) return false;
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		return true;
+	}
+}
+
+VDChecks::VDChecks()
+{
+	add("ndi-queue", &VDChecks::ndiQueue);
+	add("ndi-adaptive", &VDChecks::ndiAdaptive);
+	add("metadata-bench", &VDChecks::metadataBench);
+	add("uniform-store-bench", &VDChecks::uniformStoreBench);
+	add("codec-bench", &VDChecks::codecBench);
+}
+void VDChecks::add(const std::string &name, const Check &check)
+{
+	mChecks.push_back(std::make_pair(name, check));
+}
+std::vector<std::string> VDChecks::getNames() const
+{
+	std::vector<std::string> names;
+	for (const auto &check : mChecks) names.push_back(check.first);
+	return names;
+}
+int VDChecks::run(const std::vector<std::string> &names, std::string &report) const
+{
+	bool all = std::find(names.begin(), names.end(), "all") != names.end();
+	int failures = 0;
+	for (const auto &name : names) {
+		if (name == "all") continue;
+		auto it = std::find_if(mChecks.begin(), mChecks.end(), [&name](const std::pair<std::string, Check> &check) { return check.first == name; });
+		if (it == mChecks.end()) {
+			report += "FAIL unknown check " + name + "\n";
+			failures++;
+		}
+	}
+	for (const auto &check : mChecks) {
+		if (!all && std::find(names.begin(), names.end(), check.first) == names.end()) continue;
+		Result result = check.second();
+		report += "[" + check.first + "]\n" + result.report + (result.passed ? "PASS\n" : "FAILED\n");
+		if (!result.passed) failures++;
+	}
+	return failures;
+}
+
+VDChecks::Result VDChecks::ndiQueue()
+{
+	Result result;
+	// the queue on its own: what each policy keeps of 5 frames into 3 slots
+	for (VDDropPolicy policy : { VDDropPolicy::DropOldest, VDDropPolicy::DropNewest }) {
+		VDFrameQueue<int> queue(3, policy);
+		size_t dropped = 0, droppedTotal = 0;
+		for (int i = 1; i <= 5; i++) {
+			int item = i;
+			queue.push(std::move(item), dropped);
+			droppedTotal += dropped;
+		}
+		int first = 0, last = 0, count = 0;
+		for (int item; queue.tryPop(item); count++) {
+			if (count == 0) first = item;
+			last = item;
+		}
+		bool oldest = policy == VDDropPolicy::DropOldest;
+		if (count != 3 || droppedTotal != 2 || first != (oldest ? 3 : 1) || last != (oldest ? 5 : 3)) {
+			result.fail(format("%s kept %d frames %d..%d, dropped %d", oldest ? "drop-oldest" : "drop-newest", count, first, last, (int)droppedTotal));
+		}
+	}
+
+	// a producer at 500 fps into a sink that takes 20 ms per frame
+	VDFramePoolRef pool = VDFramePool::create("check");
+	VDMockSinkRef sink = VDMockSink::create("slow", 20);
+	VDNDIOutputRef output = VDNDIOutput::create(sink, VDNDIOutput::Format().queueSize(3).dropPolicy(VDDropPolicy::DropOldest));
+	const int frames = 100;
+	double pushMax = 0.0;
+	for (int i = 1; i <= frames; i++) {
+		VDFrameHandle frame = pool->acquire(64, 64);
+		auto start = Clock::now();
+		output->push(frame, i);
+		pushMax = std::max(pushMax, milliseconds(Clock::now() - start));
+		if (output->getQueueDepth() > 3) result.fail(format("queue depth %d above its capacity", (int)output->getQueueDepth()));
+		std::this_thread::sleep_for(std::chrono::milliseconds(2));
+	}
+	bool drained = waitFor([&] { return output->getSentCount() + output->getDroppedCount() >= (uint64_t)frames; }, 2.0);
+	output->stop();
+	result.line(format("pushed %d sent %llu dropped %llu, push max %.3f ms, pool buffers %llu", frames, (unsigned long long)output->getSentCount(), (unsigned long long)output->getDroppedCount(), pushMax, (unsigned long long)pool->getStats().allocations));
+	if (!drained || output->getSentCount() + output->getDroppedCount() != (uint64_t)frames) result.fail("frames neither sent nor counted as dropped");
+	if (output->getDroppedCount() == 0) result.fail("a 20 ms sink kept up with 500 fps");
+	// a sleep in push would show up as the sink's 20 ms
+	if (pushMax > 5.0) result.fail("push blocked on the sink");
+	if (sink->getLastTimecode() != frames) result.fail(format("last frame sent %lld, not the newest", sink->getLastTimecode()));
+	if (sink->getFramesReceived() != output->getSentCount()) result.fail("sink and output disagree on frames sent");
+	return result;
+}
+VDChecks::Result VDChecks::ndiAdaptive()
+{
+	Result result;
+	// 25 ms per send against a 60 fps budget, pushed at 250 fps
+	VDFramePoolRef pool = VDFramePool::create("check");
+	VDMockSinkRef sink = VDMockSink::create("slow", 25);
+	VDNDIOutputRef output = VDNDIOutput::create(sink, VDNDIOutput::Format().queueSize(3).dropPolicy(VDDropPolicy::DropOldest).adaptive(VDOutputController::Format()));
+	const int frames = 300, lastMetadata = frames - 9;
+	int payloads = 0;
+	for (int i = 1; i <= frames; i++) {
+		// every 7th frame, so payloads land on skipped frames too
+		std::shared_ptr<XmlTree> metadata;
+		if (i % 7 == 0 && i <= lastMetadata) {
+			metadata = std::make_shared<XmlTree>("ci_meta", toString(i));
+			payloads++;
+		}
+		output->push(pool->acquire(64, 64), i, metadata);
+		std::this_thread::sleep_for(std::chrono::milliseconds(4));
+	}
+	bool drained = waitFor([&] { return output->getSentCount() + output->getDroppedCount() >= output->getEnqueuedCount(); }, 2.0);
+	VDOutputController::Level level = output->getController()->getLevel();
+	output->stop();
+	result.line(format("pushed %d skipped %llu sent %llu dropped %llu, level %s, metadata %d pushed %llu received, last with frame %lld",
+		frames, (unsigned long long)output->getSkippedCount(), (unsigned long long)output->getSentCount(), (unsigned long long)output->getDroppedCount(),
+		VDOutputController::getLevelName(level), payloads, (unsigned long long)sink->getMetadataReceived(), sink->getLastMetadataTimecode()));
+	if (!drained) result.fail("output did not drain");
+	if (level == VDOutputController::FULL || output->getSkippedCount() == 0) result.fail("a 25 ms sink did not degrade the stream");
+	if (sink->getMetadataReceived() == 0) result.fail("no metadata reached the sink");
+	// the newest payload goes out with its own frame or one after it, never before
+	if (sink->getLastMetadataTimecode() < lastMetadata / 7 * 7) result.fail("the newest metadata was lost");
+	if (sink->getMetadataReceived() > (uint64_t)payloads) result.fail("metadata sent more than once");
+	return result;
+}
+VDChecks::Result VDChecks::metadataBench()
+{
+	Result result;
+	// the app's fields: a few strings, uniforms and luma stats
+	VDMetadataChannelRef channel = VDMetadataChannel::create("ci_meta", 1.0);
+	std::vector<int> fields, uniforms;
+	for (int i = 0; i < 12; i++) fields.push_back(channel->addField("field" + toString(i)));
+	for (int i = 0; i < 8; i++) uniforms.push_back(channel->addUniform("iUniform" + toString(i)));
+	const int frames = 20000;
+	auto run = [&](bool changing, uint64_t &sends) {
+		uint64_t before = channel->getSendCount();
+		auto start = Clock::now();
+		for (int frame = 0; frame < frames; frame++) {
+			int value = changing ? frame + 1 : 0;
+			for (int index : fields) channel->set(index, value);
+			for (int index : uniforms) channel->set(index, 0.5f + value * 0.001f);
+			// the clock stands still, the keep-alive never comes due inside a run;
+			// a returned payload is serialized as the sender would
+			std::shared_ptr<XmlTree> payload = channel->poll(1.0);
+			if (payload) {
+				std::ostringstream stream;
+				stream << *payload;
+			}
+		}
+		sends = channel->getSendCount() - before;
+		return milliseconds(Clock::now() - start) * 1.0e6 / frames;
+	};
+	// the behaviour the channel replaced: a new tree built and serialized every frame,
+	// once with the fps string alone and once carrying the same fields
+	auto baseline = [&](bool withFields) {
+		auto start = Clock::now();
+		for (int frame = 0; frame < frames; frame++) {
+			std::string fps = toString(60 + frame % 2);
+			std::shared_ptr<XmlTree> metadata = std::make_shared<XmlTree>("ci_meta", fps + " fps VDViz");
+			if (withFields) {
+				for (size_t i = 0; i < fields.size(); i++) metadata->push_back(XmlTree("field" + toString(i), toString(frame)));
+				for (size_t i = 0; i < uniforms.size(); i++) metadata->push_back(XmlTree("iUniform" + toString(i), toString(0.5f + frame * 0.001f)));
+			}
+			std::ostringstream stream;
+			stream << *metadata;
+		}
+		return milliseconds(Clock::now() - start) * 1.0e6 / frames;
+	};
+	double baselineNs = baseline(false);
+	double baselineFieldsNs = baseline(true);
+	uint64_t sends = 0;
+	// settle the payload once, so the unchanged run starts clean
+	run(false, sends);
+	uint64_t rebuilds = channel->getRebuildCount();
+	double unchangedNs = run(false, sends);
+	uint64_t unchangedRebuilds = channel->getRebuildCount() - rebuilds;
+	uint64_t unchangedSends = sends;
+	rebuilds = channel->getRebuildCount();
+	double changingNs = run(true, sends);
+	result.line(format("per-frame XmlTree baseline: fps only %.0f ns/frame, %d fields %.0f ns/frame",
+		baselineNs, (int)(fields.size() + uniforms.size()), baselineFieldsNs));
+	result.line(format("%d fields, %d frames: unchanged %.0f ns/frame (%llu rebuilds, %llu sends), changing %.0f ns/frame (%llu rebuilds)",
+		(int)(fields.size() + uniforms.size()), frames, unchangedNs, (unsigned long long)unchangedRebuilds, (unsigned long long)unchangedSends,
+		changingNs, (unsigned long long)(channel->getRebuildCount() - rebuilds)));
+	if (unchangedRebuilds != 0 || unchangedSends != 0) result.fail("unchanged fields rebuilt or sent the payload");
+	if (channel->getRebuildCount() - rebuilds != (uint64_t)frames) result.fail("changing fields did not rebuild every frame");
+	return result;
+}
+VDChecks::Result VDChecks::uniformStoreBench()
+{
+	Result result;
+	for (int count : { 1000, 10000, 100000 }) {
+		VDUniformStore store;
+		for (int i = 0; i < count; i++) store.addFloat(0.0f);
+		store.clearDirty();
+		// every 4th slot animated, written in one scattered batch
+		std::vector<int> slots;
+		for (int i = 0; i < count; i += 4) slots.push_back(i);
+		std::vector<float> values(slots.size());
+		const int frames = 200;
+		int visited = 0;
+		bool exact = true;
+		auto start = Clock::now();
+		for (int frame = 1; frame <= frames; frame++) {
+			for (size_t i = 0; i < values.size(); i++) values[i] = frame + i * 0.001f;
+			store.setFloats(slots.data(), values.data(), slots.size());
+			visited = 0;
+			store.forEachDirtyRange(VDUniformStore::FLOAT, [&](int first, int runLength) {
+				// runs of one, the animated slots are not adjacent
+				if (runLength != 1 || first % 4 != 0) exact = false;
+				visited += runLength;
+			});
+			store.clearDirty();
+		}
+		double storeMs = milliseconds(Clock::now() - start) / frames;
+		// a frame where nothing moved: the walk only reads the dirty words
+		start = Clock::now();
+		for (int frame = 0; frame < frames; frame++) {
+			store.setFloats(slots.data(), values.data(), slots.size());
+			store.forEachDirtyRange(VDUniformStore::FLOAT, [&](int first, int runLength) { exact = false; });
+			store.clearDirty();
+		}
+		double idleMs = milliseconds(Clock::now() - start) / frames;
+		result.line(format("%d parameters, %d animated: %.4f ms/frame (%.1f ns per animated parameter), unchanged %.4f ms/frame",
+			count, (int)slots.size(), storeMs, storeMs * 1.0e6 / slots.size(), idleMs));
+		if (!exact || visited != (int)slots.size()) result.fail(format("%d parameters: %d slots visited for %d changed", count, visited, (int)slots.size()));
+	}
+	return result;
+}
+VDChecks::Result VDChecks::codecBench()
+{
+	Result result;
+	const int32_t width = 1920, height = 1080;
+	const ptrdiff_t rowBytes = (ptrdiff_t)width * 4;
+	const double megabytes = (double)rowBytes * height / (1024.0 * 1024.0);
+	VDWorkerPoolRef workers = VDWorkerPool::create("codec");
+	std::vector<uint8_t> input((size_t)rowBytes * height), output(input.size()), payload;
+	for (VDLoadPattern pattern : { VDLoadPattern::Gradient, VDLoadPattern::Noise }) {
+		VDLoadGenerator::fillPattern(pattern, 0, input.data(), rowBytes, width, height);
+		const int frames = 10;
+		auto start = Clock::now();
+		for (int frame = 0; frame < frames; frame++) {
+			VDTileCodec::encode(input.data(), rowBytes, width, height, payload, workers.get());
+		}
+		double encodeMs = milliseconds(Clock::now() - start) / frames;
+		bool decoded = true;
+		start = Clock::now();
+		for (int frame = 0; frame < frames; frame++) {
+			decoded = VDTileCodec::decode(payload.data(), payload.size(), width, height, output.data(), rowBytes, workers.get()) && decoded;
+		}
+		double decodeMs = milliseconds(Clock::now() - start) / frames;
+		result.line(format("%s %dx%d: ratio %.2f, encode %.2f ms %.0f MB/s, decode %.2f ms %.0f MB/s, %d threads",
+			VDLoadGenerator::getPatternName(pattern), width, height, (double)input.size() / payload.size(),
+			encodeMs, megabytes * 1000.0 / encodeMs, decodeMs, megabytes * 1000.0 / decodeMs, (int)workers->getConcurrency()));
+		if (!decoded || std::memcmp(input.data(), output.data(), input.size()) != 0) result.fail(format("%s does not decode to its input", VDLoadGenerator::getPatternName(pattern)));
+	}
+	return result;
+}
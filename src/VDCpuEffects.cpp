@@ -0,0 +1,233 @@
+#include "VDCpuEffects.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#if defined( _M_X64 ) || defined( _M_IX86 ) || defined( __SSE2__ )
+#define VD_CPUEFFECTS_SSE2
+#include <emmintrin.h>
+#endif
+
+using namespace videodromm;
+
+const float VDCpuEffects::CHROMATIC_SCALE = 0.005f;
+
+namespace {
+	// Rec.601 luma in 7 bits of fraction, the weighted sum of a pixel fits in an int16
+	const int16_t LUMA_B = 15, LUMA_G = 75, LUMA_R = 38;
+
+	// per thread rows, reused across frames
+	struct Scratch {
+		std::vector<int16_t>	luma[3];	// width + 2, edge pixels repeated
+		std::vector<uint8_t>	edge;
+		std::vector<uint8_t>	color;
+		void resize(int32_t width) {
+			for (auto &row : luma) row.resize(width + 2);
+			edge.resize(width);
+			color.resize(width * 4);
+		}
+	};
+	thread_local Scratch tScratch;
+
+	void lumaRow(const uint8_t *in, int16_t *out, int32_t width)
+	{
+		// out[-1] and out[width] are the padding
+		int32_t x = 0;
+#if defined( VD_CPUEFFECTS_SSE2 )
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i weights = _mm_setr_epi16(LUMA_B, LUMA_G, LUMA_R, 0, LUMA_B, LUMA_G, LUMA_R, 0);
+		const __m128i ones = _mm_set1_epi16(1);
+		const __m128i round = _mm_set1_epi32(64);
+		for (; x + 8 <= width; x += 8) {
+			__m128i p0 = _mm_loadu_si128((const __m128i*)(in + x * 4));
+			__m128i p1 = _mm_loadu_si128((const __m128i*)(in + x * 4 + 16));
+			// per pixel (b, g) and (r, a) partial sums, then their total
+			__m128i s0 = _mm_packs_epi32(_mm_madd_epi16(_mm_unpacklo_epi8(p0, zero), weights), _mm_madd_epi16(_mm_unpackhi_epi8(p0, zero), weights));
+			__m128i s1 = _mm_packs_epi32(_mm_madd_epi16(_mm_unpacklo_epi8(p1, zero), weights), _mm_madd_epi16(_mm_unpackhi_epi8(p1, zero), weights));
+			__m128i l0 = _mm_srli_epi32(_mm_add_epi32(_mm_madd_epi16(s0, ones), round), 7);
+			__m128i l1 = _mm_srli_epi32(_mm_add_epi32(_mm_madd_epi16(s1, ones), round), 7);
+			_mm_storeu_si128((__m128i*)(out + x), _mm_packs_epi32(l0, l1));
+		}
+#endif
+		for (; x < width; x++) {
+			const uint8_t *p = in + x * 4;
+			out[x] = (int16_t)((p[0] * LUMA_B + p[1] * LUMA_G + p[2] * LUMA_R + 64) >> 7);
+		}
+		out[-1] = out[0];
+		out[width] = out[width - 1];
+	}
+
+	// 3x3 Sobel magnitude of the luma rows above, at and below, clamped to 255
+	void sobelRow(const int16_t *l0, const int16_t *l1, const int16_t *l2, uint8_t *out, int32_t width)
+	{
+		int32_t x = 0;
+#if defined( VD_CPUEFFECTS_SSE2 )
+		for (; x + 8 <= width; x += 8) {
+			__m128i a0 = _mm_loadu_si128((const __m128i*)(l0 + x - 1));
+			__m128i a1 = _mm_loadu_si128((const __m128i*)(l0 + x));
+			__m128i a2 = _mm_loadu_si128((const __m128i*)(l0 + x + 1));
+			__m128i b0 = _mm_loadu_si128((const __m128i*)(l1 + x - 1));
+			__m128i b2 = _mm_loadu_si128((const __m128i*)(l1 + x + 1));
+			__m128i c0 = _mm_loadu_si128((const __m128i*)(l2 + x - 1));
+			__m128i c1 = _mm_loadu_si128((const __m128i*)(l2 + x));
+			__m128i c2 = _mm_loadu_si128((const __m128i*)(l2 + x + 1));
+			__m128i gx = _mm_sub_epi16(_mm_add_epi16(_mm_add_epi16(a2, c2), _mm_slli_epi16(b2, 1)),
+				_mm_add_epi16(_mm_add_epi16(a0, c0), _mm_slli_epi16(b0, 1)));
+			__m128i gy = _mm_sub_epi16(_mm_add_epi16(_mm_add_epi16(c0, c2), _mm_slli_epi16(c1, 1)),
+				_mm_add_epi16(_mm_add_epi16(a0, a2), _mm_slli_epi16(a1, 1)));
+			// gx * gx + gy * gy in one multiply-add per 4 pixels
+			__m128i lo = _mm_unpacklo_epi16(gx, gy);
+			__m128i hi = _mm_unpackhi_epi16(gx, gy);
+			__m128i m0 = _mm_cvtps_epi32(_mm_sqrt_ps(_mm_cvtepi32_ps(_mm_madd_epi16(lo, lo))));
+			__m128i m1 = _mm_cvtps_epi32(_mm_sqrt_ps(_mm_cvtepi32_ps(_mm_madd_epi16(hi, hi))));
+			__m128i m = _mm_packs_epi32(m0, m1);
+			_mm_storel_epi64((__m128i*)(out + x), _mm_packus_epi16(m, m));
+		}
+#endif
+		for (; x < width; x++) {
+			int32_t gx = (l0[x + 1] + 2 * l1[x + 1] + l2[x + 1]) - (l0[x - 1] + 2 * l1[x - 1] + l2[x - 1]);
+			int32_t gy = (l2[x - 1] + 2 * l2[x] + l2[x + 1]) - (l0[x - 1] + 2 * l0[x] + l0[x + 1]);
+			long magnitude = std::lrint(std::sqrt((float)(gx * gx + gy * gy)));
+			out[x] = (uint8_t)std::min(magnitude, 255L);
+		}
+	}
+
+	// red from x + shift, blue from x - shift, edges clamped
+	void chromaticRow(const uint8_t *in, uint8_t *out, int32_t width, int32_t shift)
+	{
+		const int32_t reach = std::abs(shift);
+		auto pixel = [&](int32_t x) {
+			const uint8_t *p = in + x * 4;
+			int32_t r = std::min(std::max(x + shift, 0), width - 1);
+			int32_t b = std::min(std::max(x - shift, 0), width - 1);
+			out[x * 4 + 0] = in[b * 4 + 0];
+			out[x * 4 + 1] = p[1];
+			out[x * 4 + 2] = in[r * 4 + 2];
+			out[x * 4 + 3] = p[3];
+		};
+		int32_t x = 0;
+		for (; x < std::min(reach, width); x++) pixel(x);
+#if defined( VD_CPUEFFECTS_SSE2 )
+		const __m128i maskB = _mm_set1_epi32(0x000000ff);
+		const __m128i maskR = _mm_set1_epi32(0x00ff0000);
+		const __m128i maskGA = _mm_set1_epi32((int)0xff00ff00);
+		for (; x + reach + 4 <= width; x += 4) {
+			__m128i center = _mm_loadu_si128((const __m128i*)(in + x * 4));
+			__m128i red = _mm_loadu_si128((const __m128i*)(in + (x + shift) * 4));
+			__m128i blue = _mm_loadu_si128((const __m128i*)(in + (x - shift) * 4));
+			__m128i result = _mm_or_si128(_mm_and_si128(center, maskGA), _mm_or_si128(_mm_and_si128(red, maskR), _mm_and_si128(blue, maskB)));
+			_mm_storeu_si128((__m128i*)(out + x * 4), result);
+		}
+#endif
+		for (; x < width; x++) pixel(x);
+	}
+
+	// out = (colorWeight * color + edgeWeight * edge) / 256, alpha kept, edge may be null
+	void mixRow(const uint8_t *color, const uint8_t *edge, uint8_t *out, int32_t width, int16_t colorWeight, int16_t edgeWeight)
+	{
+		int32_t x = 0;
+#if defined( VD_CPUEFFECTS_SSE2 )
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i weights = _mm_setr_epi16(colorWeight, edgeWeight, colorWeight, edgeWeight, colorWeight, edgeWeight, 256, 0);
+		const __m128i round = _mm_set1_epi32(128);
+		for (; x + 4 <= width; x += 4) {
+			__m128i c = _mm_loadu_si128((const __m128i*)(color + x * 4));
+			__m128i e = zero;
+			if (edge) {
+				// 4 edge bytes, each repeated over the channels of its pixel
+				int32_t packed;
+				std::memcpy(&packed, edge + x, 4);
+				e = _mm_cvtsi32_si128(packed);
+				e = _mm_unpacklo_epi8(e, e);
+				e = _mm_unpacklo_epi16(e, e);
+			}
+			__m128i c0 = _mm_unpacklo_epi8(c, zero), c1 = _mm_unpackhi_epi8(c, zero);
+			__m128i e0 = _mm_unpacklo_epi8(e, zero), e1 = _mm_unpackhi_epi8(e, zero);
+			// (color, edge) pairs per channel, one pixel per multiply-add
+			__m128i p0 = _mm_madd_epi16(_mm_unpacklo_epi16(c0, e0), weights);
+			__m128i p1 = _mm_madd_epi16(_mm_unpackhi_epi16(c0, e0), weights);
+			__m128i p2 = _mm_madd_epi16(_mm_unpacklo_epi16(c1, e1), weights);
+			__m128i p3 = _mm_madd_epi16(_mm_unpackhi_epi16(c1, e1), weights);
+			p0 = _mm_srai_epi32(_mm_add_epi32(p0, round), 8);
+			p1 = _mm_srai_epi32(_mm_add_epi32(p1, round), 8);
+			p2 = _mm_srai_epi32(_mm_add_epi32(p2, round), 8);
+			p3 = _mm_srai_epi32(_mm_add_epi32(p3, round), 8);
+			_mm_storeu_si128((__m128i*)(out + x * 4), _mm_packus_epi16(_mm_packs_epi32(p0, p1), _mm_packs_epi32(p2, p3)));
+		}
+#endif
+		for (; x < width; x++) {
+			const uint8_t *c = color + x * 4;
+			int32_t e = edge ? edge[x] : 0;
+			for (int i = 0; i < 3; i++) {
+				out[x * 4 + i] = (uint8_t)std::min((c[i] * colorWeight + e * edgeWeight + 128) >> 8, 255);
+			}
+			out[x * 4 + 3] = c[3];
+		}
+	}
+}
+
+int32_t VDCpuEffects::chromaticShift(float chromatic, int32_t width)
+{
+	return (int32_t)std::lround(chromatic * CHROMATIC_SCALE * width);
+}
+void VDCpuEffects::process(const VDFrameBuffer &src, VDFrameBuffer &dst, const Params &params, VDWorkerPool *workers)
+{
+	auto band = [&](size_t y0, size_t y1) {
+		processRows(src, dst, params, (int32_t)y0, (int32_t)y1);
+	};
+	if (workers && src.getWidth() * src.getHeight() >= PARALLEL_THRESHOLD) {
+		workers->parallelFor(src.getHeight(), band);
+	}
+	else {
+		band(0, src.getHeight());
+	}
+}
+void VDCpuEffects::processRows(const VDFrameBuffer &src, VDFrameBuffer &dst, const Params &params, int32_t y0, int32_t y1)
+{
+	const int32_t width = src.getWidth();
+	const int32_t height = src.getHeight();
+	const int32_t shift = std::max(-(width - 1), std::min(chromaticShift(params.chromatic, width), width - 1));
+	const float sobel = std::max(0.0f, std::min(params.sobel, 1.0f));
+	const float exposure = std::max(0.0f, std::min(params.exposure, 64.0f));
+	const int16_t colorWeight = (int16_t)std::lround((1.0f - sobel) * exposure * 256.0f);
+	const int16_t edgeWeight = (int16_t)std::lround(sobel * exposure * 256.0f);
+	const size_t rowBytes = width * 4;
+
+	// nothing to do but copy
+	if (shift == 0 && edgeWeight == 0 && colorWeight == 256) {
+		for (int32_t y = y0; y < y1; y++) {
+			std::memcpy(dst.getData() + y * dst.getRowBytes(), src.getData() + y * src.getRowBytes(), rowBytes);
+		}
+		return;
+	}
+
+	Scratch &scratch = tScratch;
+	scratch.resize(width);
+	auto row = [&](int32_t y) {
+		return src.getData() + std::min(std::max(y, 0), height - 1) * src.getRowBytes();
+	};
+	// luma rows above, at and below y, rotated as the band moves down
+	int16_t *luma[3] = { scratch.luma[0].data() + 1, scratch.luma[1].data() + 1, scratch.luma[2].data() + 1 };
+	if (edgeWeight != 0) {
+		lumaRow(row(y0 - 1), luma[0], width);
+		lumaRow(row(y0), luma[1], width);
+	}
+	for (int32_t y = y0; y < y1; y++) {
+		const uint8_t *in = row(y);
+		const uint8_t *color = in;
+		if (shift != 0) {
+			chromaticRow(in, scratch.color.data(), width, shift);
+			color = scratch.color.data();
+		}
+		const uint8_t *edge = nullptr;
+		if (edgeWeight != 0) {
+			lumaRow(row(y + 1), luma[2], width);
+			sobelRow(luma[0], luma[1], luma[2], scratch.edge.data(), width);
+			std::rotate(luma, luma + 1, luma + 3);
+			edge = scratch.edge.data();
+		}
+		mixRow(color, edge, dst.getData() + y * dst.getRowBytes(), width, colorWeight, edgeWeight);
+	}
+}
@@ -0,0 +1,126 @@
+#include "VDDownscaler.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined( _M_X64 ) || defined( _M_IX86 ) || defined( __SSE2__ )
+#define VD_DOWNSCALER_SSE2
+#include <emmintrin.h>
+#endif
+
+using namespace videodromm;
+
+int32_t VDDownscaler::scaledSize(int32_t size, float scale)
+{
+	return std::max(1, (int32_t)std::lround(size * scale));
+}
+void VDDownscaler::downscale(const VDFrameBuffer &src, VDFrameBuffer &dst, VDWorkerPool *workers)
+{
+	int32_t factor = 0;
+	if (src.getWidth() % dst.getWidth() == 0 && src.getHeight() % dst.getHeight() == 0
+		&& src.getWidth() / dst.getWidth() == src.getHeight() / dst.getHeight()) {
+		factor = src.getWidth() / dst.getWidth();
+	}
+	auto band = [&](size_t y0, size_t y1) {
+		if (factor == 2) box2x(src, dst, (int32_t)y0, (int32_t)y1);
+		else if (factor > 2) boxN(src, dst, factor, (int32_t)y0, (int32_t)y1);
+		else bilinear(src, dst, (int32_t)y0, (int32_t)y1);
+	};
+	// the cost is in reading the source, a 4x box reads 16 pixels per output pixel
+	if (workers && src.getWidth() * src.getHeight() >= PARALLEL_THRESHOLD) {
+		workers->parallelFor(dst.getHeight(), band);
+	}
+	else {
+		band(0, dst.getHeight());
+	}
+}
+void VDDownscaler::box2x(const VDFrameBuffer &src, VDFrameBuffer &dst, int32_t y0, int32_t y1)
+{
+	const int32_t width = dst.getWidth();
+	for (int32_t y = y0; y < y1; y++) {
+		const uint8_t *row0 = src.getData() + (2 * y) * src.getRowBytes();
+		const uint8_t *row1 = row0 + src.getRowBytes();
+		uint8_t *out = dst.getData() + y * dst.getRowBytes();
+		int32_t x = 0;
+#if defined( VD_DOWNSCALER_SSE2 )
+		// 8 source pixels per row -> 4 destination pixels
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i round = _mm_set1_epi16(2);
+		for (; x + 4 <= width; x += 4) {
+			__m128i a0 = _mm_loadu_si128((const __m128i*)(row0 + x * 8));
+			__m128i a1 = _mm_loadu_si128((const __m128i*)(row0 + x * 8 + 16));
+			__m128i b0 = _mm_loadu_si128((const __m128i*)(row1 + x * 8));
+			__m128i b1 = _mm_loadu_si128((const __m128i*)(row1 + x * 8 + 16));
+			// vertical sums, two pixels per register
+			__m128i s0 = _mm_add_epi16(_mm_unpacklo_epi8(a0, zero), _mm_unpacklo_epi8(b0, zero));
+			__m128i s1 = _mm_add_epi16(_mm_unpackhi_epi8(a0, zero), _mm_unpackhi_epi8(b0, zero));
+			__m128i s2 = _mm_add_epi16(_mm_unpacklo_epi8(a1, zero), _mm_unpacklo_epi8(b1, zero));
+			__m128i s3 = _mm_add_epi16(_mm_unpackhi_epi8(a1, zero), _mm_unpackhi_epi8(b1, zero));
+			// horizontal sums, the pair ends up in the low half
+			s0 = _mm_add_epi16(s0, _mm_srli_si128(s0, 8));
+			s1 = _mm_add_epi16(s1, _mm_srli_si128(s1, 8));
+			s2 = _mm_add_epi16(s2, _mm_srli_si128(s2, 8));
+			s3 = _mm_add_epi16(s3, _mm_srli_si128(s3, 8));
+			__m128i lo = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(s0, s1), round), 2);
+			__m128i hi = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(s2, s3), round), 2);
+			_mm_storeu_si128((__m128i*)(out + x * 4), _mm_packus_epi16(lo, hi));
+		}
+#endif
+		for (; x < width; x++) {
+			const uint8_t *p0 = row0 + x * 8;
+			const uint8_t *p1 = row1 + x * 8;
+			for (int c = 0; c < 4; c++) {
+				out[x * 4 + c] = (uint8_t)((p0[c] + p0[c + 4] + p1[c] + p1[c + 4] + 2) >> 2);
+			}
+		}
+	}
+}
+void VDDownscaler::boxN(const VDFrameBuffer &src, VDFrameBuffer &dst, int32_t factor, int32_t y0, int32_t y1)
+{
+	const int32_t width = dst.getWidth();
+	const uint32_t area = factor * factor;
+	for (int32_t y = y0; y < y1; y++) {
+		uint8_t *out = dst.getData() + y * dst.getRowBytes();
+		for (int32_t x = 0; x < width; x++) {
+			uint32_t sum[4] = { area / 2, area / 2, area / 2, area / 2 };
+			for (int32_t j = 0; j < factor; j++) {
+				const uint8_t *p = src.getData() + (y * factor + j) * src.getRowBytes() + x * factor * 4;
+				for (int32_t i = 0; i < factor; i++, p += 4) {
+					sum[0] += p[0]; sum[1] += p[1]; sum[2] += p[2]; sum[3] += p[3];
+				}
+			}
+			for (int c = 0; c < 4; c++) {
+				out[x * 4 + c] = (uint8_t)(sum[c] / area);
+			}
+		}
+	}
+}
+void VDDownscaler::bilinear(const VDFrameBuffer &src, VDFrameBuffer &dst, int32_t y0, int32_t y1)
+{
+	// 16.16 fixed point, sample centres aligned like a GL texture lookup
+	const int32_t width = dst.getWidth();
+	const int64_t stepX = ((int64_t)src.getWidth() << 16) / width;
+	const int64_t stepY = ((int64_t)src.getHeight() << 16) / dst.getHeight();
+	const int32_t maxX = src.getWidth() - 1;
+	const int32_t maxY = src.getHeight() - 1;
+	for (int32_t y = y0; y < y1; y++) {
+		int64_t fy = std::max<int64_t>(0, y * stepY + stepY / 2 - 0x8000);
+		int32_t sy = std::min((int32_t)(fy >> 16), maxY);
+		int32_t sy1 = std::min(sy + 1, maxY);
+		uint32_t wy = (uint32_t)(fy & 0xffff) >> 8;
+		const uint8_t *row0 = src.getData() + sy * src.getRowBytes();
+		const uint8_t *row1 = src.getData() + sy1 * src.getRowBytes();
+		uint8_t *out = dst.getData() + y * dst.getRowBytes();
+		for (int32_t x = 0; x < width; x++) {
+			int64_t fx = std::max<int64_t>(0, x * stepX + stepX / 2 - 0x8000);
+			int32_t sx = std::min((int32_t)(fx >> 16), maxX);
+			int32_t sx1 = std::min(sx + 1, maxX);
+			uint32_t wx = (uint32_t)(fx & 0xffff) >> 8;
+			for (int c = 0; c < 4; c++) {
+				uint32_t top = row0[sx * 4 + c] * (256 - wx) + row0[sx1 * 4 + c] * wx;
+				uint32_t bottom = row1[sx * 4 + c] * (256 - wx) + row1[sx1 * 4 + c] * wx;
+				out[x * 4 + c] = (uint8_t)((top * (256 - wy) + bottom * wy + 32768) >> 16);
+			}
+		}
+	}
+}
@@ -0,0 +1,107 @@
+#include "VDFramePacer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+using namespace videodromm;
+
+namespace {
+	double milliseconds(std::chrono::steady_clock::duration duration)
+	{
+		return std::chrono::duration<double, std::milli>(duration).count();
+	}
+	// sleep granularity can be a whole scheduler tick, the rest is yielded away
+	const std::chrono::milliseconds SPIN_WINDOW(2);
+}
+
+VDFramePacer::VDFramePacer(const Format &format)
+	: mFormat(format)
+	, mStarted(false)
+	, mNext(0)
+	, mCount(0)
+	, mPredictedMs(0.0)
+	, mFrames(0)
+	, mSkipped(0)
+{
+	mFormat.mRate = std::max(mFormat.mRate, 1.0);
+	mFormat.mHistory = std::max(mFormat.mHistory, 1);
+	mPeriod = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / mFormat.mRate));
+	mDurations.assign(mFormat.mHistory, 0.0);
+	mLateness.assign(mFormat.mHistory, 0.0);
+	mIntervalErrors.assign(mFormat.mHistory, 0.0);
+}
+void VDFramePacer::sleepUntil(Clock::time_point time) const
+{
+	Clock::time_point now = Clock::now();
+	if (time - now > SPIN_WINDOW) {
+		std::this_thread::sleep_for(time - now - SPIN_WINDOW);
+	}
+	while (Clock::now() < time) {
+		std::this_thread::yield();
+	}
+}
+int VDFramePacer::waitForSlot()
+{
+	Clock::time_point now = Clock::now();
+	if (!mStarted) {
+		mStarted = true;
+		mDeadline = now + mPeriod;
+		mLastDone = now;
+	}
+	Clock::duration predicted = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(mPredictedMs + mFormat.mMarginMs));
+	// a slot that would finish more than half a period late is dropped, the next one
+	// gets a fresher frame instead of both arriving back to back
+	int skipped = 0;
+	while (now + predicted > mDeadline + mPeriod / 2) {
+		mDeadline += mPeriod;
+		skipped++;
+	}
+	mSkipped += skipped;
+	sleepUntil(mDeadline - predicted);
+	mWorkBegin = Clock::now();
+	return skipped;
+}
+void VDFramePacer::frameDone()
+{
+	if (!mStarted) return;
+	Clock::time_point done = Clock::now();
+	mDurations[mNext] = milliseconds(done - mWorkBegin);
+	mLateness[mNext] = milliseconds(done - mDeadline);
+	mIntervalErrors[mNext] = mFrames > 0 ? std::abs(milliseconds(done - mLastDone) - milliseconds(mPeriod)) : 0.0;
+	mNext = (mNext + 1) % mDurations.size();
+	mCount = std::min(mCount + 1, mDurations.size());
+	mLastDone = done;
+	mDeadline += mPeriod;
+	mFrames++;
+	predict();
+}
+void VDFramePacer::predict()
+{
+	// 90th percentile: a single slow frame does not pull every start forward,
+	// a run of them does
+	std::vector<double> durations(mDurations.begin(), mDurations.begin() + mCount);
+	size_t rank = (durations.size() * 9) / 10;
+	if (rank >= durations.size()) rank = durations.size() - 1;
+	std::nth_element(durations.begin(), durations.begin() + rank, durations.end());
+	mPredictedMs = durations[rank];
+}
+double VDFramePacer::getJitterMs() const
+{
+	if (mCount == 0) return 0.0;
+	double sum = 0.0;
+	for (size_t i = 0; i < mCount; i++) sum += mIntervalErrors[i] * mIntervalErrors[i];
+	return std::sqrt(sum / mCount);
+}
+double VDFramePacer::getMeanLatenessMs() const
+{
+	if (mCount == 0) return 0.0;
+	double sum = 0.0;
+	for (size_t i = 0; i < mCount; i++) sum += mLateness[i];
+	return sum / mCount;
+}
+double VDFramePacer::getMaxLatenessMs() const
+{
+	if (mCount == 0) return 0.0;
+	return *std::max_element(mLateness.begin(), mLateness.begin() + mCount);
+}
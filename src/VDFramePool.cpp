@@ -0,0 +1,155 @@
+#include "VDFramePool.h"
+
+#include "cinder/Log.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#if defined( _MSC_VER )
+#include <malloc.h>
+#endif
+
+using namespace videodromm;
+
+namespace {
+	uint8_t* alignedAlloc(size_t size)
+	{
+#if defined( _MSC_VER )
+		return static_cast<uint8_t*>(_aligned_malloc(size, VDFramePool::ALIGNMENT));
+#else
+		void *ptr = nullptr;
+		return posix_memalign(&ptr, VDFramePool::ALIGNMENT, size) == 0 ? static_cast<uint8_t*>(ptr) : nullptr;
+#endif
+	}
+	void alignedFree(uint8_t *ptr)
+	{
+#if defined( _MSC_VER )
+		_aligned_free(ptr);
+#else
+		free(ptr);
+#endif
+	}
+}
+
+// state shared by the pool and its buffers, so buffers still in flight
+// on another thread can be released after the pool is gone
+struct VDFrameBuffer::Shared {
+	Shared() : alive(true) {}
+	std::mutex						mutex;
+	std::vector<VDFrameBuffer*>		freeList;
+	VDFramePool::Stats				stats;
+	bool							alive;
+};
+
+VDFrameBuffer::VDFrameBuffer(const std::shared_ptr<Shared> &shared, int32_t width, int32_t height, ci::SurfaceChannelOrder channelOrder)
+	: mShared(shared)
+	, mRefCount(0)
+	, mWidth(width)
+	, mHeight(height)
+	, mChannelOrder(channelOrder)
+	, mReleasedAt(0)
+{
+	mRowBytes = ((ptrdiff_t)width * 4 + VDFramePool::ALIGNMENT - 1) & ~(ptrdiff_t)(VDFramePool::ALIGNMENT - 1);
+	mDataSize = (size_t)mRowBytes * height;
+	mData = alignedAlloc(mDataSize);
+	if (!mData) throw std::bad_alloc();
+	mSurface = ci::Surface(mData, mWidth, mHeight, mRowBytes, mChannelOrder);
+}
+VDFrameBuffer::~VDFrameBuffer()
+{
+	alignedFree(mData);
+}
+void VDFrameBuffer::release()
+{
+	if (mRefCount.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+	std::shared_ptr<Shared> shared = mShared;
+	std::lock_guard<std::mutex> lock(shared->mutex);
+	shared->stats.inUse--;
+	if (shared->alive) {
+		mReleasedAt = shared->stats.acquires;
+		shared->freeList.push_back(this);
+	}
+	else {
+		shared->stats.allocatedBytes -= mDataSize;
+		delete this;
+	}
+}
+void VDFrameBuffer::flipVertical()
+{
+	// swap 64 bytes at a time so no scratch row is needed
+	uint8_t tmp[64];
+	for (int32_t y = 0; y < mHeight / 2; y++) {
+		uint8_t *top = mData + y * mRowBytes;
+		uint8_t *bottom = mData + (mHeight - 1 - y) * mRowBytes;
+		for (ptrdiff_t x = 0; x < mRowBytes; x += sizeof(tmp)) {
+			std::memcpy(tmp, top + x, sizeof(tmp));
+			std::memcpy(top + x, bottom + x, sizeof(tmp));
+			std::memcpy(bottom + x, tmp, sizeof(tmp));
+		}
+	}
+}
+
+VDFramePool::VDFramePool(const std::string &name)
+	: mName(name)
+	, mShared(std::make_shared<VDFrameBuffer::Shared>())
+{
+}
+VDFramePool::~VDFramePool()
+{
+	std::lock_guard<std::mutex> lock(mShared->mutex);
+	mShared->alive = false;
+	for (VDFrameBuffer *buffer : mShared->freeList) {
+		delete buffer;
+	}
+	mShared->freeList.clear();
+}
+VDFrameHandle VDFramePool::acquire(int32_t width, int32_t height, ci::SurfaceChannelOrder channelOrder)
+{
+	VDFrameBuffer *buffer = nullptr;
+	{
+		std::lock_guard<std::mutex> lock(mShared->mutex);
+		Stats &stats = mShared->stats;
+		stats.acquires++;
+		auto &freeList = mShared->freeList;
+		for (size_t i = freeList.size(); i-- > 0;) {
+			VDFrameBuffer *candidate = freeList[i];
+			if (candidate->mWidth == width && candidate->mHeight == height && candidate->mChannelOrder.getCode() == channelOrder.getCode()) {
+				buffer = candidate;
+				freeList.erase(freeList.begin() + i);
+				stats.reuses++;
+				break;
+			}
+		}
+		if (!buffer) {
+			// a miss is a new size or a burst; other sizes stay unless nobody took them for a while
+			freeList.erase(std::remove_if(freeList.begin(), freeList.end(), [&stats](VDFrameBuffer *stale) {
+				if (stats.acquires - stale->mReleasedAt <= STALE_ACQUIRES) return false;
+				stats.allocatedBytes -= stale->mDataSize;
+				delete stale;
+				return true;
+			}), freeList.end());
+			buffer = new VDFrameBuffer(mShared, width, height, channelOrder);
+			stats.allocations++;
+			stats.allocatedBytes += buffer->mDataSize;
+			CI_LOG_V("VDFramePool " << mName << " allocated " << width << "x" << height << " buffer, total: " << stats.allocations);
+		}
+		stats.inUse++;
+		stats.peakInUse = std::max(stats.peakInUse, stats.inUse);
+	}
+	buffer->addRef();
+	return VDFrameHandle(buffer);
+}
+void VDFramePool::trim()
+{
+	std::lock_guard<std::mutex> lock(mShared->mutex);
+	for (VDFrameBuffer *buffer : mShared->freeList) {
+		mShared->stats.allocatedBytes -= buffer->mDataSize;
+		delete buffer;
+	}
+	mShared->freeList.clear();
+}
+VDFramePool::Stats VDFramePool::getStats() const
+{
+	std::lock_guard<std::mutex> lock(mShared->mutex);
+	return mShared->stats;
+}
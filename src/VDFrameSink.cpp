@@ -0,0 +1,44 @@
+#include "VDFrameSink.h"
+
+#include <chrono>
+#include <thread>
+
+using namespace videodromm;
+
+VDNDISink::VDNDISink(const std::string &name)
+	: mName(name)
+	, mNDISender(name)
+{
+}
+void VDNDISink::sendSurface(ci::Surface &surface, long long timecode)
+{
+	mNDISender.sendSurface(surface, timecode);
+}
+void VDNDISink::sendMetadata(const ci::XmlTree &metadata, long long timecode)
+{
+	mNDISender.sendMetadata(metadata, timecode);
+}
+
+VDMockSink::VDMockSink(const std::string &name, int delayMs)
+	: mName(name)
+	, mDelayMs(delayMs)
+	, mFramesReceived(0)
+	, mMetadataReceived(0)
+	, mLastTimecode(0)
+	, mLastMetadataTimecode(0)
+{
+}
+void VDMockSink::sendSurface(ci::Surface &surface, long long timecode)
+{
+	int delay = mDelayMs;
+	if (delay > 0) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(delay));
+	}
+	mLastTimecode = timecode;
+	mFramesReceived++;
+}
+void VDMockSink::sendMetadata(const ci::XmlTree &metadata, long long timecode)
+{
+	mLastMetadataTimecode = timecode;
+	mMetadataReceived++;
+}
@@ -0,0 +1,200 @@
+#include "VDFrameSource.h"
+
+#include "cinder/ImageIo.h"
+#include "cinder/Log.h"
+#include "cinder/Surface.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace ci;
+using namespace videodromm;
+
+namespace {
+	// BGRA rows into a pooled buffer, whatever the source pitch
+	VDFrameHandle copyToPool(VDFramePool &pool, const uint8_t *data, ptrdiff_t rowBytes, int32_t width, int32_t height)
+	{
+		VDFrameHandle frame = pool.acquire(width, height);
+		for (int32_t y = 0; y < height; y++) {
+			std::memcpy(frame->getData() + y * frame->getRowBytes(), data + y * rowBytes, width * 4);
+		}
+		return frame;
+	}
+}
+
+gl::Texture2dRef VDSpoutSource::receive()
+{
+	gl::Texture2dRef texture = mSpoutIn.receiveTexture();
+	updateMode();
+	if (mReadStamps && texture) readStamp(texture);
+	return texture;
+}
+void VDSpoutSource::updateMode()
+{
+	mPixels = mSpoutIn.isMemoryShareMode() || mSpoutIn.getSpoutReceiver().GetCPUmode();
+}
+void VDSpoutSource::readStamp(const gl::Texture2dRef &texture)
+{
+	const int32_t width = VDFrameStamp::BLOCK_WIDTH;
+	const int32_t rows = VDFrameStamp::BLOCK_HEIGHT;
+	mHasStamp = false;
+	if (texture->getWidth() < width || texture->getHeight() < rows) return;
+	if (!mStampFbo) mStampFbo = gl::Fbo::create(width, rows * 2);
+	{
+		// 1:1, the top rows above the bottom rows; read() takes the block either way up
+		gl::ScopedFramebuffer framebuffer(mStampFbo);
+		gl::ScopedViewport viewport(ivec2(0), mStampFbo->getSize());
+		gl::ScopedMatrices matrices;
+		gl::setMatricesWindow(mStampFbo->getSize());
+		gl::draw(texture, Area(0, 0, width, rows), Rectf(0.0f, 0.0f, (float)width, (float)rows));
+		gl::draw(texture, Area(0, texture->getHeight() - rows, width, texture->getHeight()), Rectf(0.0f, (float)rows, (float)width, (float)rows * 2));
+	}
+	Surface8u block = mStampFbo->readPixels8u(mStampFbo->getBounds());
+	mHasStamp = VDFrameStamp::read(block.getData(), block.getRowBytes(), block.getWidth(), rows, mStamp)
+		|| VDFrameStamp::read(block.getData() + rows * block.getRowBytes(), block.getRowBytes(), block.getWidth(), rows, mStamp);
+}
+VDFrameHandle VDSpoutSource::receivePixels(VDFramePool &pool)
+{
+	char name[256];
+	std::strncpy(name, mSpoutIn.getSenderName().c_str(), sizeof(name) - 1);
+	name[sizeof(name) - 1] = 0;
+	unsigned int width = mSpoutIn.getSize().x;
+	unsigned int height = mSpoutIn.getSize().y;
+	mScratch.resize((size_t)width * height * 4);
+	bool received = mSpoutIn.getSpoutReceiver().ReceiveImage(name, width, height, mScratch.data(), GL_BGRA);
+	// a new sender may share textures, then the app goes back to receive() next frame
+	updateMode();
+	if (!received) return VDFrameHandle();
+	// the sender changed size, the next frame is read at the new one
+	if (width != (unsigned int)mSpoutIn.getSize().x || height != (unsigned int)mSpoutIn.getSize().y) {
+		mSpoutIn.receiveTexture();
+		updateMode();
+		return VDFrameHandle();
+	}
+	// memory share has no header of ours, the stamp is in the pixels
+	mHasStamp = mReadStamps && VDFrameStamp::read(mScratch.data(), width * 4, width, height, mStamp);
+	return copyToPool(pool, mScratch.data(), width * 4, width, height);
+}
+
+bool VDSharedFrameSource::connect()
+{
+	if (mReader.isOpen()) return true;
+	if (!mReader.open(mName)) return false;
+	CI_LOG_I("VDSharedFrameSource: " << mName << " " << mReader.getSize().x << "x" << mReader.getSize().y);
+	return true;
+}
+VDFrameHandle VDSharedFrameSource::receivePixels(VDFramePool &pool)
+{
+	if (!connect()) return VDFrameHandle();
+	VDFrameHandle buffer = pool.acquire(mReader.getSize().x, mReader.getSize().y);
+	if (mReader.read(buffer->getData(), buffer->getRowBytes())) {
+		mFrame = buffer;
+		mStamp.sequence = (uint32_t)mReader.getFrameNumber();
+		mStamp.sendNs = mReader.getSendNs();
+	}
+	return mFrame;
+}
+gl::Texture2dRef VDSharedFrameSource::receive()
+{
+	if (!mTexturePool) mTexturePool = VDFramePool::create(mName);
+	receivePixels(*mTexturePool);
+	if (mFrame && mReader.getFrameNumber() != mTextureFrame) {
+		mTextureFrame = mReader.getFrameNumber();
+		if (mTexture && mTexture->getSize() == ivec2(mFrame->getWidth(), mFrame->getHeight())) mTexture->update(mFrame->getSurface());
+		else mTexture = gl::Texture2d::create(mFrame->getSurface(), gl::Texture2d::Format().loadTopDown());
+	}
+	return mTexture;
+}
+
+VDSyntheticSource::VDSyntheticSource(const ivec2 &size, int frameCount, bool pixels)
+	: mIndex(0)
+{
+	Surface8u surface(size.x, size.y, true, pixels ? SurfaceChannelOrder::BGRA : SurfaceChannelOrder::RGBA);
+	const uint8_t red = surface.getRedOffset(), green = surface.getGreenOffset(), blue = surface.getBlueOffset();
+	int barWidth = std::max(size.x / 16, 1);
+	for (int frame = 0; frame < std::max(frameCount, 1); frame++) {
+		int barX = (int)((int64_t)frame * (size.x - barWidth) / std::max(frameCount - 1, 1));
+		for (int y = 0; y < size.y; y++) {
+			uint8_t *row = surface.getData(ivec2(0, y));
+			for (int x = 0; x < size.x; x++) {
+				uint8_t *pixel = row + x * 4;
+				bool bar = x >= barX && x < barX + barWidth;
+				pixel[red] = bar ? 255 : (uint8_t)(x * 255 / std::max(size.x - 1, 1));
+				pixel[green] = bar ? 255 : (uint8_t)(y * 255 / std::max(size.y - 1, 1));
+				pixel[blue] = bar ? 255 : (uint8_t)(frame * 255 / std::max(frameCount - 1, 1));
+				pixel[surface.getAlphaOffset()] = 255;
+			}
+		}
+		// frame number as a binary strip along the top edge, readable after readback
+		int cell = std::max(size.x / 32, 1);
+		for (int bit = 0; bit < 16 && (bit + 1) * cell <= size.x; bit++) {
+			uint8_t value = (frame >> bit) & 1 ? 255 : 0;
+			for (int y = 0; y < std::min(cell, size.y); y++) {
+				uint8_t *row = surface.getData(ivec2(bit * cell, y));
+				for (int x = 0; x < cell; x++) {
+					row[x * 4] = row[x * 4 + 1] = row[x * 4 + 2] = value;
+				}
+			}
+		}
+		if (pixels) mSurfaces.push_back(surface.clone());
+		else mFrames.push_back(gl::Texture2d::create(surface, gl::Texture2d::Format().loadTopDown()));
+	}
+	CI_LOG_I("VDSyntheticSource: " << std::max(mFrames.size(), mSurfaces.size()) << " frames of " << size.x << "x" << size.y << (pixels ? " in memory" : ""));
+}
+gl::Texture2dRef VDSyntheticSource::receive()
+{
+	if (!mSurfaces.empty()) {
+		const Surface8u &surface = mSurfaces[mIndex];
+		mIndex = (mIndex + 1) % mSurfaces.size();
+		if (!mTexture) mTexture = gl::Texture2d::create(surface, gl::Texture2d::Format().loadTopDown());
+		else mTexture->update(surface);
+		return mTexture;
+	}
+	const gl::Texture2dRef &frame = mFrames[mIndex];
+	mIndex = (mIndex + 1) % mFrames.size();
+	return frame;
+}
+VDFrameHandle VDSyntheticSource::receivePixels(VDFramePool &pool)
+{
+	if (mSurfaces.empty()) return VDFrameHandle();
+	const Surface8u &surface = mSurfaces[mIndex];
+	mIndex = (mIndex + 1) % mSurfaces.size();
+	return copyToPool(pool, surface.getData(), surface.getRowBytes(), surface.getWidth(), surface.getHeight());
+}
+
+VDImageSequenceSource::VDImageSequenceSource(const fs::path &folder, size_t maxFrames)
+	: mName(folder.filename().string())
+	, mIndex(0)
+{
+	std::vector<fs::path> files;
+	try {
+		for (fs::directory_iterator it(folder), end; it != end; ++it) {
+			std::string ext = it->path().extension().string();
+			std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+			if (ext == ".png" || ext == ".jpg" || ext == ".jpeg" || ext == ".tga" || ext == ".bmp") {
+				files.push_back(it->path());
+			}
+		}
+	}
+	catch (const std::exception &e) {
+		CI_LOG_E("VDImageSequenceSource: " << folder << ": " << e.what());
+	}
+	std::sort(files.begin(), files.end());
+	if (files.size() > maxFrames) files.resize(maxFrames);
+	for (const auto &file : files) {
+		try {
+			mFrames.push_back(gl::Texture2d::create(loadImage(file), gl::Texture2d::Format().loadTopDown()));
+		}
+		catch (const std::exception &e) {
+			CI_LOG_W("VDImageSequenceSource: skipping " << file << ": " << e.what());
+		}
+	}
+	CI_LOG_I("VDImageSequenceSource: " << mFrames.size() << " frames from " << folder);
+}
+gl::Texture2dRef VDImageSequenceSource::receive()
+{
+	if (mFrames.empty()) return nullptr;
+	const gl::Texture2dRef &frame = mFrames[mIndex];
+	mIndex = (mIndex + 1) % mFrames.size();
+	return frame;
+}
@@ -0,0 +1,59 @@
+#include "VDFrameStamp.h"
+
+#include <chrono>
+#include <cstring>
+
+using namespace videodromm;
+
+namespace {
+	const uint8_t	SYNC = 0xa5;
+	const int		BYTES = VDFrameStamp::BLOCK_COLUMNS * VDFrameStamp::BLOCK_ROWS / 8;
+
+	uint8_t checkByte(const uint8_t *bytes)
+	{
+		uint8_t check = 0x5a;
+		for (int i = 1; i < BYTES - 1; i++) check = (uint8_t)((check << 1 | check >> 7) ^ bytes[i]);
+		return check;
+	}
+	// the centre of every cell, green decides: the same in BGRA and RGBA
+	bool readBlock(const uint8_t *pixels, ptrdiff_t rowBytes, VDFrameStamp &stamp)
+	{
+		uint8_t bytes[BYTES] = {};
+		for (int bit = 0; bit < BYTES * 8; bit++) {
+			int32_t x = (bit % VDFrameStamp::BLOCK_COLUMNS) * VDFrameStamp::CELL + VDFrameStamp::CELL / 2;
+			int32_t y = (bit / VDFrameStamp::BLOCK_COLUMNS) * VDFrameStamp::CELL + VDFrameStamp::CELL / 2;
+			if (pixels[y * rowBytes + x * 4 + 1] >= 128) bytes[bit / 8] |= (uint8_t)(1 << (bit % 8));
+		}
+		if (bytes[0] != SYNC || bytes[BYTES - 1] != checkByte(bytes)) return false;
+		std::memcpy(&stamp.sequence, bytes + 1, 4);
+		std::memcpy(&stamp.sendNs, bytes + 5, 8);
+		return stamp.sendNs != 0;
+	}
+}
+
+int64_t VDFrameStamp::now()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+void VDFrameStamp::write(uint8_t *pixels, ptrdiff_t rowBytes, int32_t width, int32_t height, uint32_t sequence, int64_t sendNs)
+{
+	if (width < BLOCK_WIDTH || height < BLOCK_HEIGHT) return;
+	uint8_t bytes[BYTES];
+	bytes[0] = SYNC;
+	std::memcpy(bytes + 1, &sequence, 4);
+	std::memcpy(bytes + 5, &sendNs, 8);
+	bytes[BYTES - 1] = checkByte(bytes);
+	for (int32_t y = 0; y < BLOCK_HEIGHT; y++) {
+		uint8_t *row = pixels + y * rowBytes;
+		for (int32_t column = 0; column < BLOCK_COLUMNS; column++) {
+			int bit = (y / CELL) * BLOCK_COLUMNS + column;
+			uint32_t pixel = bytes[bit / 8] >> (bit % 8) & 1 ? 0xffffffff : 0xff000000;
+			for (int32_t x = column * CELL; x < (column + 1) * CELL; x++) std::memcpy(row + x * 4, &pixel, 4);
+		}
+	}
+}
+bool VDFrameStamp::read(const uint8_t *pixels, ptrdiff_t rowBytes, int32_t width, int32_t height, VDFrameStamp &stamp)
+{
+	if (width < BLOCK_WIDTH || height < BLOCK_HEIGHT) return false;
+	return readBlock(pixels, rowBytes, stamp) || readBlock(pixels + (height - 1) * rowBytes, -rowBytes, stamp);
+}
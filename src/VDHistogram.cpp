@@ -0,0 +1,59 @@
+#include "VDHistogram.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace videodromm;
+
+int VDHistogram::bucketOf(uint64_t us)
+{
+	if (us == 0) return 0;
+	int bucket = 1 + (int)(std::log2((double)us) * 8.0);
+	return std::min(bucket, BUCKETS - 1);
+}
+double VDHistogram::bucketMs(int bucket)
+{
+	if (bucket == 0) return 0.0005;
+	// geometric middle of the bucket
+	return std::exp2((bucket - 1 + 0.5) / 8.0) / 1000.0;
+}
+void VDHistogram::add(double ms)
+{
+	uint64_t us = ms > 0.0 ? (uint64_t)(ms * 1000.0 + 0.5) : 0;
+	mBuckets[bucketOf(us)].fetch_add(1, std::memory_order_relaxed);
+	mCount.fetch_add(1, std::memory_order_relaxed);
+	mSumUs.fetch_add(us, std::memory_order_relaxed);
+	uint64_t max = mMaxUs.load(std::memory_order_relaxed);
+	while (us > max && !mMaxUs.compare_exchange_weak(max, us, std::memory_order_relaxed)) {
+	}
+}
+void VDHistogram::reset()
+{
+	for (auto &bucket : mBuckets) {
+		bucket.store(0, std::memory_order_relaxed);
+	}
+	mCount.store(0, std::memory_order_relaxed);
+	mSumUs.store(0, std::memory_order_relaxed);
+	mMaxUs.store(0, std::memory_order_relaxed);
+}
+double VDHistogram::getMeanMs() const
+{
+	uint64_t count = getCount();
+	return count > 0 ? mSumUs.load(std::memory_order_relaxed) / 1000.0 / count : 0.0;
+}
+double VDHistogram::getPercentileMs(double p) const
+{
+	// count from the buckets themselves, mCount may already include a sample in flight
+	uint64_t total = 0;
+	for (const auto &bucket : mBuckets) {
+		total += bucket.load(std::memory_order_relaxed);
+	}
+	if (total == 0) return 0.0;
+	uint64_t rank = (uint64_t)std::ceil(std::min(std::max(p, 0.0), 1.0) * total);
+	uint64_t seen = 0;
+	for (int i = 0; i < BUCKETS; i++) {
+		seen += mBuckets[i].load(std::memory_order_relaxed);
+		if (seen >= rank && seen > 0) return std::min(bucketMs(i), getMaxMs());
+	}
+	return getMaxMs();
+}
@@ -0,0 +1,408 @@
+#include "VDLoadGenerator.h"
+#include "VDFrameStamp.h"
+#include "VDSharedFrame.h"
+
+#include "cinder/Log.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <random>
+
+#if defined( _WIN32 )
+// Spout
+#include "Spout.h"
+#endif
+
+using namespace ci;
+using namespace videodromm;
+
+namespace {
+	typedef std::chrono::steady_clock	Clock;
+
+	uint64_t nanoseconds(Clock::duration duration)
+	{
+		return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+	}
+}
+
+VDLoadGenerator::Format& VDLoadGenerator::Format::sender(int index, const ivec2 &size, double rate, VDLoadPattern pattern)
+{
+	SenderFormat format;
+	format.mIndex = index;
+	format.mSize = size;
+	format.mRate = rate;
+	format.mPattern = pattern;
+	auto existing = std::find_if(mOverrides.begin(), mOverrides.end(), [index](const SenderFormat &other) { return other.mIndex == index; });
+	if (existing != mOverrides.end()) *existing = format;
+	else mOverrides.push_back(format);
+	return *this;
+}
+VDLoadGenerator::SenderFormat VDLoadGenerator::Format::getSender(int index) const
+{
+	for (const auto &format : mOverrides) {
+		if (format.mIndex == index) return format;
+	}
+	SenderFormat format;
+	format.mIndex = index;
+	format.mSize = mSize;
+	format.mRate = mRate;
+	format.mPattern = mPattern;
+	return format;
+}
+
+struct VDLoadGenerator::Sender {
+	Sender() : mSent(0), mLate(0), mPatternRowBytes(0) {}
+
+	// the frame to fill, packed rows
+	uint8_t* begin()
+	{
+#if defined( _WIN32 )
+		if (mSpout) return mStaging.data();
+#endif
+		return mWriter->beginFrame();
+	}
+	void end(const ivec2 &size)
+	{
+#if defined( _WIN32 )
+		if (mSpout) {
+			mSpout->SendImage(mStaging.data(), size.x, size.y, GL_BGRA_EXT, false);
+			return;
+		}
+#endif
+		mWriter->endFrame();
+	}
+
+	int						mIndex;
+	std::string				mName;
+	SenderFormat			mFormat;
+	std::thread				mThread;
+	std::atomic<uint64_t>	mSent;
+	std::atomic<uint64_t>	mLate;
+	VDSharedFrameWriterRef	mWriter;
+#if defined( _WIN32 )
+	std::unique_ptr<SpoutSender>	mSpout;
+	std::vector<uint8_t>	mStaging;
+#endif
+	// the pattern is prepared once, frames are windows into it
+	std::vector<uint8_t>	mPattern;
+	ptrdiff_t				mPatternRowBytes;
+};
+
+VDLoadGenerator::VDLoadGenerator(const Format &format)
+	: mFormat(format)
+	, mRunning(true)
+{
+	for (int i = 0; i < format.mSenders; i++) {
+		std::unique_ptr<Sender> sender(new Sender());
+		sender->mIndex = i;
+		sender->mName = getSenderName(i);
+		sender->mFormat = format.getSender(i);
+		const ivec2 size = sender->mFormat.mSize;
+		if (size.x < VDFrameStamp::BLOCK_WIDTH || size.y < VDFrameStamp::BLOCK_HEIGHT) {
+			CI_LOG_E("VDLoadGenerator: " << size.x << "x" << size.y << " is too small for the frame stamp, " << sender->mName << " left out");
+			continue;
+		}
+		bool created = false;
+		if (format.mBackend == VDLoadBackend::Spout) {
+#if defined( _WIN32 )
+			// memory share needs no GL context on the sender threads
+			sender->mSpout.reset(new SpoutSender());
+			sender->mSpout->spout.SetMaxSenders(std::max(format.mSenders, sender->mSpout->spout.GetMaxSenders()));
+			sender->mSpout->SetMemoryShareMode(true);
+			created = sender->mSpout->CreateSender(sender->mName.c_str(), size.x, size.y);
+			sender->mStaging.resize((size_t)size.x * size.y * 4);
+#else
+			CI_LOG_E("VDLoadGenerator: Spout senders need Windows");
+			return;
+#endif
+		}
+		else {
+			sender->mWriter = VDSharedFrameWriter::create(sender->mName, size);
+			created = sender->mWriter->isOpen();
+		}
+		if (!created) {
+			CI_LOG_W("VDLoadGenerator: cannot create sender " << sender->mName);
+			continue;
+		}
+		// gradients scroll through a pattern twice as wide, noise through one twice as high
+		const VDLoadPattern pattern = sender->mFormat.mPattern;
+		int patternWidth = pattern == VDLoadPattern::Gradient ? size.x * 2 : size.x;
+		int patternHeight = pattern == VDLoadPattern::Noise ? size.y * 2 : size.y;
+		sender->mPatternRowBytes = (ptrdiff_t)patternWidth * 4;
+		sender->mPattern.resize((size_t)sender->mPatternRowBytes * patternHeight);
+		fillPattern(pattern, i, sender->mPattern.data(), sender->mPatternRowBytes, patternWidth, patternHeight);
+		mSenders.push_back(std::move(sender));
+	}
+	for (auto &sender : mSenders) {
+		Sender *running = sender.get();
+		sender->mThread = std::thread([this, running] { run(*running); });
+	}
+	CI_LOG_I("VDLoadGenerator: " << mSenders.size() << " " << getBackendName(format.mBackend) << " senders " << format.mSize.x << "x" << format.mSize.y << " at " << format.mRate << " fps, " << getPatternName(format.mPattern));
+	for (const auto &sender : mSenders) {
+		const SenderFormat &own = sender->mFormat;
+		if (own.mSize != format.mSize || own.mRate != format.mRate || own.mPattern != format.mPattern) {
+			CI_LOG_I("VDLoadGenerator: " << sender->mName << " " << own.mSize.x << "x" << own.mSize.y << " at " << own.mRate << " fps, " << getPatternName(own.mPattern));
+		}
+	}
+}
+VDLoadGenerator::~VDLoadGenerator()
+{
+	stop();
+}
+void VDLoadGenerator::stop()
+{
+	mRunning = false;
+	for (auto &sender : mSenders) {
+		if (sender->mThread.joinable()) sender->mThread.join();
+#if defined( _WIN32 )
+		if (sender->mSpout) {
+			sender->mSpout->ReleaseSender();
+			sender->mSpout.reset();
+		}
+#endif
+	}
+}
+void VDLoadGenerator::run(Sender &sender)
+{
+	const ivec2 size = sender.mFormat.mSize;
+	const VDLoadPattern pattern = sender.mFormat.mPattern;
+	const double rate = sender.mFormat.mRate;
+	const ptrdiff_t rowBytes = (ptrdiff_t)size.x * 4;
+	const Clock::duration period = rate > 0.0 ? std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / rate)) : Clock::duration::zero();
+	std::mt19937 random(sender.mIndex + 1);
+	Clock::time_point next = Clock::now();
+	for (uint32_t sequence = 0; mRunning; sequence++) {
+		const uint8_t *source = sender.mPattern.data();
+		if (pattern == VDLoadPattern::Gradient) source += (sequence * 4 % size.x) * 4;
+		else if (pattern == VDLoadPattern::Noise) source += (random() % size.y) * sender.mPatternRowBytes;
+		uint8_t *pixels = sender.begin();
+		for (int32_t y = 0; y < size.y; y++) {
+			std::memcpy(pixels + y * rowBytes, source + y * sender.mPatternRowBytes, rowBytes);
+		}
+		VDFrameStamp::write(pixels, rowBytes, size.x, size.y, sequence, VDFrameStamp::now());
+		sender.end(size);
+		sender.mSent++;
+		if (period == Clock::duration::zero()) continue;
+		next += period;
+		Clock::time_point now = Clock::now();
+		if (now > next) {
+			// behind: count it and keep the rate from here instead of bursting
+			sender.mLate++;
+			next = now;
+		}
+		else {
+			std::this_thread::sleep_until(next);
+		}
+	}
+}
+uint64_t VDLoadGenerator::getFramesSent() const
+{
+	uint64_t sent = 0;
+	for (const auto &sender : mSenders) sent += sender->mSent;
+	return sent;
+}
+uint64_t VDLoadGenerator::getFramesLate() const
+{
+	uint64_t late = 0;
+	for (const auto &sender : mSenders) late += sender->mLate;
+	return late;
+}
+void VDLoadGenerator::fillPattern(VDLoadPattern pattern, int index, uint8_t *pixels, ptrdiff_t rowBytes, int32_t width, int32_t height)
+{
+	std::mt19937 random(index + 1);
+	for (int32_t y = 0; y < height; y++) {
+		uint8_t *row = pixels + y * rowBytes;
+		for (int32_t x = 0; x < width; x++) {
+			uint8_t *pixel = row + x * 4;
+			if (pattern == VDLoadPattern::Noise) {
+				uint32_t value = (uint32_t)random() | 0xff000000;
+				std::memcpy(pixel, &value, 4);
+			}
+			else {
+				// a hue per sender, to tell them apart in a receiver
+				pixel[0] = (uint8_t)(x * 255 / width);
+				pixel[1] = (uint8_t)(y * 255 / height);
+				pixel[2] = (uint8_t)(index * 37);
+				pixel[3] = 255;
+			}
+		}
+	}
+}
+const char* VDLoadGenerator::getPatternName(VDLoadPattern pattern)
+{
+	switch (pattern) {
+	case VDLoadPattern::Static: return "static";
+	case VDLoadPattern::Noise: return "noise";
+	case VDLoadPattern::Gradient: return "gradient";
+	default: return "";
+	}
+}
+bool VDLoadGenerator::parsePattern(const std::string &name, VDLoadPattern &pattern)
+{
+	for (VDLoadPattern candidate : { VDLoadPattern::Static, VDLoadPattern::Noise, VDLoadPattern::Gradient }) {
+		if (name == getPatternName(candidate)) {
+			pattern = candidate;
+			return true;
+		}
+	}
+	return false;
+}
+const char* VDLoadGenerator::getBackendName(VDLoadBackend backend)
+{
+	return backend == VDLoadBackend::Spout ? "spout" : "shared memory";
+}
+
+struct VDLoadProbe::Receiver {
+	Receiver() : mLastSequence(-1) {}
+
+	std::string				mName;
+	int64_t					mLastSequence;
+	VDSharedFrameReaderRef	mReader;
+#if defined( _WIN32 )
+	spoutSenderNames		mNames;
+	spoutMemoryShare		mMemory;
+	ivec2					mMemorySize;
+#endif
+};
+
+VDLoadProbe::VDLoadProbe(const VDLoadGenerator::Format &format)
+	: mFormat(format)
+{
+	for (int i = 0; i < format.mSenders; i++) {
+		std::unique_ptr<Receiver> receiver(new Receiver());
+		receiver->mName = format.mPrefix + "-" + toString(i);
+		receiver->mReader = VDSharedFrameReader::create();
+#if defined( _WIN32 )
+		receiver->mMemorySize = ivec2(0);
+#endif
+		mReceivers.push_back(std::move(receiver));
+	}
+}
+VDLoadProbe::~VDLoadProbe()
+{
+#if defined( _WIN32 )
+	for (auto &receiver : mReceivers) {
+		if (receiver->mMemorySize.x > 0) receiver->mMemory.CloseSenderMemory();
+	}
+#endif
+}
+int VDLoadProbe::poll()
+{
+	int frames = 0;
+	for (auto &receiver : mReceivers) {
+		mStats.mPolls++;
+		// find the sender, as a receiver does before every frame
+		Clock::time_point start = Clock::now();
+		ivec2 size;
+		bool ready = false;
+		if (mFormat.mBackend == VDLoadBackend::Spout) {
+#if defined( _WIN32 )
+			unsigned int width = 0, height = 0;
+			HANDLE handle = nullptr;
+			DWORD format = 0;
+			if (receiver->mNames.GetSenderInfo(receiver->mName.c_str(), width, height, handle, format)) {
+				size = ivec2(width, height);
+				if (size != receiver->mMemorySize) {
+					if (receiver->mMemorySize.x > 0) receiver->mMemory.CloseSenderMemory();
+					receiver->mMemorySize = receiver->mMemory.OpenSenderMemory(receiver->mName.c_str()) ? size : ivec2();
+				}
+				ready = receiver->mMemorySize.x > 0;
+			}
+#endif
+		}
+		else {
+			if (!receiver->mReader->isOpen()) receiver->mReader->open(receiver->mName);
+			ready = receiver->mReader->isOpen();
+			size = receiver->mReader->getSize();
+		}
+		Clock::time_point found = Clock::now();
+		mStats.mRegistryNs += nanoseconds(found - start);
+		if (!ready) continue;
+
+		const size_t bytes = (size_t)size.x * size.y * 4;
+		if (mPixels.size() < bytes) mPixels.resize(bytes);
+		bool fresh = false;
+		if (mFormat.mBackend == VDLoadBackend::Spout) {
+#if defined( _WIN32 )
+			// memory share has no frame counter, the stamp tells new frames from repeats
+			const uint8_t *memory = receiver->mMemory.LockSenderMemory();
+			if (memory) {
+				std::memcpy(mPixels.data(), memory, bytes);
+				receiver->mMemory.UnlockSenderMemory();
+				fresh = true;
+			}
+#endif
+		}
+		else {
+			uint64_t torn = receiver->mReader->getTornReads();
+			fresh = receiver->mReader->read(mPixels.data(), (ptrdiff_t)size.x * 4);
+			mStats.mTorn += receiver->mReader->getTornReads() - torn;
+		}
+		if (!fresh) continue;
+		mStats.mReadNs += nanoseconds(Clock::now() - found);
+
+		VDFrameStamp stamp;
+		if (!VDFrameStamp::read(mPixels.data(), (ptrdiff_t)size.x * 4, size.x, size.y, stamp)) {
+			mStats.mTorn++;
+			continue;
+		}
+		const int64_t sequence = stamp.sequence;
+		if (sequence == receiver->mLastSequence) continue;
+		if (receiver->mLastSequence >= 0 && sequence > receiver->mLastSequence + 1) {
+			mStats.mDropped += sequence - receiver->mLastSequence - 1;
+		}
+		receiver->mLastSequence = sequence;
+		// the header's time where there is one, it is taken after the copy into shared memory
+		int64_t sendNs = mFormat.mBackend == VDLoadBackend::SharedMemory ? receiver->mReader->getSendNs() : stamp.sendNs;
+		mLatency.add((VDFrameStamp::now() - sendNs) / 1.0e6);
+		mStats.mFrames++;
+		mStats.mBytes += bytes;
+		frames++;
+	}
+	return frames;
+}
+
+std::string VDLoadGenerator::scalingReport(const Format &format, const std::vector<int> &senderCounts, double seconds)
+{
+	std::string text;
+	char line[200];
+	std::snprintf(line, sizeof(line), "%s %dx%d at %.0f fps, %s, %d senders overridden, %.1f s per step\n", getBackendName(format.mBackend), format.mSize.x, format.mSize.y, format.mRate, getPatternName(format.mPattern), (int)format.mOverrides.size(), seconds);
+	text += line;
+	std::snprintf(line, sizeof(line), "%8s %10s %10s %8s %8s %8s %10s %12s %10s %10s %10s\n", "senders", "sent/s", "recv/s", "drop %", "torn", "late", "MB/s", "registry us", "read us", "p50 ms", "p99 ms");
+	text += line;
+	for (int senders : senderCounts) {
+		Format stepFormat = format;
+		stepFormat.senders(senders);
+		VDLoadGeneratorRef generator = create(stepFormat);
+		VDLoadProbe probe(stepFormat);
+		// every sender publishes and the probe finds it before the measurement
+		Clock::time_point warm = Clock::now() + std::chrono::milliseconds(250);
+		while (Clock::now() < warm) {
+			if (probe.poll() == 0) std::this_thread::yield();
+		}
+		probe.resetStats();
+		uint64_t sent = generator->getFramesSent();
+		uint64_t late = generator->getFramesLate();
+		Clock::time_point start = Clock::now();
+		Clock::time_point end = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds));
+		// spinning like a receiver waiting on frames, but leaving the core to senders when idle
+		while (Clock::now() < end) {
+			if (probe.poll() == 0) std::this_thread::yield();
+		}
+		double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+		sent = generator->getFramesSent() - sent;
+		late = generator->getFramesLate() - late;
+		generator->stop();
+		const VDLoadProbe::Stats &stats = probe.getStats();
+		std::snprintf(line, sizeof(line), "%8d %10.0f %10.0f %8.2f %8llu %8llu %10.0f %12.3f %10.1f %10.3f %10.3f\n",
+			generator->getSenderCount(), sent / elapsed, stats.mFrames / elapsed,
+			stats.mFrames + stats.mDropped > 0 ? 100.0 * stats.mDropped / (stats.mFrames + stats.mDropped) : 0.0,
+			(unsigned long long)stats.mTorn, (unsigned long long)late, stats.mBytes / elapsed / (1024.0 * 1024.0),
+			stats.mPolls > 0 ? stats.mRegistryNs / 1000.0 / stats.mPolls : 0.0,
+			stats.mFrames > 0 ? stats.mReadNs / 1000.0 / stats.mFrames : 0.0,
+			probe.getLatency().getPercentileMs(0.5), probe.getLatency().getPercentileMs(0.99));
+		text += line;
+	}
+	return text;
+}
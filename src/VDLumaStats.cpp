@@ -0,0 +1,129 @@
+#include "VDLumaStats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <mutex>
+
+#if defined( _M_X64 ) || defined( _M_IX86 ) || defined( __SSE2__ )
+#define VD_LUMASTATS_SSE2
+#include <emmintrin.h>
+#endif
+
+using namespace videodromm;
+
+namespace {
+	// Rec.601 luma in 7 bits of fraction, as in VDCpuEffects
+	const int16_t LUMA_B = 15, LUMA_G = 75, LUMA_R = 38;
+}
+
+void VDLumaStats::reset()
+{
+	std::memset(histogram, 0, sizeof(histogram));
+	samples = 0;
+	mean = 0.0f;
+	min = 0;
+	max = 0;
+}
+int VDLumaStats::percentile(float fraction) const
+{
+	if (samples == 0) return 0;
+	uint64_t rank = (uint64_t)std::ceil(std::max(0.0f, std::min(fraction, 1.0f)) * samples);
+	uint64_t count = 0;
+	for (int i = 0; i < 256; i++) {
+		count += histogram[i];
+		if (count >= rank && count > 0) return i;
+	}
+	return 255;
+}
+void VDLumaStats::accumulate(const VDFrameBuffer &frame, int32_t y0, int32_t y1, int32_t rowStep, uint32_t (*histograms)[256])
+{
+	const int32_t width = frame.getWidth();
+	// the weights follow the channel order, red and blue swap places
+	const bool rgba = frame.getChannelOrder().getCode() == ci::SurfaceChannelOrder::RGBA;
+	const int16_t w0 = rgba ? LUMA_R : LUMA_B, w2 = rgba ? LUMA_B : LUMA_R;
+	alignas(16) int16_t luma[8];
+	for (int32_t y = y0; y < y1; y++) {
+		const uint8_t *row = frame.getData() + (ptrdiff_t)y * rowStep * frame.getRowBytes();
+		int32_t x = 0;
+#if defined( VD_LUMASTATS_SSE2 )
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i weights = _mm_setr_epi16(w0, LUMA_G, w2, 0, w0, LUMA_G, w2, 0);
+		const __m128i ones = _mm_set1_epi16(1);
+		const __m128i round = _mm_set1_epi32(64);
+		for (; x + 8 <= width; x += 8) {
+			__m128i p0 = _mm_loadu_si128((const __m128i*)(row + x * 4));
+			__m128i p1 = _mm_loadu_si128((const __m128i*)(row + x * 4 + 16));
+			// per pixel (b, g) and (r, a) partial sums, then their total
+			__m128i s0 = _mm_packs_epi32(_mm_madd_epi16(_mm_unpacklo_epi8(p0, zero), weights), _mm_madd_epi16(_mm_unpackhi_epi8(p0, zero), weights));
+			__m128i s1 = _mm_packs_epi32(_mm_madd_epi16(_mm_unpacklo_epi8(p1, zero), weights), _mm_madd_epi16(_mm_unpackhi_epi8(p1, zero), weights));
+			__m128i l0 = _mm_srli_epi32(_mm_add_epi32(_mm_madd_epi16(s0, ones), round), 7);
+			__m128i l1 = _mm_srli_epi32(_mm_add_epi32(_mm_madd_epi16(s1, ones), round), 7);
+			_mm_store_si128((__m128i*)luma, _mm_packs_epi32(l0, l1));
+			histograms[0][luma[0]]++;
+			histograms[1][luma[1]]++;
+			histograms[2][luma[2]]++;
+			histograms[3][luma[3]]++;
+			histograms[0][luma[4]]++;
+			histograms[1][luma[5]]++;
+			histograms[2][luma[6]]++;
+			histograms[3][luma[7]]++;
+		}
+#endif
+		for (; x < width; x++) {
+			const uint8_t *p = row + x * 4;
+			histograms[x & 3][std::min((p[0] * w0 + p[1] * LUMA_G + p[2] * w2 + 64) >> 7, 255)]++;
+		}
+	}
+}
+void VDLumaStats::compute(const VDFrameBuffer &frame, VDLumaStats &stats, int32_t rowStep, VDWorkerPool *workers)
+{
+	stats.reset();
+	rowStep = std::max(rowStep, 1);
+	const int32_t rows = (frame.getHeight() + rowStep - 1) / rowStep;
+	std::mutex merge;
+	auto band = [&](size_t y0, size_t y1) {
+		uint32_t histograms[4][256] = {};
+		accumulate(frame, (int32_t)y0, (int32_t)y1, rowStep, histograms);
+		std::lock_guard<std::mutex> lock(merge);
+		for (int i = 0; i < 256; i++) {
+			stats.histogram[i] += histograms[0][i] + histograms[1][i] + histograms[2][i] + histograms[3][i];
+		}
+	};
+	if (workers && rows * frame.getWidth() >= PARALLEL_THRESHOLD) {
+		workers->parallelFor(rows, band);
+	}
+	else {
+		band(0, rows);
+	}
+	uint64_t sum = 0;
+	stats.min = 255;
+	for (int i = 0; i < 256; i++) {
+		if (stats.histogram[i] == 0) continue;
+		stats.samples += stats.histogram[i];
+		sum += (uint64_t)i * stats.histogram[i];
+		stats.min = std::min(stats.min, i);
+		stats.max = i;
+	}
+	if (stats.samples == 0) {
+		stats.min = 0;
+		return;
+	}
+	stats.mean = (float)((double)sum / stats.samples);
+}
+
+VDExposureController::VDExposureController(const Format &format)
+	: mFormat(format)
+{
+}
+float VDExposureController::update(const VDLumaStats &stats, float exposure, double elapsed)
+{
+	if (stats.samples == 0 || mFormat.mSeconds <= 0.0f) return exposure;
+	// a black frame asks for the maximum, not for infinity
+	float mean = std::max(stats.mean / 255.0f, 1.0f / 255.0f);
+	float error = std::log(mFormat.mTarget / mean);
+	if (std::abs(error) < std::log(1.0f + mFormat.mTolerance)) return exposure;
+	// a stalled frame is one step, not a jump
+	float step = 1.0f - std::exp(-(float)std::min(elapsed, 0.1) / mFormat.mSeconds);
+	return std::max(mFormat.mMin, std::min(exposure * std::exp(error * step), mFormat.mMax));
+}
@@ -0,0 +1,88 @@
+#include "VDMetadataChannel.h"
+
+#include <cstdio>
+
+using namespace ci;
+using namespace videodromm;
+
+VDMetadataChannel::VDMetadataChannel(const std::string &tag, double keepAliveSeconds)
+	: mTag(tag)
+	, mDirty(true)
+	, mKeepAliveSeconds(keepAliveSeconds)
+	, mLastSent(0.0)
+	, mRebuilds(0)
+	, mSends(0)
+{
+}
+int VDMetadataChannel::addField(const std::string &name)
+{
+	mFields.push_back(Field{ name, false, "" });
+	mDirty = true;
+	return (int)mFields.size() - 1;
+}
+int VDMetadataChannel::addUniform(const std::string &name)
+{
+	mFields.push_back(Field{ name, true, "" });
+	mDirty = true;
+	return (int)mFields.size() - 1;
+}
+void VDMetadataChannel::setValue(int index, const char *value)
+{
+	Field &field = mFields[index];
+	if (field.value != value) {
+		// assign keeps the capacity, no allocation once the string has grown
+		field.value.assign(value);
+		mDirty = true;
+	}
+}
+void VDMetadataChannel::set(int index, const std::string &value)
+{
+	setValue(index, value.c_str());
+}
+void VDMetadataChannel::set(int index, int value)
+{
+	char buf[16];
+	std::snprintf(buf, sizeof(buf), "%d", value);
+	setValue(index, buf);
+}
+void VDMetadataChannel::set(int index, float value)
+{
+	// 3 decimals: enough for receivers, and noise below that is not a change
+	char buf[32];
+	std::snprintf(buf, sizeof(buf), "%.3f", value);
+	setValue(index, buf);
+}
+void VDMetadataChannel::setText(const std::string &text)
+{
+	if (mText != text) {
+		mText.assign(text);
+		mDirty = true;
+	}
+}
+std::shared_ptr<XmlTree> VDMetadataChannel::poll(double time)
+{
+	if (mDirty) {
+		// a fresh tree: the previous one may still be in flight on an output thread
+		auto payload = std::make_shared<XmlTree>(mTag, mText);
+		for (const Field &field : mFields) {
+			if (field.uniform) {
+				XmlTree uniform("uniform", "");
+				uniform.setAttribute("name", field.name);
+				uniform.setAttribute("value", field.value);
+				payload->push_back(uniform);
+			}
+			else {
+				payload->setAttribute(field.name, field.value);
+			}
+		}
+		mPayload = payload;
+		mDirty = false;
+		mRebuilds++;
+	}
+	else if (time - mLastSent < mKeepAliveSeconds) {
+		return nullptr;
+	}
+	mLastSent = time;
+	mSends++;
+	return mPayload;
+}
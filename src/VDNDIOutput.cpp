@@ -0,0 +1,114 @@
+#include "VDNDIOutput.h"
+#include "VDDownscaler.h"
+#include "VDFrameStamp.h"
+#include "VDTracer.h"
+
+#include "cinder/Log.h"
+
+#include <chrono>
+
+using namespace videodromm;
+
+VDNDIOutput::VDNDIOutput(const VDFrameSinkRef &sink, const Format &format)
+	: mSink(sink)
+	, mScale(format.mScale)
+	, mWorkers(format.mWorkers)
+	, mProfiler(format.mProfiler)
+	, mProfilerStage(format.mProfilerStage)
+	, mLatencyStage(format.mLatencyStage)
+	, mPushCount(0)
+	, mMetadataSerial(0)
+	, mMetadataSent(0)
+	, mQueue(format.mQueueSize, format.mDropPolicy)
+	, mEnqueued(0)
+	, mSent(0)
+	, mDropped(0)
+	, mSkipped(0)
+	, mRunning(true)
+{
+	if (format.mAdaptive) {
+		mController = VDOutputController::create(mSink->getName(), format.mController);
+	}
+	if (mScale < 1.0f || mController) {
+		mScaledPool = VDFramePool::create(mSink->getName());
+	}
+	mThread = std::thread(&VDNDIOutput::run, this);
+	CI_LOG_V("VDNDIOutput started: " << mSink->getName() << " queue size: " << mQueue.capacity() << " scale: " << mScale);
+}
+VDNDIOutput::~VDNDIOutput()
+{
+	stop();
+}
+void VDNDIOutput::stop()
+{
+	if (mRunning.exchange(false)) {
+		mWake.notify_one();
+		if (mThread.joinable()) mThread.join();
+		CI_LOG_V("VDNDIOutput stopped: " << mSink->getName() << " enqueued: " << mEnqueued << " sent: " << mSent << " dropped: " << mDropped << " skipped: " << mSkipped);
+	}
+}
+bool VDNDIOutput::push(const VDFrameHandle &buffer, long long timecode, const std::shared_ptr<ci::XmlTree> &metadata, int64_t receiveNs)
+{
+	if (!mRunning) return false;
+	if (metadata) {
+		mMetadata = metadata;
+		mMetadataSerial++;
+	}
+	if (mController && mPushCount++ % mController->getRateDivisor() != 0) {
+		mSkipped++;
+		return false;
+	}
+	VDOutputFrame frame;
+	frame.buffer = buffer;
+	frame.timecode = timecode;
+	if (mMetadataSerial != mMetadataSent) {
+		frame.metadata = mMetadata;
+		frame.metadataSerial = mMetadataSerial;
+	}
+	frame.receiveNs = receiveNs;
+	size_t dropped = 0;
+	bool queued = mQueue.push(std::move(frame), dropped);
+	if (queued) mEnqueued++;
+	mDropped += dropped;
+	mWake.notify_one();
+	return queued;
+}
+void VDNDIOutput::run()
+{
+	VDTracer::setThreadName("ndi " + mSink->getName());
+	VDOutputFrame frame;
+	while (mRunning) {
+		if (mQueue.tryPop(frame)) {
+			VDTracer::Scope trace("ndi send");
+			auto start = std::chrono::steady_clock::now();
+			float scale = mController ? mScale * mController->getScale() : mScale;
+			if (scale < 1.0f) {
+				VDFrameHandle scaled = mScaledPool->acquire(VDDownscaler::scaledSize(frame.buffer->getWidth(), scale), VDDownscaler::scaledSize(frame.buffer->getHeight(), scale), frame.buffer->getChannelOrder());
+				VDDownscaler::downscale(*frame.buffer, *scaled, mWorkers.get());
+				// let the full size buffer go back to its pool before the send
+				frame.buffer = std::move(scaled);
+			}
+			if (frame.metadata && frame.metadataSerial > mMetadataSent) {
+				mSink->sendMetadata(*frame.metadata, frame.timecode);
+				mMetadataSent = frame.metadataSerial;
+			}
+			mSink->sendSurface(frame.buffer->getSurface(), frame.timecode);
+			mSent++;
+			if (mController || mProfiler) {
+				float sendMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+				if (mController) mController->addSample(sendMs, mQueue.size(), mQueue.capacity());
+				if (mProfiler) mProfiler->addCpuSample(mProfilerStage, sendMs);
+			}
+			if (mProfiler && mLatencyStage >= 0 && frame.receiveNs != 0) {
+				mProfiler->addCpuSample(mLatencyStage, (VDFrameStamp::now() - frame.receiveNs) / 1.0e6);
+			}
+			// hand the buffer back to the pool now rather than on the next pop
+			frame = VDOutputFrame();
+		}
+		else {
+			// the timeout covers a notify that lands between tryPop and wait
+			std::unique_lock<std::mutex> lock(mWakeMutex);
+			mWake.wait_for(lock, std::chrono::milliseconds(2));
+		}
+	}
+}
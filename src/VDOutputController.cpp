@@ -0,0 +1,70 @@
+#include "VDOutputController.h"
+
+#include "cinder/Log.h"
+
+using namespace videodromm;
+
+namespace {
+	// encode cost is roughly proportional to the pixel count
+	const float RES_COST_RATIO = 4.0f;
+	// step down above this share of the budget, step up only below the lower one
+	const float HIGH_WATER = 0.9f;
+	const float LOW_WATER = 0.6f;
+}
+
+VDOutputController::VDOutputController(const std::string &name, const Format &format)
+	: mName(name)
+	, mFormat(format)
+	, mLevel(FULL)
+	, mAverageMs(0.0f)
+	, mOverloaded(0)
+	, mHealthy(0)
+{
+}
+const char* VDOutputController::getLevelName(Level level)
+{
+	switch (level) {
+	case FULL: return "full";
+	case HALF_RATE: return "half rate";
+	case HALF_RATE_HALF_RES: return "half rate, half res";
+	default: return "unknown";
+	}
+}
+void VDOutputController::addSample(float sendMs, size_t queueDepth, size_t queueCapacity)
+{
+	float average = mAverageMs;
+	average = average > 0.0f ? average * 0.8f + sendMs * 0.2f : sendMs;
+	mAverageMs = average;
+
+	Level level = mLevel;
+	// at half rate every frame has two frame intervals
+	float budget = mFormat.mBudgetMs * getRateDivisor();
+	bool overloaded = average > budget * HIGH_WATER || queueDepth >= queueCapacity;
+	bool healthy = false;
+	if (level == HALF_RATE) {
+		healthy = average < mFormat.mBudgetMs * LOW_WATER;
+	}
+	else if (level == HALF_RATE_HALF_RES) {
+		healthy = average * RES_COST_RATIO < budget * LOW_WATER;
+	}
+	healthy = healthy && queueDepth == 0;
+
+	mOverloaded = overloaded ? mOverloaded + 1 : 0;
+	mHealthy = healthy ? mHealthy + 1 : 0;
+	if (mOverloaded >= mFormat.mDownSamples && level + 1 < LEVEL_COUNT) {
+		setLevel((Level)(level + 1), "overloaded");
+	}
+	else if (mHealthy >= mFormat.mUpSamples && level > FULL) {
+		setLevel((Level)(level - 1), "recovered");
+	}
+}
+void VDOutputController::setLevel(Level level, const char *reason)
+{
+	Level previous = mLevel.exchange(level);
+	// keep the average comparable across a resolution change
+	if (previous == HALF_RATE && level == HALF_RATE_HALF_RES) mAverageMs = mAverageMs / RES_COST_RATIO;
+	if (previous == HALF_RATE_HALF_RES && level == HALF_RATE) mAverageMs = mAverageMs * RES_COST_RATIO;
+	mOverloaded = 0;
+	mHealthy = 0;
+	CI_LOG_I("output " << mName << " " << reason << ": " << getLevelName(previous) << " -> " << getLevelName(level) << " (send " << mAverageMs << " ms, budget " << mFormat.mBudgetMs << " ms)");
+}
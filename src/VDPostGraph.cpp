@@ -0,0 +1,219 @@
+#include "VDPostGraph.h"
+
+#include "cinder/Log.h"
+#include "cinder/Utilities.h"
+
+#include <algorithm>
+
+using namespace ci;
+using namespace videodromm;
+
+VDPostGraph::VDPostGraph(const VDShaderManagerRef &shaders, const VDUniformBindingRef &uniforms, const VDRenderTargetsRef &targets)
+	: mShaders(shaders)
+	, mUniforms(uniforms)
+	, mTargets(targets)
+	, mSourceVersion(0)
+	, mSourceSignature(0)
+	, mPlanned(false)
+	, mRendered(0)
+	, mSkipped(0)
+{
+}
+GLint VDPostGraph::parseFormat(const std::string &name)
+{
+	if (name == "rgba8") return GL_RGBA8;
+	if (name == "rgb10a2") return GL_RGB10_A2;
+	if (name == "r11g11b10f") return GL_R11F_G11F_B10F;
+	if (name == "rgba16f") return GL_RGBA16F;
+	if (name == "rgba32f") return GL_RGBA32F;
+	return 0;
+}
+bool VDPostGraph::addPass(const PassFormat &format)
+{
+	Pass pass;
+	pass.name = format.mName;
+	pass.scale = glm::clamp(format.mScale, 0.0625f, 1.0f);
+	pass.internalFormat = format.mInternalFormat;
+	pass.transient = -1;
+	pass.version = 0;
+	pass.programId = 0;
+	pass.resolutionLocation = -1;
+	pass.allUniforms = format.mUniforms.empty();
+	for (const auto &input : format.mInputs) {
+		if (input == "source") {
+			pass.inputs.push_back(-1);
+			continue;
+		}
+		auto it = std::find_if(mPasses.begin(), mPasses.end(), [&input](const Pass &other) { return other.name == input; });
+		if (it == mPasses.end()) {
+			CI_LOG_E("VDPostGraph: pass " << pass.name << " reads unknown input " << input);
+			return false;
+		}
+		pass.inputs.push_back((int)(it - mPasses.begin()));
+	}
+	for (const auto &name : format.mUniforms) {
+		int index = mUniforms->getIndex(name);
+		if (index < 0) {
+			CI_LOG_W("VDPostGraph: pass " << pass.name << " depends on unknown uniform " << name);
+			continue;
+		}
+		pass.uniforms.push_back(index);
+	}
+	pass.shader = mShaders->load(pass.name, format.mVertex, format.mFragment);
+	mPasses.push_back(pass);
+	mPlanned = false;
+	CI_LOG_V("VDPostGraph: pass " << pass.name << " scale " << pass.scale << " inputs " << pass.inputs.size());
+	return true;
+}
+bool VDPostGraph::load(const XmlTree &graph, const fs::path &baseDir, const fs::path &defaultVertex)
+{
+	clear();
+	for (auto it = graph.begin("pass"); it != graph.end(); ++it) {
+		PassFormat format(it->getAttributeValue<std::string>("name", "pass" + toString(mPasses.size())));
+		format.vertex(it->hasAttribute("vertex") ? baseDir / it->getAttributeValue<std::string>("vertex") : defaultVertex);
+		format.fragment(baseDir / it->getAttributeValue<std::string>("fragment", ""));
+		format.scale(it->getAttributeValue<float>("scale", 1.0f));
+		GLint internalFormat = parseFormat(it->getAttributeValue<std::string>("format", "rgba8"));
+		if (internalFormat == 0) {
+			CI_LOG_W("VDPostGraph: unknown format " << it->getAttributeValue<std::string>("format") << ", using rgba8");
+			internalFormat = GL_RGBA8;
+		}
+		format.internalFormat(internalFormat);
+		for (const auto &input : split(it->getAttributeValue<std::string>("inputs", "source"), ",")) {
+			if (!input.empty()) format.input(input);
+		}
+		for (const auto &uniform : split(it->getAttributeValue<std::string>("uniforms", ""), ",")) {
+			if (!uniform.empty()) format.uniform(uniform);
+		}
+		if (!addPass(format)) {
+			clear();
+			return false;
+		}
+	}
+	return !mPasses.empty();
+}
+void VDPostGraph::clear()
+{
+	mPasses.clear();
+	mPlanned = false;
+}
+void VDPostGraph::setSource(const gl::Texture2dRef &texture, uint64_t signature)
+{
+	mSource = texture;
+	// a repeated frame leaves the passes that only read the source up to date
+	if (signature == 0 || signature != mSourceSignature) mSourceVersion++;
+	mSourceSignature = signature;
+}
+void VDPostGraph::plan(const ivec2 &outputSize)
+{
+	mTargets->beginPlan();
+	for (size_t i = 0; i + 1 < mPasses.size(); i++) {
+		Pass &pass = mPasses[i];
+		// alive from its own draw to the draw of its last reader
+		int lastUse = (int)i;
+		for (size_t j = i + 1; j < mPasses.size(); j++) {
+			if (std::find(mPasses[j].inputs.begin(), mPasses[j].inputs.end(), (int)i) != mPasses[j].inputs.end()) lastUse = (int)j;
+		}
+		ivec2 size = glm::max(ivec2(glm::ceil(vec2(outputSize) * pass.scale)), ivec2(1));
+		pass.transient = mTargets->addTransient(pass.name, VDRenderTargets::Desc(size, pass.internalFormat), (int)i, lastUse);
+	}
+	mTargets->endPlan();
+	for (auto &pass : mPasses) {
+		pass.target = pass.transient < 0 ? nullptr : mTargets->getTransient(pass.transient);
+		pass.key.clear();
+	}
+	mPasses.back().transient = -1;
+	mPasses.back().target.reset();
+	mWriters.clear();
+	mPlannedSize = outputSize;
+	mPlanned = true;
+}
+void VDPostGraph::makeKey(const Pass &pass, const gl::FboRef &fbo, std::vector<uint64_t> &key) const
+{
+	key.clear();
+	key.push_back(pass.shader->getProgram()->getId());
+	key.push_back((uint64_t)(uintptr_t)fbo.get());
+	key.push_back((uint64_t)fbo->getWidth() << 32 | (uint64_t)fbo->getHeight());
+	for (int input : pass.inputs) {
+		key.push_back(input < 0 ? mSourceVersion : mPasses[input].version);
+	}
+	if (pass.allUniforms) {
+		for (size_t i = 0; i < mUniforms->getCount(); i++) {
+			key.push_back(mUniforms->getVersion((int)i));
+		}
+	}
+	else {
+		for (int index : pass.uniforms) {
+			key.push_back(mUniforms->getVersion(index));
+		}
+	}
+}
+bool VDPostGraph::isReady() const
+{
+	if (mPasses.empty()) return false;
+	for (const auto &pass : mPasses) {
+		if (!pass.shader->isReady()) return false;
+	}
+	return true;
+}
+std::string VDPostGraph::getError() const
+{
+	for (const auto &pass : mPasses) {
+		if (!pass.shader->isReady() && !pass.shader->getError().empty()) return pass.name + ": " + pass.shader->getError();
+	}
+	return "";
+}
+bool VDPostGraph::render(const gl::FboRef &output)
+{
+	// keep showing the last complete result until the whole chain links
+	if (!mSource || !isReady()) return false;
+	if (!mPlanned || mPlannedSize != output->getSize()) {
+		plan(output->getSize());
+	}
+	gl::ScopedDepth scpDepth(false);
+	for (size_t i = 0; i < mPasses.size(); i++) {
+		Pass &pass = mPasses[i];
+		bool last = i + 1 == mPasses.size();
+		const gl::FboRef &fbo = last ? output : pass.target;
+		makeKey(pass, fbo, mKey);
+		// an aliased target may hold another pass's output by now
+		auto writer = mWriters.find(fbo.get());
+		if (mKey == pass.key && (last || (writer != mWriters.end() && writer->second == i))) {
+			mSkipped++;
+			continue;
+		}
+
+		gl::ScopedFramebuffer scpFb(fbo);
+		gl::ScopedViewport scpVp(ivec2(0), fbo->getSize());
+		// inputs before the program, like renderToFbo always did
+		for (size_t k = 0; k < pass.inputs.size(); k++) {
+			int input = pass.inputs[k];
+			(input < 0 ? mSource : mPasses[input].target->getColorTexture())->bind((uint8_t)k);
+		}
+		const VDShaderProgramRef &program = pass.shader->getProgram();
+		VDScopedProgram prog(program);
+		if (pass.programId != program->getId()) {
+			// new or reloaded program: samplers follow the input order
+			for (size_t k = 0; k < pass.inputs.size(); k++) {
+				GLint location = program->getUniformLocation(("iChannel" + toString(k)).c_str());
+				if (location >= 0) glUniform1i(location, (GLint)k);
+			}
+			pass.resolutionLocation = program->getUniformLocation("iPassResolution");
+			pass.programId = program->getId();
+		}
+		if (pass.resolutionLocation >= 0) {
+			glUniform2f(pass.resolutionLocation, (float)fbo->getWidth(), (float)fbo->getHeight());
+		}
+		mUniforms->apply(program);
+
+		gl::ScopedMatrices scpMat;
+		gl::setMatricesWindow(fbo->getSize());
+		program->drawRect(Rectf(fbo->getBounds()));
+
+		pass.key.swap(mKey);
+		if (!last) mWriters[fbo.get()] = i;
+		pass.version++;
+		mRendered++;
+	}
+	return true;
+}
@@ -0,0 +1,124 @@
+#include "VDPreviewCompositor.h"
+
+#include "cinder/Log.h"
+
+#include <algorithm>
+
+using namespace ci;
+using namespace videodromm;
+
+namespace {
+	const char *vertexShader = R"(
+#version 150
+uniform mat4	ciModelViewProjection;
+uniform vec4	uTileRect[16];
+uniform vec4	uTileUv[16];
+uniform int		uTileSource[16];
+in vec4			ciPosition;
+out vec2		vUv;
+flat out int	vSource;
+void main() {
+	vec4 rect = uTileRect[gl_InstanceID];
+	vec4 uv = uTileUv[gl_InstanceID];
+	vUv = mix(uv.xy, uv.zw, ciPosition.xy);
+	vSource = uTileSource[gl_InstanceID];
+	gl_Position = ciModelViewProjection * vec4(mix(rect.xy, rect.zw, ciPosition.xy), 0.0, 1.0);
+}
+)";
+	const char *fragmentShader = R"(
+#version 150
+uniform sampler2D	uTex0;
+uniform sampler2D	uTex1;
+in vec2				vUv;
+flat in int			vSource;
+out vec4			oColor;
+void main() {
+	// sample both outside the branch, implicit derivatives need uniform control flow
+	vec4 c0 = texture(uTex0, vUv);
+	vec4 c1 = texture(uTex1, vUv);
+	oColor = vSource == 0 ? c0 : c1;
+}
+)";
+}
+
+VDPreviewCompositor::VDPreviewCompositor()
+	: mMaxTileSize(1)
+{
+	for (int i = 0; i < MAX_SOURCES; i++) {
+		mVisible[i] = false;
+	}
+	mGlsl = gl::GlslProg::create(gl::GlslProg::Format().vertex(vertexShader).fragment(fragmentShader));
+	mGlsl->uniform("uTex0", 0);
+	mGlsl->uniform("uTex1", 1);
+	// unit quad, stretched per instance in the vertex shader
+	mBatch = gl::Batch::create(geom::Rect(Rectf(0, 0, 1, 1)), mGlsl);
+}
+std::vector<Rectf> VDPreviewCompositor::grid(int cols, int rows, const vec2 &tileSize, float margin)
+{
+	std::vector<Rectf> rects;
+	for (int row = 0; row < rows; row++) {
+		for (int col = 0; col < cols; col++) {
+			vec2 topLeft(col * (tileSize.x + margin), row * (tileSize.y + margin));
+			rects.push_back(Rectf(topLeft, topLeft + tileSize));
+		}
+	}
+	return rects;
+}
+void VDPreviewCompositor::setTiles(const std::vector<Tile> &tiles)
+{
+	if (tiles.size() > MAX_TILES) {
+		CI_LOG_W("VDPreviewCompositor: " << tiles.size() << " tiles, only " << MAX_TILES << " drawn");
+	}
+	mTiles.assign(tiles.begin(), tiles.begin() + std::min<size_t>(tiles.size(), MAX_TILES));
+	mMaxTileSize = ivec2(1);
+	for (const auto &tile : mTiles) {
+		mMaxTileSize = glm::max(mMaxTileSize, ivec2(glm::ceil(glm::abs(tile.rect.getSize()))));
+	}
+}
+void VDPreviewCompositor::setSource(int index, const gl::Texture2dRef &texture)
+{
+	mVisible[index] = (bool)texture;
+	if (!texture) return;
+
+	// smallest power of two reduction that still covers every tile
+	ivec2 size = texture->getSize();
+	while (size.x / 2 >= mMaxTileSize.x && size.y / 2 >= mMaxTileSize.y) {
+		size /= 2;
+	}
+	gl::FboRef &target = mTargets[index];
+	if (!target || target->getSize() != size) {
+		gl::Fbo::Format format;
+		format.colorTexture(gl::Texture2d::Format().mipmap().minFilter(GL_LINEAR_MIPMAP_LINEAR).magFilter(GL_LINEAR)).disableDepth();
+		target = gl::Fbo::create(size.x, size.y, format);
+	}
+	gl::ScopedFramebuffer scpFb(target);
+	gl::ScopedViewport scpVp(ivec2(0), size);
+	gl::ScopedMatrices scpMat;
+	gl::setMatricesWindow(size);
+	gl::draw(texture, Rectf(target->getBounds()));
+	// the Fbo regenerates the mip chain on the next getColorTexture(), once per frame
+}
+void VDPreviewCompositor::draw()
+{
+	mRects.clear();
+	mUvs.clear();
+	mSources.clear();
+	for (const auto &tile : mTiles) {
+		if (!mVisible[tile.source]) continue;
+		mRects.push_back(vec4(tile.rect.x1, tile.rect.y1, tile.rect.x2, tile.rect.y2));
+		// targets are bottom-up, the window is top-down
+		vec4 uv(0, 1, 1, 0);
+		if (tile.flipH) std::swap(uv.x, uv.z);
+		if (tile.flipV) std::swap(uv.y, uv.w);
+		mUvs.push_back(uv);
+		mSources.push_back(tile.source);
+	}
+	if (mRects.empty()) return;
+
+	gl::ScopedTextureBind tex0(mVisible[0] ? mTargets[0]->getColorTexture() : mTargets[1]->getColorTexture(), 0);
+	gl::ScopedTextureBind tex1(mVisible[1] ? mTargets[1]->getColorTexture() : mTargets[0]->getColorTexture(), 1);
+	mGlsl->uniform("uTileRect", mRects.data(), (int)mRects.size());
+	mGlsl->uniform("uTileUv", mUvs.data(), (int)mUvs.size());
+	mGlsl->uniform("uTileSource", mSources.data(), (int)mSources.size());
+	mBatch->drawInstanced((GLsizei)mRects.size());
+}
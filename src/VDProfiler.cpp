@@ -0,0 +1,143 @@
+#include "VDProfiler.h"
+#include "VDTracer.h"
+
+#include <cstdio>
+
+using namespace ci;
+using namespace videodromm;
+
+VDProfiler::VDProfiler()
+	: mGpuMissed(0)
+{
+}
+VDProfiler::~VDProfiler()
+{
+	for (auto &stage : mStages) {
+		if (stage->created) glDeleteQueries(GPU_LATENCY * 2, &stage->queries[0][0]);
+	}
+}
+int VDProfiler::addStage(const std::string &name)
+{
+	std::unique_ptr<Stage> stage(new Stage());
+	stage->name = name;
+	for (int i = 0; i < GPU_LATENCY; i++) {
+		stage->pending[i] = false;
+	}
+	stage->created = false;
+	stage->next = 0;
+	stage->active = false;
+	mStages.push_back(std::move(stage));
+	return (int)mStages.size() - 1;
+}
+void VDProfiler::beginGpu(int index)
+{
+	Stage &stage = *mStages[index];
+	if (!stage.created) {
+		glGenQueries(GPU_LATENCY * 2, &stage.queries[0][0]);
+		stage.created = true;
+	}
+	int slot = stage.next;
+	// the driver is more than GPU_LATENCY scopes behind, skip rather than wait
+	if (stage.pending[slot] && !collect(stage, slot)) {
+		mGpuMissed++;
+		stage.active = false;
+		return;
+	}
+	glQueryCounter(stage.queries[slot][0], GL_TIMESTAMP);
+	stage.active = true;
+}
+void VDProfiler::endGpu(int index)
+{
+	Stage &stage = *mStages[index];
+	if (!stage.active) return;
+	int slot = stage.next;
+	glQueryCounter(stage.queries[slot][1], GL_TIMESTAMP);
+	stage.pending[slot] = true;
+	stage.next = (slot + 1) % GPU_LATENCY;
+	stage.active = false;
+}
+bool VDProfiler::collect(Stage &stage, int slot)
+{
+	GLint available = 0;
+	glGetQueryObjectiv(stage.queries[slot][1], GL_QUERY_RESULT_AVAILABLE, &available);
+	if (!available) return false;
+	GLuint64 begin = 0, end = 0;
+	glGetQueryObjectui64v(stage.queries[slot][0], GL_QUERY_RESULT, &begin);
+	glGetQueryObjectui64v(stage.queries[slot][1], GL_QUERY_RESULT, &end);
+	stage.gpu.add(end > begin ? (end - begin) / 1.0e6 : 0.0);
+	stage.pending[slot] = false;
+	return true;
+}
+void VDProfiler::collect()
+{
+	for (auto &stage : mStages) {
+		for (int slot = 0; slot < GPU_LATENCY; slot++) {
+			if (stage->pending[slot]) collect(*stage, slot);
+		}
+	}
+}
+void VDProfiler::reset()
+{
+	for (auto &stage : mStages) {
+		stage->cpu.reset();
+		stage->gpu.reset();
+	}
+	mGpuMissed = 0;
+}
+std::string VDProfiler::getSummary(int index) const
+{
+	const Stage &stage = *mStages[index];
+	char line[160];
+	int length = std::snprintf(line, sizeof(line), "%s cpu %.2f/%.2f/%.2f", stage.name.c_str(),
+		stage.cpu.getPercentileMs(0.5), stage.cpu.getPercentileMs(0.95), stage.cpu.getPercentileMs(0.99));
+	if (stage.gpu.getCount() > 0 && length > 0 && length < (int)sizeof(line)) {
+		std::snprintf(line + length, sizeof(line) - length, " gpu %.2f/%.2f/%.2f",
+			stage.gpu.getPercentileMs(0.5), stage.gpu.getPercentileMs(0.95), stage.gpu.getPercentileMs(0.99));
+	}
+	return std::string(line) + " ms";
+}
+std::string VDProfiler::report() const
+{
+	std::string text;
+	char line[200];
+	std::snprintf(line, sizeof(line), "%-10s %8s %8s %8s %8s %8s | %8s %8s %8s %8s\n",
+		"stage", "samples", "cpu p50", "p95", "p99", "max", "gpu p50", "p95", "p99", "max");
+	text += line;
+	for (const auto &stage : mStages) {
+		const VDHistogram &cpu = stage->cpu;
+		const VDHistogram &gpu = stage->gpu;
+		if (gpu.getCount() > 0) {
+			std::snprintf(line, sizeof(line), "%-10s %8llu %8.3f %8.3f %8.3f %8.3f | %8.3f %8.3f %8.3f %8.3f\n", stage->name.c_str(), (unsigned long long)cpu.getCount(),
+				cpu.getPercentileMs(0.5), cpu.getPercentileMs(0.95), cpu.getPercentileMs(0.99), cpu.getMaxMs(),
+				gpu.getPercentileMs(0.5), gpu.getPercentileMs(0.95), gpu.getPercentileMs(0.99), gpu.getMaxMs());
+		}
+		else {
+			std::snprintf(line, sizeof(line), "%-10s %8llu %8.3f %8.3f %8.3f %8.3f | %8s\n", stage->name.c_str(), (unsigned long long)cpu.getCount(),
+				cpu.getPercentileMs(0.5), cpu.getPercentileMs(0.95), cpu.getPercentileMs(0.99), cpu.getMaxMs(), "-");
+		}
+		text += line;
+	}
+	if (mGpuMissed > 0) {
+		std::snprintf(line, sizeof(line), "%llu gpu scopes skipped, results were not ready\n", (unsigned long long)mGpuMissed);
+		text += line;
+	}
+	return text;
+}
+
+VDProfiler::ScopedTimer::ScopedTimer(VDProfiler *profiler, int stage, bool gpu)
+	: mProfiler(profiler)
+	, mStage(stage)
+	, mGpu(gpu)
+{
+	if (!mProfiler) return;
+	VDTracer::begin(mProfiler->getStageName(mStage).c_str());
+	if (mGpu) mProfiler->beginGpu(mStage);
+	mBegin = std::chrono::steady_clock::now();
+}
+VDProfiler::ScopedTimer::~ScopedTimer()
+{
+	if (!mProfiler) return;
+	mProfiler->addCpuSample(mStage, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - mBegin).count());
+	if (mGpu) mProfiler->endGpu(mStage);
+	VDTracer::end(mProfiler->getStageName(mStage).c_str());
+}
@@ -0,0 +1,23 @@
+#include "VDReadback.h"
+
+using namespace ci;
+using namespace videodromm;
+
+VDReadback::VDReadback(const VDFramePoolRef &pool)
+	: mPool(pool)
+{
+}
+VDFrameHandle VDReadback::read(const gl::Texture2dRef &texture)
+{
+	VDFrameHandle frame = mPool->acquire(texture->getWidth(), texture->getHeight(), SurfaceChannelOrder::BGRA);
+	gl::ScopedTextureBind scpTex(texture);
+	// write straight into the pooled rows, padding included
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+	glPixelStorei(GL_PACK_ROW_LENGTH, (GLint)(frame->getRowBytes() / 4));
+	glGetTexImage(texture->getTarget(), 0, GL_BGRA, GL_UNSIGNED_BYTE, frame->getData());
+	glPixelStorei(GL_PACK_ROW_LENGTH, 0);
+	if (!texture->isTopDown()) {
+		frame->flipVertical();
+	}
+	return frame;
+}
@@ -0,0 +1,235 @@
+#include "VDRecordingSink.h"
+#include "VDTileCodec.h"
+#include "VDTracer.h"
+
+#include "cinder/Log.h"
+
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+
+#if defined( _WIN32 )
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace ci;
+using namespace videodromm;
+
+namespace {
+	size_t alignUp(size_t bytes)
+	{
+		return (bytes + VDRAW_ALIGNMENT - 1) / VDRAW_ALIGNMENT * VDRAW_ALIGNMENT;
+	}
+	// the whole buffer at offset or nothing, never through the file position, so a
+	// failed or partial write cannot move later records; size, address and offset are
+	// VDRAW_ALIGNMENT multiples
+	bool writeAt(intptr_t file, const uint8_t *data, size_t bytes, uint64_t offset)
+	{
+		while (bytes > 0) {
+#if defined( _WIN32 )
+			OVERLAPPED overlapped = {};
+			overlapped.Offset = (DWORD)offset;
+			overlapped.OffsetHigh = (DWORD)(offset >> 32);
+			DWORD written = 0;
+			DWORD chunk = (DWORD)std::min<size_t>(bytes, 1u << 30);
+			if (!WriteFile((HANDLE)file, data, chunk, &written, &overlapped) || written == 0) return false;
+#else
+			ssize_t written = ::pwrite((int)file, data, bytes, (off_t)offset);
+			if (written < 0 && errno == EINTR) continue;
+			if (written <= 0) return false;
+#endif
+			data += written;
+			bytes -= written;
+			offset += written;
+		}
+		return true;
+	}
+}
+
+VDRecordingSink::VDRecordingSink(const fs::path &path, const Format &format)
+	: mPath(path)
+	, mName(format.mName.empty() ? path.filename().string() : format.mName)
+	, mFile(INVALID)
+	, mUnbuffered(true)
+	, mCompress(format.mCompress)
+	, mWorkers(format.mWorkers)
+	, mStaging(nullptr)
+	, mStagingCapacity(0)
+	, mStaged(0)
+	, mFileOffset(0)
+	, mFramesWritten(0)
+	, mBytesWritten(0)
+	, mWriteErrors(0)
+	, mWriteNs(0)
+	, mEncodeNs(0)
+	, mPixelBytes(0)
+	, mRecordBytes(0)
+{
+#if defined( _WIN32 )
+	HANDLE handle = CreateFileW(path.wstring().c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_NO_BUFFERING | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (handle != INVALID_HANDLE_VALUE) mFile = (intptr_t)handle;
+#else
+	int flags = O_WRONLY | O_CREAT | O_TRUNC;
+	int fd = -1;
+#if defined( O_DIRECT )
+	fd = ::open(path.string().c_str(), flags | O_DIRECT, 0644);
+#endif
+	// file systems without direct io (tmpfs, network shares) take buffered writes
+	if (fd < 0) {
+		fd = ::open(path.string().c_str(), flags, 0644);
+		mUnbuffered = false;
+	}
+#if defined( F_NOCACHE )
+	if (fd >= 0) mUnbuffered = ::fcntl(fd, F_NOCACHE, 1) == 0;
+#endif
+	mFile = fd;
+#endif
+	if (!isOpen()) {
+		CI_LOG_E("VDRecordingSink: cannot create " << path);
+		return;
+	}
+	VDRawFileHeader *header = reinterpret_cast<VDRawFileHeader*>(stage(alignUp(sizeof(VDRawFileHeader))));
+	std::memcpy(header->magic, "VDRAW\0\0\0", 8);
+	header->version = VDRAW_VERSION;
+	header->alignment = VDRAW_ALIGNMENT;
+	header->createdUnix = (int64_t)std::time(nullptr);
+	std::strncpy(header->name, mName.c_str(), sizeof(header->name) - 1);
+	CI_LOG_I("VDRecordingSink: recording to " << path << (mUnbuffered ? " (unbuffered)" : "") << (mCompress ? " compressed" : ""));
+}
+VDRecordingSink::~VDRecordingSink()
+{
+	close();
+}
+uint8_t* VDRecordingSink::stage(size_t bytes)
+{
+	if (mStaged + bytes > mStagingCapacity) {
+		size_t capacity = std::max(alignUp(mStaged + bytes), WRITE_SIZE * 2);
+		std::unique_ptr<uint8_t[]> memory(new uint8_t[capacity + VDRAW_ALIGNMENT]);
+		uint8_t *aligned = memory.get() + (VDRAW_ALIGNMENT - (uintptr_t)memory.get() % VDRAW_ALIGNMENT) % VDRAW_ALIGNMENT;
+		if (mStaged > 0) std::memcpy(aligned, mStaging, mStaged);
+		mStagingMemory = std::move(memory);
+		mStaging = aligned;
+		mStagingCapacity = capacity;
+	}
+	uint8_t *record = mStaging + mStaged;
+	// padding included, so the file holds zeros rather than stale memory
+	std::memset(record, 0, bytes);
+	mStaged += bytes;
+	return record;
+}
+bool VDRecordingSink::flush()
+{
+	if (mStaged == 0) return true;
+	VDTracer::Scope trace("disk write");
+	auto start = std::chrono::steady_clock::now();
+	bool written = writeAt(mFile, mStaging, mStaged, mFileOffset);
+	mWriteNs += (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+	if (written) {
+		mBytesWritten += mStaged;
+	}
+	else {
+		mWriteErrors++;
+		CI_LOG_E("VDRecordingSink: write failed at " << mFileOffset << " in " << mPath);
+		// the frames of this buffer never made it, the index forgets them
+		auto lost = std::find_if(mIndex.begin(), mIndex.end(), [this](const VDRawIndexEntry &entry) { return entry.offset >= mFileOffset; });
+		mFramesWritten -= (uint64_t)(mIndex.end() - lost);
+		mIndex.erase(lost, mIndex.end());
+	}
+	// the next buffer goes where this one ends either way: a failed write leaves a
+	// hole rather than shifting every later offset
+	mFileOffset += mStaged;
+	mStaged = 0;
+	return written;
+}
+void VDRecordingSink::sendSurface(Surface &surface, long long timecode)
+{
+	if (!isOpen()) return;
+	auto now = std::chrono::steady_clock::now();
+	if (mIndex.empty()) mFirstFrame = now;
+	const uint32_t rowBytes = surface.getWidth() * 4;
+	const size_t pixelBytes = (size_t)rowBytes * surface.getHeight();
+	size_t payloadBytes = pixelBytes;
+	if (mCompress) {
+		VDTracer::Scope trace("frame compress");
+		auto start = std::chrono::steady_clock::now();
+		VDTileCodec::encode(surface.getData(), surface.getRowBytes(), surface.getWidth(), surface.getHeight(), mPayload, mWorkers.get());
+		mEncodeNs += (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+		payloadBytes = mPayload.size();
+	}
+	const size_t recordBytes = alignUp(sizeof(VDRawFrameHeader) + payloadBytes);
+	uint8_t *record = stage(recordBytes);
+	VDRawFrameHeader *header = reinterpret_cast<VDRawFrameHeader*>(record);
+	std::memcpy(header->magic, "VDFR", 4);
+	header->width = surface.getWidth();
+	header->height = surface.getHeight();
+	header->rowBytes = rowBytes;
+	header->channelOrder = surface.getChannelOrder().getCode();
+	header->compression = mCompress ? VDRAW_TILE_LZ : VDRAW_RAW;
+	header->timecode = timecode;
+	header->timeNs = std::chrono::duration_cast<std::chrono::nanoseconds>(now - mFirstFrame).count();
+	header->frameIndex = mIndex.size();
+	header->recordBytes = recordBytes;
+	header->payloadBytes = mCompress ? payloadBytes : 0;
+	uint8_t *payload = record + sizeof(VDRawFrameHeader);
+	if (mCompress) {
+		std::memcpy(payload, mPayload.data(), payloadBytes);
+	}
+	else {
+		// packed rows, the pool's row padding stays out of the file
+		for (int32_t y = 0; y < surface.getHeight(); y++) {
+			std::memcpy(payload + (size_t)y * rowBytes, surface.getData() + y * surface.getRowBytes(), rowBytes);
+		}
+	}
+	mPixelBytes += pixelBytes;
+	mRecordBytes += recordBytes;
+	VDRawIndexEntry entry;
+	entry.offset = mFileOffset + (record - mStaging);
+	entry.timecode = header->timecode;
+	entry.timeNs = header->timeNs;
+	entry.width = header->width;
+	entry.height = header->height;
+	mIndex.push_back(entry);
+	mFramesWritten++;
+	if (mStaged >= WRITE_SIZE) flush();
+}
+void VDRecordingSink::close()
+{
+	if (!isOpen()) return;
+	// index and footer in one padded record, the footer ends the file
+	size_t indexBytes = mIndex.size() * sizeof(VDRawIndexEntry);
+	size_t recordBytes = alignUp(indexBytes + sizeof(VDRawFooter));
+	uint64_t indexOffset = mFileOffset + mStaged;
+	uint8_t *record = stage(recordBytes);
+	if (indexBytes > 0) std::memcpy(record, mIndex.data(), indexBytes);
+	VDRawFooter *footer = reinterpret_cast<VDRawFooter*>(record + recordBytes - sizeof(VDRawFooter));
+	std::memcpy(footer->magic, "VDRAWIDX", 8);
+	footer->frameCount = mIndex.size();
+	footer->indexOffset = indexOffset;
+	footer->indexBytes = indexBytes;
+	flush();
+#if defined( _WIN32 )
+	CloseHandle((HANDLE)mFile);
+#else
+	::close((int)mFile);
+#endif
+	mFile = INVALID;
+	CI_LOG_I("VDRecordingSink: " << mFramesWritten << " frames, " << mBytesWritten / (1024 * 1024) << " MB in " << mPath << ", " << getThroughputMBps() << " MB/s"
+		<< (mCompress ? ", ratio " + toString(getCompressionRatio()) + " encoded at " + toString(getEncodeSeconds() > 0.0 ? mPixelBytes / getEncodeSeconds() / (1024.0 * 1024.0) : 0.0) + " MB/s" : "")
+		<< (mWriteErrors > 0 ? ", write errors: " + toString(mWriteErrors) : ""));
+}
+double VDRecordingSink::getThroughputMBps() const
+{
+	double seconds = getWriteSeconds();
+	return seconds > 0.0 ? mBytesWritten / seconds / (1024.0 * 1024.0) : 0.0;
+}
+double VDRecordingSink::getCompressionRatio() const
+{
+	return mRecordBytes > 0 ? (double)mPixelBytes / mRecordBytes : 1.0;
+}
@@ -0,0 +1,156 @@
+#include "VDRenderTargets.h"
+
+#include "cinder/Log.h"
+
+#include <algorithm>
+#include <numeric>
+
+using namespace ci;
+using namespace videodromm;
+
+VDRenderTargets::VDRenderTargets()
+{
+}
+size_t VDRenderTargets::bytesPerPixel(GLint internalFormat)
+{
+	switch (internalFormat) {
+	case GL_RGBA16F: return 8;
+	case GL_RGBA32F: return 16;
+	case GL_RGB10_A2:
+	case GL_R11F_G11F_B10F:
+	case GL_RGBA8:
+	default: return 4;
+	}
+}
+int VDRenderTargets::allocate(const std::string &name, const Desc &desc, bool transient)
+{
+	gl::Fbo::Format format;
+	format.colorTexture(gl::Texture2d::Format().internalFormat(desc.internalFormat).minFilter(GL_LINEAR).magFilter(GL_LINEAR).wrap(GL_CLAMP_TO_EDGE));
+	if (desc.depth) {
+		format.depthTexture();
+	}
+	else {
+		format.disableDepth();
+	}
+	Target target;
+	target.name = name;
+	target.desc = desc;
+	target.fbo = gl::Fbo::create(desc.size.x, desc.size.y, format);
+	target.bytes = (size_t)desc.size.x * desc.size.y * (bytesPerPixel(desc.internalFormat) + (desc.depth ? 4 : 0));
+	target.transient = transient;
+	target.busyUntil = -1;
+	mTargets.push_back(target);
+	return (int)mTargets.size() - 1;
+}
+gl::FboRef VDRenderTargets::acquire(const std::string &name, const Desc &desc)
+{
+	for (auto &target : mTargets) {
+		if (target.transient || target.name != name) continue;
+		if (target.desc == desc) return target.fbo;
+		// resized or reformatted, the old one goes first so both never coexist
+		release(name);
+		break;
+	}
+	gl::FboRef fbo = mTargets[allocate(name, desc, false)].fbo;
+	logTotal(name.c_str());
+	return fbo;
+}
+void VDRenderTargets::release(const std::string &name)
+{
+	mTargets.erase(std::remove_if(mTargets.begin(), mTargets.end(), [&name](const Target &target) {
+		return !target.transient && target.name == name;
+	}), mTargets.end());
+}
+void VDRenderTargets::beginPlan()
+{
+	mRequests.clear();
+}
+int VDRenderTargets::addTransient(const std::string &name, const Desc &desc, int firstUse, int lastUse)
+{
+	Request request;
+	request.name = name;
+	request.desc = desc;
+	request.firstUse = firstUse;
+	request.lastUse = std::max(firstUse, lastUse);
+	request.target = -1;
+	mRequests.push_back(request);
+	return (int)mRequests.size() - 1;
+}
+void VDRenderTargets::endPlan()
+{
+	// persistent targets keep their indices, transients are reassigned from scratch
+	for (auto &target : mTargets) {
+		if (!target.transient) continue;
+		target.name.clear();
+		target.busyUntil = -1;
+	}
+	std::vector<int> order(mRequests.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [this](int a, int b) { return mRequests[a].firstUse < mRequests[b].firstUse; });
+	size_t allocated = 0;
+	for (int index : order) {
+		Request &request = mRequests[index];
+		// greedy interval colouring: any target of the same kind that is free by then
+		for (size_t i = 0; i < mTargets.size(); i++) {
+			Target &target = mTargets[i];
+			if (target.transient && target.desc == request.desc && target.busyUntil < request.firstUse) {
+				request.target = (int)i;
+				break;
+			}
+		}
+		if (request.target < 0) {
+			request.target = allocate("", request.desc, true);
+			allocated++;
+		}
+		Target &target = mTargets[request.target];
+		target.name += (target.name.empty() ? "" : "+") + request.name;
+		target.busyUntil = request.lastUse;
+	}
+	// drop what the new plan does not use, and remap the requests
+	std::vector<int> remap(mTargets.size(), -1);
+	size_t kept = 0, released = 0;
+	for (size_t i = 0; i < mTargets.size(); i++) {
+		if (mTargets[i].transient && mTargets[i].busyUntil < 0) {
+			released++;
+			continue;
+		}
+		remap[i] = (int)kept;
+		if (kept != i) mTargets[kept] = std::move(mTargets[i]);
+		kept++;
+	}
+	mTargets.resize(kept);
+	for (auto &request : mRequests) {
+		request.target = remap[request.target];
+	}
+	if (allocated || released) {
+		logTotal("plan");
+	}
+}
+std::vector<VDRenderTargets::Usage> VDRenderTargets::getUsage() const
+{
+	std::vector<Usage> usage;
+	for (const auto &target : mTargets) {
+		Usage entry;
+		entry.name = target.name;
+		entry.desc = target.desc;
+		entry.bytes = target.bytes;
+		entry.transient = target.transient;
+		usage.push_back(entry);
+	}
+	return usage;
+}
+size_t VDRenderTargets::getBytes() const
+{
+	size_t bytes = 0;
+	for (const auto &target : mTargets) {
+		bytes += target.bytes;
+	}
+	return bytes;
+}
+void VDRenderTargets::logTotal(const char *reason) const
+{
+	CI_LOG_I("VDRenderTargets " << reason << ": " << mTargets.size() << " targets, " << (getBytes() >> 20) << " MB");
+	for (const auto &target : mTargets) {
+		CI_LOG_V("  " << target.name << " " << target.desc.size.x << "x" << target.desc.size.y << (target.desc.depth ? " +depth " : " ") << (target.bytes >> 10) << " KB");
+	}
+}
@@ -0,0 +1,268 @@
+#include "VDReplaySource.h"
+#include "VDTileCodec.h"
+#include "VDTracer.h"
+
+#include "cinder/Log.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined( _WIN32 )
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace ci;
+using namespace videodromm;
+
+namespace {
+	const intptr_t INVALID = -1;
+
+	size_t pageSize()
+	{
+#if defined( _WIN32 )
+		SYSTEM_INFO info;
+		GetSystemInfo(&info);
+		return info.dwPageSize;
+#else
+		return (size_t)sysconf(_SC_PAGESIZE);
+#endif
+	}
+}
+
+VDReplaySource::VDReplaySource(const fs::path &path, const Format &format)
+	: mName(path.filename().string())
+	, mRealtime(format.mRealtime)
+	, mLoop(format.mLoop)
+	, mPixels(format.mPixels)
+	, mReadahead(std::max(format.mReadahead, 0))
+	, mFile(INVALID)
+	, mMapping(INVALID)
+	, mData(nullptr)
+	, mSize(0)
+	, mPosition(0)
+	, mStarted(false)
+	, mEnded(false)
+{
+#if defined( _WIN32 )
+	HANDLE file = CreateFileW(path.wstring().c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file != INVALID_HANDLE_VALUE) {
+		mFile = (intptr_t)file;
+		LARGE_INTEGER size;
+		if (GetFileSizeEx(file, &size)) mSize = (uint64_t)size.QuadPart;
+		HANDLE mapping = mSize > 0 ? CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+		if (mapping) {
+			mMapping = (intptr_t)mapping;
+			mData = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+		}
+	}
+#else
+	int fd = ::open(path.string().c_str(), O_RDONLY);
+	if (fd >= 0) {
+		mFile = fd;
+		struct stat info;
+		if (fstat(fd, &info) == 0) mSize = (uint64_t)info.st_size;
+		void *data = mSize > 0 ? mmap(nullptr, mSize, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+		if (data != MAP_FAILED) {
+			mData = static_cast<const uint8_t*>(data);
+			// mostly forward, let the kernel read ahead aggressively
+			madvise(data, mSize, MADV_SEQUENTIAL);
+		}
+	}
+#endif
+	if (!mData) {
+		CI_LOG_E("VDReplaySource: cannot map " << path);
+		return;
+	}
+	VDRawFileHeader header;
+	if (mSize < VDRAW_ALIGNMENT || std::memcmp(mData, "VDRAW\0\0\0", 8) != 0) {
+		CI_LOG_E("VDReplaySource: not a vdraw recording: " << path);
+		return;
+	}
+	std::memcpy(&header, mData, sizeof(header));
+	header.name[sizeof(header.name) - 1] = 0;
+	if (header.name[0]) mName = header.name;
+	// index from the footer, or rebuilt from the frame headers if the recorder never closed the file
+	VDRawFooter footer;
+	std::memcpy(&footer, mData + mSize - sizeof(footer), sizeof(footer));
+	if (std::memcmp(footer.magic, "VDRAWIDX", 8) == 0 && footer.indexOffset <= mSize && footer.indexBytes <= mSize - footer.indexOffset
+		&& footer.indexBytes % sizeof(VDRawIndexEntry) == 0 && footer.frameCount == footer.indexBytes / sizeof(VDRawIndexEntry)) {
+		// a damaged or foreign index must not send reads past the mapping
+		const VDRawIndexEntry *entries = reinterpret_cast<const VDRawIndexEntry*>(mData + footer.indexOffset);
+		mIndex.reserve(footer.frameCount);
+		for (uint64_t i = 0; i < footer.frameCount; i++) {
+			VDRawIndexEntry entry;
+			std::memcpy(&entry, entries + i, sizeof(entry));
+			if (isValidRecord(entry.offset)) mIndex.push_back(entry);
+		}
+		if (mIndex.size() < footer.frameCount) CI_LOG_W("VDReplaySource: skipped " << footer.frameCount - mIndex.size() << " bad index entries in " << path);
+	}
+	else {
+		CI_LOG_W("VDReplaySource: no index in " << path << ", scanning frames");
+		uint64_t offset = header.alignment > 0 ? (sizeof(VDRawFileHeader) + header.alignment - 1) / header.alignment * header.alignment : VDRAW_ALIGNMENT;
+		while (offset + sizeof(VDRawFrameHeader) <= mSize) {
+			if (!isValidRecord(offset)) break;
+			const VDRawFrameHeader *frame = reinterpret_cast<const VDRawFrameHeader*>(mData + offset);
+			VDRawIndexEntry entry;
+			entry.offset = offset;
+			entry.timecode = frame->timecode;
+			entry.timeNs = frame->timeNs;
+			entry.width = frame->width;
+			entry.height = frame->height;
+			mIndex.push_back(entry);
+			offset += frame->recordBytes;
+		}
+	}
+	CI_LOG_I("VDReplaySource: " << mIndex.size() << " frames from " << path << (mRealtime ? " in real time" : " as fast as possible"));
+}
+VDReplaySource::~VDReplaySource()
+{
+#if defined( _WIN32 )
+	if (mData) UnmapViewOfFile(mData);
+	if (mMapping != INVALID) CloseHandle((HANDLE)mMapping);
+	if (mFile != INVALID) CloseHandle((HANDLE)mFile);
+#else
+	if (mData) munmap(const_cast<uint8_t*>(mData), mSize);
+	if (mFile != INVALID) ::close((int)mFile);
+#endif
+}
+bool VDReplaySource::isValidRecord(uint64_t offset) const
+{
+	if (offset > mSize || mSize - offset < sizeof(VDRawFrameHeader)) return false;
+	VDRawFrameHeader header;
+	std::memcpy(&header, mData + offset, sizeof(header));
+	if (std::memcmp(header.magic, "VDFR", 4) != 0) return false;
+	if (header.recordBytes < sizeof(VDRawFrameHeader) || header.recordBytes > mSize - offset) return false;
+	if ((uint64_t)header.width * 4 > header.rowBytes) return false;
+	const uint64_t payloadRoom = header.recordBytes - sizeof(VDRawFrameHeader);
+	if (header.compression == VDRAW_RAW) return (uint64_t)header.height * header.rowBytes <= payloadRoom;
+	return header.compression == VDRAW_TILE_LZ && header.payloadBytes <= payloadRoom;
+}
+VDReplaySource::Frame VDReplaySource::getFrame(size_t index) const
+{
+	Frame frame;
+	frame.header = reinterpret_cast<const VDRawFrameHeader*>(mData + mIndex[index].offset);
+	frame.pixels = mData + mIndex[index].offset + sizeof(VDRawFrameHeader);
+	return frame;
+}
+bool VDReplaySource::readPixels(const Frame &frame, uint8_t *pixels, ptrdiff_t rowBytes)
+{
+	const VDRawFrameHeader &header = *frame.header;
+	if (header.compression == VDRAW_RAW) {
+		for (uint32_t y = 0; y < header.height; y++) {
+			std::memcpy(pixels + y * rowBytes, frame.pixels + (size_t)y * header.rowBytes, header.width * 4);
+		}
+		return true;
+	}
+	if (header.compression != VDRAW_TILE_LZ || sizeof(VDRawFrameHeader) + header.payloadBytes > header.recordBytes) {
+		CI_LOG_W("VDReplaySource: cannot read frame " << header.frameIndex << " of " << mName);
+		return false;
+	}
+	VDTracer::Scope trace("frame decompress");
+	if (!mWorkers) mWorkers = VDWorkerPool::create("replay decode");
+	if (!VDTileCodec::decode(frame.pixels, (size_t)header.payloadBytes, header.width, header.height, pixels, rowBytes, mWorkers.get())) {
+		CI_LOG_W("VDReplaySource: damaged frame " << header.frameIndex << " in " << mName);
+		return false;
+	}
+	return true;
+}
+int64_t VDReplaySource::advance()
+{
+	if (mIndex.empty() || mEnded) return -1;
+	auto now = std::chrono::steady_clock::now();
+	if (!mStarted) {
+		mStarted = true;
+		mStart = now;
+		mPosition = 0;
+		prefetch(0);
+		return 0;
+	}
+	size_t next = mPosition + 1;
+	if (mRealtime) {
+		int64_t elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(now - mStart).count();
+		if (next >= mIndex.size()) {
+			// the last frame stays up for one average frame time
+			int64_t last = mIndex.back().timeNs;
+			int64_t period = mIndex.size() > 1 ? last / (int64_t)(mIndex.size() - 1) : 0;
+			if (elapsed < last + period) return -1;
+			if (!mLoop) {
+				mEnded = true;
+				return -1;
+			}
+			mStart = now;
+			next = 0;
+		}
+		else {
+			if (mIndex[next].timeNs > elapsed) return -1;
+			// late: skip to the newest frame that is due, like a live sender
+			while (next + 1 < mIndex.size() && mIndex[next + 1].timeNs <= elapsed) next++;
+		}
+	}
+	else if (next >= mIndex.size()) {
+		if (!mLoop) {
+			mEnded = true;
+			return -1;
+		}
+		next = 0;
+	}
+	mPosition = next;
+	prefetch(next);
+	return (int64_t)next;
+}
+void VDReplaySource::prefetch(size_t index)
+{
+	// the frames after this one, the current one is read right away anyway
+	size_t first = index + 1;
+	size_t last = std::min(index + mReadahead, mIndex.size() - 1);
+	if (mReadahead == 0 || first > last) return;
+	static const size_t page = pageSize();
+	uint64_t begin = mIndex[first].offset / page * page;
+	const VDRawFrameHeader *header = reinterpret_cast<const VDRawFrameHeader*>(mData + mIndex[last].offset);
+	uint64_t end = std::min<uint64_t>(mIndex[last].offset + header->recordBytes, mSize);
+#if defined( _WIN32 )
+#if _WIN32_WINNT >= 0x0602
+	WIN32_MEMORY_RANGE_ENTRY range;
+	range.VirtualAddress = const_cast<uint8_t*>(mData + begin);
+	range.NumberOfBytes = (SIZE_T)(end - begin);
+	PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#endif
+#else
+	madvise(const_cast<uint8_t*>(mData + begin), end - begin, MADV_WILLNEED);
+#endif
+}
+gl::Texture2dRef VDReplaySource::receive()
+{
+	int64_t index = advance();
+	if (mEnded || mIndex.empty()) return nullptr;
+	if (index >= 0) {
+		Frame frame = getFrame((size_t)index);
+		// raw frames straight from the mapping, no copy on our side
+		const uint8_t *pixels = frame.pixels;
+		if (frame.header->compression != VDRAW_RAW) {
+			mDecoded.resize((size_t)frame.header->rowBytes * frame.header->height);
+			if (!readPixels(frame, mDecoded.data(), frame.header->rowBytes)) return mTexture;
+			pixels = mDecoded.data();
+		}
+		Surface8u surface(const_cast<uint8_t*>(pixels), frame.header->width, frame.header->height, frame.header->rowBytes, SurfaceChannelOrder(frame.header->channelOrder));
+		if (mTexture && mTexture->getSize() == ivec2(frame.header->width, frame.header->height)) mTexture->update(surface);
+		else mTexture = gl::Texture2d::create(surface, gl::Texture2d::Format().loadTopDown());
+	}
+	return mTexture;
+}
+VDFrameHandle VDReplaySource::receivePixels(VDFramePool &pool)
+{
+	advance();
+	if (mEnded || mIndex.empty()) return VDFrameHandle();
+	// the current frame again while the next one is not due, like a memory share sender
+	Frame frame = getFrame(mPosition);
+	VDFrameHandle buffer = pool.acquire(frame.header->width, frame.header->height, SurfaceChannelOrder(frame.header->channelOrder));
+	if (!readPixels(frame, buffer->getData(), buffer->getRowBytes())) return VDFrameHandle();
+	return buffer;
+}
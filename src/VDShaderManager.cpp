@@ -0,0 +1,292 @@
+#include "VDShaderManager.h"
+
+#include "cinder/app/App.h"
+#include "cinder/Log.h"
+
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+using namespace ci;
+using namespace videodromm;
+
+namespace {
+	const uint32_t BINARY_MAGIC = 0x42534456; // "VDSB"
+
+	uint64_t fnv1a(const std::string &data, uint64_t hash = 14695981039346656037ULL)
+	{
+		for (unsigned char c : data) {
+			hash ^= c;
+			hash *= 1099511628211ULL;
+		}
+		return hash;
+	}
+	std::string readFile(const fs::path &path)
+	{
+		std::ifstream file(path.string(), std::ios::binary);
+		std::stringstream ss;
+		ss << file.rdbuf();
+		return ss.str();
+	}
+	// fs is boost or std filesystem depending on the Cinder build, compare raw ticks
+	template<typename T>
+	int64_t ticks(const T &time) { return (int64_t)time.time_since_epoch().count(); }
+	inline int64_t ticks(std::time_t time) { return (int64_t)time; }
+
+	int64_t writeTime(const fs::path &path)
+	{
+		try {
+			return fs::exists(path) ? ticks(fs::last_write_time(path)) : 0;
+		}
+		catch (...) {
+			// mid-save in an editor, try again next poll
+			return 0;
+		}
+	}
+	std::string glString(GLenum name)
+	{
+		const GLubyte *str = glGetString(name);
+		return str ? reinterpret_cast<const char*>(str) : "";
+	}
+}
+
+VDShader::VDShader(const std::string &name, const fs::path &vertexPath, const fs::path &fragmentPath)
+	: mName(name)
+	, mVertexPath(vertexPath)
+	, mFragmentPath(fragmentPath)
+	, mVertexTime(writeTime(vertexPath))
+	, mFragmentTime(writeTime(fragmentPath))
+	, mVersion(0)
+	, mPending(false)
+{
+}
+
+VDShaderManager::VDShaderManager(const fs::path &cacheDir)
+	: mCacheDir(cacheDir)
+	, mRunning(true)
+	, mWatchInterval(0.5)
+	, mLastWatch(0.0)
+	, mCacheHits(0)
+	, mCompiles(0)
+{
+	// binaries are only valid for the driver that produced them
+	mDriver = glString(GL_VENDOR) + "|" + glString(GL_RENDERER) + "|" + glString(GL_VERSION);
+	try {
+		fs::create_directories(mCacheDir);
+	}
+	catch (...) {
+		CI_LOG_W("shader cache: cannot create " << mCacheDir);
+	}
+	mBackgroundContext = gl::Context::create(gl::context());
+	mThread = std::thread(&VDShaderManager::run, this);
+}
+VDShaderManager::~VDShaderManager()
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mRunning = false;
+	}
+	mCondition.notify_one();
+	mThread.join();
+	for (auto &result : mResults) {
+		if (result.fence) glDeleteSync(result.fence);
+		if (result.handle) glDeleteProgram(result.handle);
+	}
+}
+VDShaderRef VDShaderManager::load(const std::string &name, const fs::path &vertexPath, const fs::path &fragmentPath)
+{
+	VDShaderRef shader = std::make_shared<VDShader>(name, vertexPath, fragmentPath);
+	mShaders.push_back(shader);
+	queue(shader);
+	return shader;
+}
+void VDShaderManager::queue(const VDShaderRef &shader)
+{
+	shader->mPending = true;
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mJobs.push_back(Job{ shader, shader->mVertexPath, shader->mFragmentPath });
+	}
+	mCondition.notify_one();
+}
+void VDShaderManager::update()
+{
+	// swap in programs whose link the GPU has finished, never wait for one
+	std::vector<Result> ready;
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		for (auto it = mResults.begin(); it != mResults.end();) {
+			if (!it->fence || glClientWaitSync(it->fence, 0, 0) != GL_TIMEOUT_EXPIRED) {
+				ready.push_back(*it);
+				it = mResults.erase(it);
+			}
+			else {
+				++it;
+			}
+		}
+	}
+	for (auto &result : ready) {
+		if (result.fence) glDeleteSync(result.fence);
+		VDShaderRef &shader = result.shader;
+		shader->mPending = false;
+		if (result.handle) {
+			// the previous program goes away with its last reference
+			shader->mProgram = VDShaderProgram::create(result.handle, shader->mName);
+			shader->mVersion++;
+			shader->mError.clear();
+			CI_LOG_I("shader " << shader->mName << " ready, version " << shader->mVersion);
+		}
+		else {
+			shader->mError = result.error;
+			CI_LOG_E("shader " << shader->mName << " failed, keeping version " << shader->mVersion << ": " << result.error);
+		}
+	}
+	// hot reload
+	double now = app::getElapsedSeconds();
+	if (now - mLastWatch < mWatchInterval) return;
+	mLastWatch = now;
+	for (auto &shader : mShaders) {
+		int64_t vertexTime = writeTime(shader->mVertexPath);
+		int64_t fragmentTime = writeTime(shader->mFragmentPath);
+		// a save during a compile is picked up on the first watch after it finishes:
+		// the times are only taken when the files are actually queued
+		if (!shader->mPending && (vertexTime != shader->mVertexTime || fragmentTime != shader->mFragmentTime)) {
+			shader->mVertexTime = vertexTime;
+			shader->mFragmentTime = fragmentTime;
+			CI_LOG_I("shader " << shader->mName << " changed, recompiling");
+			queue(shader);
+		}
+	}
+}
+void VDShaderManager::run()
+{
+	mBackgroundContext->makeCurrent();
+	for (;;) {
+		Job job;
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mCondition.wait(lock, [this] { return !mRunning || !mJobs.empty(); });
+			if (!mRunning) return;
+			job = mJobs.front();
+			mJobs.pop_front();
+		}
+		Result result;
+		result.shader = job.shader;
+		result.handle = 0;
+		result.fence = nullptr;
+		std::string vertex = readFile(job.vertexPath);
+		std::string fragment = readFile(job.fragmentPath);
+		if (vertex.empty() || fragment.empty()) {
+			result.error = "cannot read " + (vertex.empty() ? job.vertexPath : job.fragmentPath).string();
+		}
+		else {
+			std::stringstream key;
+			key << std::hex << std::setw(16) << std::setfill('0') << fnv1a(fragment, fnv1a(vertex, fnv1a(mDriver)));
+			fs::path binaryPath = mCacheDir / (key.str() + ".bin");
+			result.handle = loadBinary(binaryPath);
+			if (result.handle) {
+				mCacheHits++;
+			}
+			else {
+				result.handle = build(vertex, fragment, result.error);
+				mCompiles++;
+				if (result.handle) saveBinary(result.handle, binaryPath);
+			}
+		}
+		if (result.handle) {
+			// the render context may only use the program once this context's commands are done
+			result.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+			glFlush();
+		}
+		std::lock_guard<std::mutex> lock(mMutex);
+		mResults.push_back(result);
+	}
+}
+GLuint VDShaderManager::build(const std::string &vertex, const std::string &fragment, std::string &error)
+{
+	GLuint shaders[2] = { glCreateShader(GL_VERTEX_SHADER), glCreateShader(GL_FRAGMENT_SHADER) };
+	const std::string *sources[2] = { &vertex, &fragment };
+	GLuint handle = glCreateProgram();
+	for (int i = 0; i < 2; i++) {
+		const char *source = sources[i]->c_str();
+		glShaderSource(shaders[i], 1, &source, nullptr);
+		glCompileShader(shaders[i]);
+		GLint status = GL_FALSE;
+		glGetShaderiv(shaders[i], GL_COMPILE_STATUS, &status);
+		if (status != GL_TRUE) {
+			char log[4096];
+			glGetShaderInfoLog(shaders[i], sizeof(log), nullptr, log);
+			error += (i == 0 ? "vertex: " : "fragment: ") + std::string(log);
+		}
+		glAttachShader(handle, shaders[i]);
+	}
+	if (error.empty()) {
+		VDShaderProgram::bindAttribLocations(handle);
+		glProgramParameteri(handle, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+		glLinkProgram(handle);
+		GLint status = GL_FALSE;
+		glGetProgramiv(handle, GL_LINK_STATUS, &status);
+		if (status != GL_TRUE) {
+			char log[4096];
+			glGetProgramInfoLog(handle, sizeof(log), nullptr, log);
+			error = "link: " + std::string(log);
+		}
+	}
+	for (GLuint shader : shaders) {
+		glDetachShader(handle, shader);
+		glDeleteShader(shader);
+	}
+	if (!error.empty()) {
+		glDeleteProgram(handle);
+		return 0;
+	}
+	return handle;
+}
+GLuint VDShaderManager::loadBinary(const fs::path &path)
+{
+	std::ifstream file(path.string(), std::ios::binary);
+	if (!file) return 0;
+	uint32_t magic = 0, format = 0;
+	file.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+	file.read(reinterpret_cast<char*>(&format), sizeof(format));
+	std::vector<char> binary((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	if (magic != BINARY_MAGIC || binary.empty()) return 0;
+
+	GLuint handle = glCreateProgram();
+	glProgramBinary(handle, format, binary.data(), (GLsizei)binary.size());
+	GLint status = GL_FALSE;
+	glGetProgramiv(handle, GL_LINK_STATUS, &status);
+	if (status != GL_TRUE) {
+		// driver rejected it (update with the same version string), rebuild and overwrite
+		CI_LOG_W("shader cache: stale binary " << path.filename());
+		glDeleteProgram(handle);
+		return 0;
+	}
+	return handle;
+}
+void VDShaderManager::saveBinary(GLuint handle, const fs::path &path)
+{
+	GLint length = 0;
+	glGetProgramiv(handle, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0) return;
+	std::vector<char> binary(length);
+	GLenum format = 0;
+	glGetProgramBinary(handle, length, nullptr, &format, binary.data());
+	// write then rename, a crash never leaves a truncated entry behind
+	fs::path temp = path;
+	temp += ".tmp";
+	{
+		std::ofstream file(temp.string(), std::ios::binary | std::ios::trunc);
+		uint32_t magic = BINARY_MAGIC, format32 = format;
+		file.write(reinterpret_cast<const char*>(&magic), sizeof(magic));
+		file.write(reinterpret_cast<const char*>(&format32), sizeof(format32));
+		file.write(binary.data(), binary.size());
+		if (!file) return;
+	}
+	try {
+		fs::rename(temp, path);
+	}
+	catch (...) {
+		CI_LOG_W("shader cache: cannot write " << path);
+	}
+}
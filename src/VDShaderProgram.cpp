@@ -0,0 +1,69 @@
+#include "VDShaderProgram.h"
+
+#include <atomic>
+
+using namespace ci;
+using namespace videodromm;
+
+namespace {
+	std::atomic<uint64_t> sNextId(1);
+}
+
+VDShaderProgram::VDShaderProgram(GLuint handle, const std::string &name)
+	: mHandle(handle)
+	, mId(sNextId++)
+	, mName(name)
+{
+	mMvpLocation = glGetUniformLocation(mHandle, "ciModelViewProjection");
+}
+VDShaderProgram::~VDShaderProgram()
+{
+	glDeleteProgram(mHandle);
+}
+void VDShaderProgram::bindAttribLocations(GLuint handle)
+{
+	glBindAttribLocation(handle, ATTRIB_POSITION, "ciPosition");
+	glBindAttribLocation(handle, ATTRIB_TEXCOORD0, "ciTexCoord0");
+	glBindAttribLocation(handle, ATTRIB_COLOR, "ciColor");
+}
+void VDShaderProgram::drawRect(const Rectf &rect)
+{
+	if (!mVao) {
+		// unit quad, uv like gl::drawSolidRect: upper left (0, 1), lower right (1, 0)
+		const GLfloat data[] = {
+			0, 0, 0, 1,
+			1, 0, 1, 1,
+			0, 1, 0, 0,
+			1, 1, 1, 0
+		};
+		mVbo = gl::Vbo::create(GL_ARRAY_BUFFER, sizeof(data), data, GL_STATIC_DRAW);
+		mVao = gl::Vao::create();
+		gl::ScopedVao scpVao(mVao);
+		gl::ScopedBuffer scpVbo(mVbo);
+		gl::enableVertexAttribArray(ATTRIB_POSITION);
+		gl::vertexAttribPointer(ATTRIB_POSITION, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(GLfloat), (const GLvoid*)0);
+		gl::enableVertexAttribArray(ATTRIB_TEXCOORD0);
+		gl::vertexAttribPointer(ATTRIB_TEXCOORD0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(GLfloat), (const GLvoid*)(2 * sizeof(GLfloat)));
+	}
+	if (mMvpLocation >= 0) {
+		mat4 model = glm::scale(glm::translate(mat4(1), vec3(rect.x1, rect.y1, 0)), vec3(rect.getWidth(), rect.getHeight(), 1));
+		mat4 mvp = gl::getModelViewProjection() * model;
+		glUniformMatrix4fv(mMvpLocation, 1, GL_FALSE, &mvp[0][0]);
+	}
+	gl::ScopedVao scpVao(mVao);
+	// white like the default gl::color
+	glVertexAttrib4f(ATTRIB_COLOR, 1, 1, 1, 1);
+	gl::drawArrays(GL_TRIANGLE_STRIP, 0, 4);
+}
+
+VDScopedProgram::VDScopedProgram(const VDShaderProgramRef &program)
+{
+	// Cinder believes no program is bound until the pop, so it rebinds its own afterwards
+	gl::context()->pushGlslProg(nullptr);
+	glUseProgram(program->getHandle());
+}
+VDScopedProgram::~VDScopedProgram()
+{
+	glUseProgram(0);
+	gl::context()->popGlslProg();
+}
@@ -0,0 +1,189 @@
+#include "VDSharedFrame.h"
+#include "VDFrameStamp.h"
+
+#include "cinder/Log.h"
+
+#include <cstring>
+
+#if defined( _WIN32 )
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace ci;
+using namespace videodromm;
+
+namespace {
+	const intptr_t INVALID = -1;
+
+#if !defined( _WIN32 )
+	// POSIX shared memory names are one path component with a leading slash
+	std::string segmentName(const std::string &name)
+	{
+		std::string segment = "/" + name;
+		for (size_t i = 1; i < segment.size(); i++) {
+			if (segment[i] == '/') segment[i] = '_';
+		}
+		return segment;
+	}
+#endif
+}
+
+VDSharedFrameWriter::VDSharedFrameWriter(const std::string &name, const ivec2 &size)
+	: mName(name)
+	, mSize(size)
+	, mHandle(INVALID)
+	, mBytes(sizeof(VDSharedFrameHeader) + (size_t)size.x * size.y * 4)
+	, mHeader(nullptr)
+	, mFramesWritten(0)
+{
+	void *data = nullptr;
+#if defined( _WIN32 )
+	HANDLE mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, (DWORD)((uint64_t)mBytes >> 32), (DWORD)mBytes, name.c_str());
+	if (mapping) {
+		mHandle = (intptr_t)mapping;
+		data = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, mBytes);
+	}
+#else
+	int fd = shm_open(segmentName(name).c_str(), O_RDWR | O_CREAT, 0644);
+	if (fd >= 0) {
+		mHandle = fd;
+		if (ftruncate(fd, (off_t)mBytes) == 0) {
+			data = mmap(nullptr, mBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+			if (data == MAP_FAILED) data = nullptr;
+		}
+	}
+#endif
+	if (!data) {
+		CI_LOG_E("VDSharedFrameWriter: cannot create " << name);
+		return;
+	}
+	mHeader = static_cast<VDSharedFrameHeader*>(data);
+	mHeader->width = size.x;
+	mHeader->height = size.y;
+	mHeader->sequence.store(0, std::memory_order_relaxed);
+	mHeader->sendNs.store(0, std::memory_order_relaxed);
+	// the magic last, readers only trust a complete header
+	std::atomic_thread_fence(std::memory_order_release);
+	std::memcpy(mHeader->magic, "VDSHFRM\0", 8);
+}
+VDSharedFrameWriter::~VDSharedFrameWriter()
+{
+#if defined( _WIN32 )
+	if (mHeader) UnmapViewOfFile(mHeader);
+	if (mHandle != INVALID) CloseHandle((HANDLE)mHandle);
+#else
+	if (mHeader) munmap(mHeader, mBytes);
+	if (mHandle != INVALID) {
+		::close((int)mHandle);
+		// readers keep their mapping, new ones no longer find the name
+		shm_unlink(segmentName(mName).c_str());
+	}
+#endif
+}
+uint8_t* VDSharedFrameWriter::beginFrame()
+{
+	if (!mHeader) return nullptr;
+	mHeader->sequence.store(mFramesWritten * 2 + 1, std::memory_order_relaxed);
+	// the odd sequence is visible before any pixel changes
+	std::atomic_thread_fence(std::memory_order_release);
+	return reinterpret_cast<uint8_t*>(mHeader + 1);
+}
+void VDSharedFrameWriter::endFrame()
+{
+	if (!mHeader) return;
+	mFramesWritten++;
+	mHeader->sendNs.store(VDFrameStamp::now(), std::memory_order_relaxed);
+	mHeader->sequence.store(mFramesWritten * 2, std::memory_order_release);
+}
+
+VDSharedFrameReader::VDSharedFrameReader()
+	: mHandle(INVALID)
+	, mBytes(0)
+	, mHeader(nullptr)
+	, mLastSequence(0)
+	, mSendNs(0)
+	, mTornReads(0)
+{
+}
+VDSharedFrameReader::~VDSharedFrameReader()
+{
+	close();
+}
+bool VDSharedFrameReader::open(const std::string &name)
+{
+	close();
+	const void *data = nullptr;
+#if defined( _WIN32 )
+	HANDLE mapping = OpenFileMappingA(FILE_MAP_READ, FALSE, name.c_str());
+	if (!mapping) return false;
+	mHandle = (intptr_t)mapping;
+	data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	MEMORY_BASIC_INFORMATION info;
+	if (data && VirtualQuery(data, &info, sizeof(info))) mBytes = info.RegionSize;
+#else
+	int fd = shm_open(segmentName(name).c_str(), O_RDONLY, 0);
+	if (fd < 0) return false;
+	mHandle = fd;
+	struct stat info;
+	if (fstat(fd, &info) == 0 && (size_t)info.st_size >= sizeof(VDSharedFrameHeader)) {
+		mBytes = (size_t)info.st_size;
+		data = mmap(nullptr, mBytes, PROT_READ, MAP_SHARED, fd, 0);
+		if (data == MAP_FAILED) data = nullptr;
+	}
+#endif
+	const VDSharedFrameHeader *header = static_cast<const VDSharedFrameHeader*>(data);
+	// a writer that is still setting up the segment, or something else under that name
+	if (!header || mBytes < sizeof(VDSharedFrameHeader) || std::memcmp(header->magic, "VDSHFRM\0", 8) != 0
+		|| mBytes < sizeof(VDSharedFrameHeader) + (size_t)header->width * header->height * 4) {
+		mHeader = header;
+		close();
+		return false;
+	}
+	std::atomic_thread_fence(std::memory_order_acquire);
+	mHeader = header;
+	mSize = ivec2(header->width, header->height);
+	mLastSequence = 0;
+	return true;
+}
+void VDSharedFrameReader::close()
+{
+#if defined( _WIN32 )
+	if (mHeader) UnmapViewOfFile(mHeader);
+	if (mHandle != INVALID) CloseHandle((HANDLE)mHandle);
+#else
+	if (mHeader) munmap(const_cast<VDSharedFrameHeader*>(mHeader), mBytes);
+	if (mHandle != INVALID) ::close((int)mHandle);
+#endif
+	mHeader = nullptr;
+	mHandle = INVALID;
+	mBytes = 0;
+}
+bool VDSharedFrameReader::read(uint8_t *pixels, ptrdiff_t rowBytes)
+{
+	if (!mHeader) return false;
+	uint64_t sequence = mHeader->sequence.load(std::memory_order_acquire);
+	if (sequence & 1 || sequence == mLastSequence) return false;
+	const uint8_t *source = reinterpret_cast<const uint8_t*>(mHeader + 1);
+	const size_t sourceRowBytes = (size_t)mSize.x * 4;
+	for (int32_t y = 0; y < mSize.y; y++) {
+		std::memcpy(pixels + y * rowBytes, source + y * sourceRowBytes, sourceRowBytes);
+	}
+	int64_t sendNs = mHeader->sendNs.load(std::memory_order_relaxed);
+	// the copy is complete before the sequence is checked again
+	std::atomic_thread_fence(std::memory_order_acquire);
+	if (mHeader->sequence.load(std::memory_order_relaxed) != sequence) {
+		mTornReads++;
+		return false;
+	}
+	mLastSequence = sequence;
+	mSendNs = sendNs;
+	return true;
+}
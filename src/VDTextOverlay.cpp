@@ -0,0 +1,86 @@
+#include "VDTextOverlay.h"
+
+using namespace ci;
+using namespace videodromm;
+
+VDTextOverlay::VDTextOverlay(const std::string &fontName)
+	: mFontName(fontName)
+	, mDirty(true)
+{
+}
+int VDTextOverlay::addLabel(float size, const ColorA &color)
+{
+	size_t font = 0;
+	while (font < mBatches.size() && mBatches[font].size != size) font++;
+	if (font == mBatches.size()) {
+		// rasterised once here, never again
+		Batch batch;
+		batch.font = gl::TextureFont::create(Font(mFontName, size));
+		batch.size = size;
+		mBatches.push_back(batch);
+	}
+	Label label;
+	label.font = font;
+	label.color = ColorA8u(color);
+	label.visible = false;
+	label.wasVisible = false;
+	mLabels.push_back(label);
+	return (int)mLabels.size() - 1;
+}
+void VDTextOverlay::beginFrame()
+{
+	for (auto &label : mLabels) {
+		label.wasVisible = label.visible;
+		label.visible = false;
+	}
+}
+void VDTextOverlay::setText(int id, const std::string &text, const vec2 &pos)
+{
+	Label &label = mLabels[id];
+	label.visible = true;
+	if (label.text != text) {
+		label.text = text;
+		label.placements = mBatches[label.font].font->getGlyphPlacements(text);
+		mDirty = true;
+	}
+	if (label.pos != pos) {
+		label.pos = pos;
+		mDirty = true;
+	}
+}
+void VDTextOverlay::rebuild()
+{
+	for (auto &batch : mBatches) {
+		batch.glyphs.clear();
+		batch.colors.clear();
+	}
+	for (const auto &label : mLabels) {
+		if (!label.visible) continue;
+		Batch &batch = mBatches[label.font];
+		// placements are relative to the baseline, labels are positioned by their top
+		vec2 offset = label.pos + vec2(0, batch.font->getAscent());
+		for (const auto &glyph : label.placements) {
+			batch.glyphs.push_back(std::make_pair(glyph.first, glyph.second + offset));
+			batch.colors.push_back(label.color);
+		}
+	}
+	mDirty = false;
+}
+void VDTextOverlay::draw()
+{
+	for (const auto &label : mLabels) {
+		if (label.visible != label.wasVisible) {
+			mDirty = true;
+			break;
+		}
+	}
+	if (mDirty) {
+		rebuild();
+	}
+	gl::ScopedBlendAlpha alpha;
+	for (auto &batch : mBatches) {
+		if (!batch.glyphs.empty()) {
+			batch.font->drawGlyphs(batch.glyphs, vec2(0), gl::TextureFont::DrawOptions(), batch.colors);
+		}
+	}
+}
@@ -0,0 +1,299 @@
+#include "VDTileCodec.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+#if defined( _M_X64 ) || defined( _M_IX86 ) || defined( __SSE2__ )
+#define VD_TILECODEC_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined( _MSC_VER )
+#include <intrin.h>
+#endif
+
+using namespace videodromm;
+
+namespace {
+	const int		HASH_LOG = 14;
+	const size_t	MIN_MATCH = 4;
+	const size_t	MAX_OFFSET = 65535;
+
+	// per thread, reused across tiles and frames; stale table entries are verified before use
+	thread_local std::vector<uint32_t>	tTable;
+	thread_local std::vector<uint8_t>	tResidual;
+
+	inline uint32_t read32(const uint8_t *p)
+	{
+		uint32_t value;
+		std::memcpy(&value, p, sizeof(value));
+		return value;
+	}
+	inline uint64_t read64(const uint8_t *p)
+	{
+		uint64_t value;
+		std::memcpy(&value, p, sizeof(value));
+		return value;
+	}
+	inline void write32(uint8_t *p, uint32_t value)
+	{
+		std::memcpy(p, &value, sizeof(value));
+	}
+	inline uint32_t hash(uint32_t sequence)
+	{
+		return (sequence * 2654435761u) >> (32 - HASH_LOG);
+	}
+	// index of the lowest set bit, value must not be 0
+	inline int lowestBit(uint64_t value)
+	{
+#if defined( _MSC_VER ) && defined( _M_X64 )
+		unsigned long index;
+		_BitScanForward64(&index, value);
+		return (int)index;
+#elif defined( _MSC_VER )
+		unsigned long index;
+		if (_BitScanForward(&index, (uint32_t)value)) return (int)index;
+		_BitScanForward(&index, (uint32_t)(value >> 32));
+		return (int)index + 32;
+#else
+		return __builtin_ctzll(value);
+#endif
+	}
+
+	uint8_t* writeLength(uint8_t *op, size_t length)
+	{
+		for (; length >= 255; length -= 255) *op++ = 255;
+		*op++ = (uint8_t)length;
+		return op;
+	}
+	bool readLength(const uint8_t *&ip, const uint8_t *end, size_t &length)
+	{
+		uint8_t byte;
+		do {
+			if (ip >= end) return false;
+			byte = *ip++;
+			length += byte;
+		} while (byte == 255);
+		return true;
+	}
+	// one sequence: literals, then a match unless this is the last one (matchLength 0)
+	uint8_t* emit(uint8_t *op, const uint8_t *literals, size_t literalCount, size_t offset, size_t matchLength)
+	{
+		size_t matchCode = matchLength ? matchLength - MIN_MATCH : 0;
+		*op++ = (uint8_t)(std::min<size_t>(literalCount, 15) << 4 | std::min<size_t>(matchCode, 15));
+		if (literalCount >= 15) op = writeLength(op, literalCount - 15);
+		std::memcpy(op, literals, literalCount);
+		op += literalCount;
+		if (matchLength) {
+			*op++ = (uint8_t)(offset & 0xff);
+			*op++ = (uint8_t)(offset >> 8);
+			if (matchCode >= 15) op = writeLength(op, matchCode - 15);
+		}
+		return op;
+	}
+
+	// residual = pixel - (left + up - upleft), per byte; up is null on the first row of a tile
+	void filterRow(const uint8_t *cur, const uint8_t *up, uint8_t *out, int32_t width)
+	{
+		const int32_t bytes = width * 4;
+		for (int32_t i = 0; i < 4; i++) out[i] = (uint8_t)(cur[i] - (up ? up[i] : 0));
+		int32_t i = 4;
+#if defined( VD_TILECODEC_SSE2 )
+		for (; i + 16 <= bytes; i += 16) {
+			__m128i residual = _mm_sub_epi8(_mm_loadu_si128((const __m128i*)(cur + i)), _mm_loadu_si128((const __m128i*)(cur + i - 4)));
+			if (up) {
+				residual = _mm_sub_epi8(residual, _mm_sub_epi8(_mm_loadu_si128((const __m128i*)(up + i)), _mm_loadu_si128((const __m128i*)(up + i - 4))));
+			}
+			_mm_storeu_si128((__m128i*)(out + i), residual);
+		}
+#endif
+		for (; i < bytes; i++) {
+			out[i] = (uint8_t)(cur[i] - cur[i - 4] - (up ? up[i] - up[i - 4] : 0));
+		}
+	}
+	// the inverse: a running sum along the row over residual + up - upleft
+	void unfilterRow(const uint8_t *residual, const uint8_t *up, uint8_t *cur, int32_t width)
+	{
+		const int32_t bytes = width * 4;
+		for (int32_t i = 0; i < 4; i++) cur[i] = (uint8_t)(residual[i] + (up ? up[i] : 0));
+		int32_t i = 4;
+#if defined( VD_TILECODEC_SSE2 )
+		// 4 pixels per step: prefix sum inside the register, plus the last pixel before it
+		__m128i carry = _mm_set1_epi32((int)read32(cur));
+		for (; i + 16 <= bytes; i += 16) {
+			__m128i sum = _mm_loadu_si128((const __m128i*)(residual + i));
+			if (up) {
+				sum = _mm_add_epi8(sum, _mm_sub_epi8(_mm_loadu_si128((const __m128i*)(up + i)), _mm_loadu_si128((const __m128i*)(up + i - 4))));
+			}
+			sum = _mm_add_epi8(sum, _mm_slli_si128(sum, 4));
+			sum = _mm_add_epi8(sum, _mm_slli_si128(sum, 8));
+			sum = _mm_add_epi8(sum, carry);
+			_mm_storeu_si128((__m128i*)(cur + i), sum);
+			carry = _mm_shuffle_epi32(sum, 0xff);
+		}
+#endif
+		for (; i < bytes; i++) {
+			cur[i] = (uint8_t)(residual[i] + cur[i - 4] + (up ? up[i] - up[i - 4] : 0));
+		}
+	}
+}
+
+size_t VDTileCodec::compress(const uint8_t *src, size_t size, uint8_t *dst)
+{
+	std::vector<uint32_t> &table = tTable;
+	if (table.empty()) table.assign((size_t)1 << HASH_LOG, 0);
+	uint8_t *op = dst;
+	size_t ip = 0;
+	size_t anchor = 0;
+	while (ip + MIN_MATCH <= size) {
+		uint32_t sequence = read32(src + ip);
+		uint32_t &slot = table[hash(sequence)];
+		size_t ref = slot;
+		slot = (uint32_t)ip;
+		if (ref < ip && ip - ref <= MAX_OFFSET && read32(src + ref) == sequence) {
+			size_t length = MIN_MATCH;
+			bool mismatch = false;
+			while (ip + length + 8 <= size) {
+				uint64_t diff = read64(src + ip + length) ^ read64(src + ref + length);
+				if (diff) {
+					length += lowestBit(diff) >> 3;
+					mismatch = true;
+					break;
+				}
+				length += 8;
+			}
+			if (!mismatch) {
+				while (ip + length < size && src[ip + length] == src[ref + length]) length++;
+			}
+			op = emit(op, src + anchor, ip - anchor, ip - ref, length);
+			ip += length;
+			anchor = ip;
+		}
+		else {
+			// skip faster through data that does not compress
+			ip += 1 + ((ip - anchor) >> 6);
+		}
+	}
+	op = emit(op, src + anchor, size - anchor, 0, 0);
+	return op - dst;
+}
+bool VDTileCodec::decompress(const uint8_t *src, size_t size, uint8_t *dst, size_t dstSize)
+{
+	const uint8_t *ip = src;
+	const uint8_t *end = src + size;
+	uint8_t *op = dst;
+	uint8_t *outEnd = dst + dstSize;
+	while (ip < end) {
+		uint8_t token = *ip++;
+		size_t literals = token >> 4;
+		if (literals == 15 && !readLength(ip, end, literals)) return false;
+		if ((size_t)(end - ip) < literals || (size_t)(outEnd - op) < literals) return false;
+		std::memcpy(op, ip, literals);
+		op += literals;
+		ip += literals;
+		// the last sequence has no match
+		if (ip == end) break;
+		if (end - ip < 2) return false;
+		size_t offset = ip[0] | (size_t)ip[1] << 8;
+		ip += 2;
+		size_t length = token & 15;
+		if (length == 15 && !readLength(ip, end, length)) return false;
+		length += MIN_MATCH;
+		if (offset == 0 || offset > (size_t)(op - dst) || (size_t)(outEnd - op) < length) return false;
+		const uint8_t *match = op - offset;
+		if (offset >= length) {
+			std::memcpy(op, match, length);
+		}
+		else if (offset == 1) {
+			std::memset(op, *match, length);
+		}
+		else if (offset >= 8) {
+			// overlapping, but never within one 8 byte step
+			for (size_t i = 0; i < length; i += 8) {
+				std::memcpy(op + i, match + i, std::min<size_t>(8, length - i));
+			}
+		}
+		else {
+			for (size_t i = 0; i < length; i++) op[i] = match[i];
+		}
+		op += length;
+	}
+	return op == outEnd;
+}
+void VDTileCodec::encode(const uint8_t *pixels, ptrdiff_t rowBytes, int32_t width, int32_t height, std::vector<uint8_t> &out, VDWorkerPool *workers)
+{
+	const size_t tiles = (height + TILE_ROWS - 1) / TILE_ROWS;
+	const size_t tileBytes = (size_t)width * 4 * TILE_ROWS;
+	// every tile compresses into a worst case slot of its own, packed afterwards
+	const size_t slotBytes = compressBound(tileBytes);
+	const size_t headerBytes = 8 + 4 * tiles;
+	out.resize(headerBytes + slotBytes * tiles);
+	uint8_t *data = out.data();
+	auto band = [&](size_t t0, size_t t1) {
+		std::vector<uint8_t> &residual = tResidual;
+		if (residual.size() < tileBytes) residual.resize(tileBytes);
+		for (size_t t = t0; t < t1; t++) {
+			int32_t y0 = (int32_t)t * TILE_ROWS;
+			int32_t y1 = std::min(height, y0 + TILE_ROWS);
+			for (int32_t y = y0; y < y1; y++) {
+				filterRow(pixels + y * rowBytes, y > y0 ? pixels + (y - 1) * rowBytes : nullptr, residual.data() + (size_t)(y - y0) * width * 4, width);
+			}
+			size_t size = compress(residual.data(), (size_t)(y1 - y0) * width * 4, data + headerBytes + t * slotBytes);
+			write32(data + 8 + 4 * t, (uint32_t)size);
+		}
+	};
+	if (workers && tiles > 1) {
+		workers->parallelFor(tiles, band);
+	}
+	else {
+		band(0, tiles);
+	}
+	write32(data, TILE_ROWS);
+	write32(data + 4, (uint32_t)tiles);
+	size_t position = headerBytes;
+	for (size_t t = 0; t < tiles; t++) {
+		size_t size = read32(data + 8 + 4 * t);
+		if (position != headerBytes + t * slotBytes) std::memmove(data + position, data + headerBytes + t * slotBytes, size);
+		position += size;
+	}
+	out.resize(position);
+}
+bool VDTileCodec::decode(const uint8_t *payload, size_t bytes, int32_t width, int32_t height, uint8_t *pixels, ptrdiff_t rowBytes, VDWorkerPool *workers)
+{
+	if (bytes < 8 || width <= 0 || height <= 0) return false;
+	const size_t tileRows = read32(payload);
+	const size_t tiles = read32(payload + 4);
+	if (tileRows == 0 || tiles != (height + tileRows - 1) / tileRows || bytes < 8 + 4 * tiles) return false;
+	std::vector<size_t> offsets(tiles + 1);
+	offsets[0] = 8 + 4 * tiles;
+	for (size_t t = 0; t < tiles; t++) {
+		offsets[t + 1] = offsets[t] + read32(payload + 8 + 4 * t);
+	}
+	if (offsets[tiles] > bytes) return false;
+	// a damaged tile row count must not size the buffer
+	const size_t residualBytes = std::min(tileRows, (size_t)height) * width * 4;
+	std::atomic<bool> valid(true);
+	auto band = [&](size_t t0, size_t t1) {
+		std::vector<uint8_t> &residual = tResidual;
+		if (residual.size() < residualBytes) residual.resize(residualBytes);
+		for (size_t t = t0; t < t1; t++) {
+			int32_t y0 = (int32_t)(t * tileRows);
+			int32_t y1 = (int32_t)std::min<size_t>(height, y0 + tileRows);
+			if (!decompress(payload + offsets[t], offsets[t + 1] - offsets[t], residual.data(), (size_t)(y1 - y0) * width * 4)) {
+				valid = false;
+				continue;
+			}
+			for (int32_t y = y0; y < y1; y++) {
+				unfilterRow(residual.data() + (size_t)(y - y0) * width * 4, y > y0 ? pixels + (y - 1) * rowBytes : nullptr, pixels + y * rowBytes, width);
+			}
+		}
+	};
+	if (workers && tiles > 1) {
+		workers->parallelFor(tiles, band);
+	}
+	else {
+		band(0, tiles);
+	}
+	return valid;
+}
@@ -0,0 +1,134 @@
+#include "VDTracer.h"
+
+#include "cinder/Log.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+using namespace ci;
+using namespace videodromm;
+
+namespace {
+	struct Event {
+		const char	*name;
+		int64_t		ns;
+		char		phase;	// 'B', 'E' or 'i'
+	};
+	struct Ring {
+		Ring(int tid) : tid(tid), count(0), events(VDTracer::RING_SIZE) {}
+		int						tid;
+		std::string				name;
+		std::atomic<size_t>		count;	// events ever written, the ring holds the last RING_SIZE
+		std::vector<Event>		events;
+	};
+
+	std::atomic<bool>					sEnabled(false);
+	std::mutex							sRingsMutex;
+	// kept after their thread exits, so its last events can still be written
+	std::vector<std::shared_ptr<Ring>>	sRings;
+	thread_local Ring					*tRing = nullptr;
+
+	int64_t now()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+	Ring* ring()
+	{
+		if (!tRing) {
+			std::lock_guard<std::mutex> lock(sRingsMutex);
+			sRings.push_back(std::make_shared<Ring>((int)sRings.size() + 1));
+			tRing = sRings.back().get();
+		}
+		return tRing;
+	}
+	inline void record(const char *name, char phase)
+	{
+		if (!sEnabled.load(std::memory_order_relaxed)) return;
+		Ring *r = ring();
+		size_t index = r->count.load(std::memory_order_relaxed);
+		Event &event = r->events[index & (VDTracer::RING_SIZE - 1)];
+		event.name = name;
+		event.ns = now();
+		event.phase = phase;
+		r->count.store(index + 1, std::memory_order_release);
+	}
+	std::string escape(const std::string &text)
+	{
+		std::string escaped;
+		for (char c : text) {
+			if (c == '"' || c == '\\') escaped += '\\';
+			if ((unsigned char)c >= 0x20) escaped += c;
+		}
+		return escaped;
+	}
+}
+
+void VDTracer::setEnabled(bool enabled)
+{
+	sEnabled = enabled;
+}
+bool VDTracer::isEnabled()
+{
+	return sEnabled;
+}
+void VDTracer::setThreadName(const std::string &name)
+{
+	Ring *r = ring();
+	std::lock_guard<std::mutex> lock(sRingsMutex);
+	r->name = name;
+}
+void VDTracer::begin(const char *name)
+{
+	record(name, 'B');
+}
+void VDTracer::end(const char *name)
+{
+	record(name, 'E');
+}
+void VDTracer::instant(const char *name)
+{
+	record(name, 'i');
+}
+bool VDTracer::write(const fs::path &path, double seconds)
+{
+	bool enabled = sEnabled.exchange(false);
+	int64_t end = now();
+	int64_t begin = end - (int64_t)(seconds * 1.0e9);
+	std::ofstream file(path.string());
+	if (!file) {
+		sEnabled = enabled;
+		CI_LOG_E("VDTracer: cannot write " << path);
+		return false;
+	}
+	size_t written = 0;
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	{
+		std::lock_guard<std::mutex> lock(sRingsMutex);
+		bool first = true;
+		for (const auto &r : sRings) {
+			std::string threadName = r->name.empty() ? "thread " + std::to_string(r->tid) : r->name;
+			file << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << r->tid << ",\"args\":{\"name\":\"" << escape(threadName) << "\"}}";
+			first = false;
+			size_t count = r->count.load(std::memory_order_acquire);
+			size_t oldest = count > RING_SIZE ? count - RING_SIZE : 0;
+			for (size_t i = oldest; i < count; i++) {
+				const Event &event = r->events[i & (RING_SIZE - 1)];
+				if (event.ns < begin) continue;
+				char ts[32];
+				std::snprintf(ts, sizeof(ts), "%.3f", (event.ns - begin) / 1000.0);
+				file << ",\n{\"name\":\"" << escape(event.name) << "\",\"ph\":\"" << event.phase << "\",\"ts\":" << ts << ",\"pid\":1,\"tid\":" << r->tid;
+				file << (event.phase == 'i' ? ",\"s\":\"t\"}" : "}");
+				written++;
+			}
+		}
+	}
+	file << "\n]}\n";
+	sEnabled = enabled;
+	CI_LOG_I("VDTracer: " << written << " events written to " << path);
+	return (bool)file;
+}
@@ -0,0 +1,186 @@
+#include "VDUniformBinding.h"
+
+#include "cinder/Log.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace ci;
+using namespace videodromm;
+
+VDUniformBinding::VDUniformBinding(const std::string &blockName, GLuint bindingPoint)
+	: mBlockName(blockName)
+	, mBindingPoint(bindingPoint)
+	, mDirtyBegin(0)
+	, mDirtyEnd(0)
+	, mBlockSize(0)
+	, mUploads(0)
+{
+}
+int VDUniformBinding::add(const std::string &name, Type type, int slot, size_t size, size_t alignment, const void *value)
+{
+	Entry entry;
+	entry.name = name;
+	entry.type = type;
+	entry.slot = slot;
+	entry.offset = (mData.size() + alignment - 1) / alignment * alignment;
+	entry.size = size;
+	entry.sessionIndex = -1;
+	mData.resize(entry.offset + size);
+	std::memcpy(&mData[entry.offset], value, size);
+	mEntries.push_back(entry);
+	mSlotEntries[type].push_back((int)mEntries.size() - 1);
+	// the block layout changed, everything goes up again
+	mUbo.reset();
+	mPrograms.clear();
+	return (int)mEntries.size() - 1;
+}
+int VDUniformBinding::addFloat(const std::string &name, float value)
+{
+	return add(name, VDUniformStore::FLOAT, mStore.addFloat(value), sizeof(float), 4, &value);
+}
+int VDUniformBinding::addVec3(const std::string &name, const vec3 &value)
+{
+	return add(name, VDUniformStore::VEC3, mStore.addVec3(value), sizeof(vec3), 16, &value);
+}
+int VDUniformBinding::addInt(const std::string &name, int value)
+{
+	return add(name, VDUniformStore::INT, mStore.addInt(value), sizeof(int), 4, &value);
+}
+int VDUniformBinding::addSessionFloat(const std::string &name, unsigned int sessionIndex)
+{
+	int index = addFloat(name);
+	mEntries[index].sessionIndex = sessionIndex;
+	mSessionSlots.push_back(mEntries[index].slot);
+	mSessionIndices.push_back(sessionIndex);
+	mSessionValues.push_back(0.0f);
+	return index;
+}
+int VDUniformBinding::getIndex(const std::string &name) const
+{
+	for (size_t i = 0; i < mEntries.size(); i++) {
+		if (mEntries[i].name == name) return (int)i;
+	}
+	return -1;
+}
+void VDUniformBinding::setFloat(int index, float value)
+{
+	mStore.setFloat(mEntries[index].slot, value);
+}
+void VDUniformBinding::setVec3(int index, const vec3 &value)
+{
+	mStore.setVec3(mEntries[index].slot, value);
+}
+void VDUniformBinding::setInt(int index, int value)
+{
+	mStore.setInt(mEntries[index].slot, value);
+}
+float VDUniformBinding::getFloat(int index) const
+{
+	return mStore.getFloat(mEntries[index].slot);
+}
+void VDUniformBinding::pull(const VDSessionRef &session)
+{
+	for (size_t i = 0; i < mSessionIndices.size(); i++) {
+		mSessionValues[i] = session->getFloatUniformValueByIndex(mSessionIndices[i]);
+	}
+	mStore.setFloats(mSessionSlots.data(), mSessionValues.data(), mSessionSlots.size());
+}
+void VDUniformBinding::sync()
+{
+	if (!mStore.isDirty()) return;
+	const void *data[VDUniformStore::TYPE_COUNT] = { mStore.getFloatData(), mStore.getVec3Data(), mStore.getIntData() };
+	const size_t sizes[VDUniformStore::TYPE_COUNT] = { sizeof(float), sizeof(vec3), sizeof(int) };
+	for (int type = 0; type < VDUniformStore::TYPE_COUNT; type++) {
+		const uint8_t *values = static_cast<const uint8_t*>(data[type]);
+		const std::vector<int> &entries = mSlotEntries[type];
+		mStore.forEachDirtyRange((Type)type, [&](int first, int count) {
+			for (int slot = first; slot < first + count; slot++) {
+				const Entry &entry = mEntries[entries[slot]];
+				std::memcpy(&mData[entry.offset], values + slot * sizes[type], entry.size);
+				if (mDirtyBegin == mDirtyEnd) {
+					mDirtyBegin = entry.offset;
+					mDirtyEnd = entry.offset + entry.size;
+				}
+				else {
+					mDirtyBegin = std::min(mDirtyBegin, entry.offset);
+					mDirtyEnd = std::max(mDirtyEnd, entry.offset + entry.size);
+				}
+			}
+		});
+	}
+	mStore.clearDirty();
+}
+VDUniformBinding::Program& VDUniformBinding::resolve(const VDShaderProgramRef &program)
+{
+	for (auto &state : mPrograms) {
+		if (state.id == program->getId()) return state;
+	}
+	// programs replaced by a hot reload are gone, drop them
+	mPrograms.erase(std::remove_if(mPrograms.begin(), mPrograms.end(), [](const Program &state) {
+		return state.program.expired();
+	}), mPrograms.end());
+	// first use of this program: look everything up once
+	Program state;
+	state.program = program;
+	state.id = program->getId();
+	GLuint handle = program->getHandle();
+	GLuint blockIndex = glGetUniformBlockIndex(handle, mBlockName.c_str());
+	state.usesBlock = blockIndex != GL_INVALID_INDEX;
+	if (state.usesBlock) {
+		glUniformBlockBinding(handle, blockIndex, mBindingPoint);
+		// std140 pads the block to a multiple of 16 bytes, the driver reads all of it
+		GLint blockSize = 0;
+		glGetActiveUniformBlockiv(handle, blockIndex, GL_UNIFORM_BLOCK_DATA_SIZE, &blockSize);
+		if ((size_t)blockSize > mBlockSize) {
+			mBlockSize = (size_t)blockSize;
+			mUbo.reset();
+		}
+	}
+	else {
+		for (const auto &entry : mEntries) {
+			state.locations.push_back(glGetUniformLocation(handle, entry.name.c_str()));
+		}
+	}
+	state.versions.assign(mEntries.size(), 0);
+	CI_LOG_V("VDUniformBinding resolved " << program->getName() << (state.usesBlock ? " (uniform block)" : " (uniforms)"));
+	mPrograms.push_back(state);
+	return mPrograms.back();
+}
+void VDUniformBinding::apply(const VDShaderProgramRef &program)
+{
+	sync();
+	Program &state = resolve(program);
+	if (state.usesBlock) {
+		if (!mUbo) {
+			size_t size = std::max(mBlockSize, (mData.size() + 15) / 16 * 16);
+			mUbo = gl::Ubo::create(size, nullptr, GL_DYNAMIC_DRAW);
+			mUbo->bufferSubData(0, mData.size(), mData.data());
+			mDirtyBegin = mDirtyEnd = 0;
+			mUploads++;
+		}
+		else if (mDirtyBegin != mDirtyEnd) {
+			mUbo->bufferSubData(mDirtyBegin, mDirtyEnd - mDirtyBegin, &mData[mDirtyBegin]);
+			mDirtyBegin = mDirtyEnd = 0;
+			mUploads++;
+		}
+		mUbo->bindBufferBase(mBindingPoint);
+		return;
+	}
+	for (size_t i = 0; i < mEntries.size(); i++) {
+		const Entry &entry = mEntries[i];
+		uint32_t version = mStore.getVersion(entry.type, entry.slot);
+		if (state.versions[i] == version) continue;
+		state.versions[i] = version;
+		GLint location = state.locations[i];
+		if (location < 0) continue;
+		const void *value = &mData[entry.offset];
+		switch (entry.type) {
+		case VDUniformStore::FLOAT: glUniform1fv(location, 1, static_cast<const GLfloat*>(value)); break;
+		case VDUniformStore::VEC3: glUniform3fv(location, 1, static_cast<const GLfloat*>(value)); break;
+		case VDUniformStore::INT: glUniform1iv(location, 1, static_cast<const GLint*>(value)); break;
+		default: break;
+		}
+		mUploads++;
+	}
+}
@@ -0,0 +1,113 @@
+#include "VDUniformStore.h"
+
+#include <algorithm>
+
+#if defined( _MSC_VER )
+#include <intrin.h>
+#endif
+
+using namespace ci;
+using namespace videodromm;
+
+namespace {
+	// index of the lowest set bit, word must not be 0
+	inline int lowestBit(uint64_t word)
+	{
+#if defined( _MSC_VER )
+		unsigned long index;
+		_BitScanForward64(&index, word);
+		return (int)index;
+#else
+		return __builtin_ctzll(word);
+#endif
+	}
+}
+
+size_t VDUniformStore::getCount(Type type) const
+{
+	switch (type) {
+	case FLOAT: return mFloats.values.size();
+	case VEC3: return mVec3s.values.size();
+	default: return mInts.values.size();
+	}
+}
+uint32_t VDUniformStore::getVersion(Type type, int slot) const
+{
+	switch (type) {
+	case FLOAT: return mFloats.versions[slot];
+	case VEC3: return mVec3s.versions[slot];
+	default: return mInts.versions[slot];
+	}
+}
+const std::vector<uint64_t>& VDUniformStore::getDirtyBits(Type type) const
+{
+	switch (type) {
+	case FLOAT: return mFloats.dirty;
+	case VEC3: return mVec3s.dirty;
+	default: return mInts.dirty;
+	}
+}
+bool VDUniformStore::isDirty(Type type, int first, size_t count) const
+{
+	const std::vector<uint64_t> &bits = getDirtyBits(type);
+	size_t end = std::min((size_t)first + count, getCount(type));
+	for (size_t slot = first; slot < end;) {
+		// whole words at a time where the range allows
+		size_t word = slot >> 6;
+		size_t shift = slot & 63;
+		size_t span = std::min<size_t>(64 - shift, end - slot);
+		uint64_t mask = (span == 64 ? ~0ull : ((1ull << span) - 1)) << shift;
+		if (bits[word] & mask) return true;
+		slot += span;
+	}
+	return false;
+}
+bool VDUniformStore::isDirty() const
+{
+	for (int type = 0; type < TYPE_COUNT; type++) {
+		for (uint64_t word : getDirtyBits((Type)type)) {
+			if (word) return true;
+		}
+	}
+	return false;
+}
+void VDUniformStore::forEachDirtyRange(Type type, const std::function<void(int first, int count)> &fn) const
+{
+	const std::vector<uint64_t> &bits = getDirtyBits(type);
+	int first = -1;
+	for (size_t word = 0; word < bits.size(); word++) {
+		uint64_t value = bits[word];
+		// clean words end a pending run, runs continue across full words
+		if (value == 0) {
+			if (first >= 0) fn(first, (int)(word << 6) - first);
+			first = -1;
+			continue;
+		}
+		if (value == ~0ull && first >= 0) continue;
+		int base = (int)(word << 6);
+		for (int bit = 0; bit < 64;) {
+			uint64_t rest = value >> bit;
+			if (first >= 0) {
+				// end of the run: first clear bit from here
+				uint64_t clear = ~rest;
+				if (bit > 0) clear &= ~0ull >> bit;
+				if (clear == 0) break;
+				bit += lowestBit(clear);
+				fn(first, base + bit - first);
+				first = -1;
+			}
+			else {
+				if (rest == 0) break;
+				bit += lowestBit(rest);
+				first = base + bit;
+			}
+		}
+	}
+	if (first >= 0) fn(first, (int)getCount(type) - first);
+}
+void VDUniformStore::clearDirty()
+{
+	std::fill(mFloats.dirty.begin(), mFloats.dirty.end(), 0);
+	std::fill(mVec3s.dirty.begin(), mVec3s.dirty.end(), 0);
+	std::fill(mInts.dirty.begin(), mInts.dirty.end(), 0);
+}
@@ -2,6 +2,12 @@
 #include "cinder/app/RendererGl.h"
 #include "cinder/gl/gl.h"
 #include "cinder/gl/Fbo.h"
+#include "cinder/Timer.h"
+#include "cinder/Utilities.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
 
 // Settings
 #include "VDSettings.h"
@@ -9,10 +15,37 @@
 #include "VDSession.h"
 // Log
 #include "VDLog.h"
-// Spout
-#include "CiSpoutIn.h"
+// input
+#include "VDFrameSource.h"
+#include "VDReplaySource.h"
+// shaders
+#include "VDShaderManager.h"
+#include "VDUniformBinding.h"
+#include "VDPostGraph.h"
+#include "VDRenderTargets.h"
+#include "VDCpuEffects.h"
+#include "VDChangeDetector.h"
+#include "VDLumaStats.h"
 // ndi
-#include "CinderNDISender.h"
+#include "VDNDIOutput.h"
+#include "VDReadback.h"
+#include "VDDownscaler.h"
+#include "VDMetadataChannel.h"
+// recording
+#include "VDRecordingSink.h"
+// hud
+#include "VDTextOverlay.h"
+#include "VDPreviewCompositor.h"
+// timing
+#include "VDProfiler.h"
+#include "VDTracer.h"
+// headless
+#include "VDBenchmark.h"
+#include "VDChecks.h"
+// pacing
+#include "VDFramePacer.h"
+// receive load testing
+#include "VDLoadGenerator.h"
 
 using namespace ci;
 using namespace ci::app;
@@ -41,9 +74,34 @@ private:
 	VDSessionRef					mVDSession;
 	// Log
 	VDLogRef						mVDLog;
-	// Spout
-	SpoutIn							mSpoutIn;
-	gl::Texture2dRef				mSpoutTexture;
+	// input: Spout, a replayed recording, or generated frames when headless
+	VDFrameSourceRef				mSource;
+	gl::Texture2dRef				mSourceTexture;
+	// headless: offscreen, as fast as possible for a number of frames, mock outputs
+	bool							mHeadless;
+	VDBenchmarkRef					mBenchmark;
+	// a post graph that fails to link ends the run with a failing report and exit code
+	Timer							mBenchmarkStartTimer;
+	static constexpr double			BENCHMARK_START_TIMEOUT = 30.0;
+	void							failHeadless(const std::string &reason);
+	// synthetic senders for whatever receiver is measured, this one included
+	VDLoadGeneratorRef				mLoadGenerator;
+	// per-stage cpu and gpu timings
+	VDProfilerRef					mProfiler;
+	int								mStageReceive, mStageDetect, mStageCpuPost, mStageUpdate, mStageShader, mStagePreview, mStageReadback, mStageLuma, mStagePush, mStageHud, mStageSend;
+	// latency per hop from the senders' frame stamps, as profiler stages
+	bool							mLatency;
+	int								mStageLatencySend, mStageLatencyDisplay, mStageLatencyNdi;
+	VDFrameStamp					mStampReceived;		// the frame received in the last draw
+	VDFrameStamp					mStampShaded;		// the frame in mFbo
+	int64_t							mStampShownSequence;
+	void							receiveStamp();
+	bool							mShowProfile;
+	std::vector<int>				mHudProfileLabels;
+	void							dumpProfile();
+	void							dumpTrace();
+	// output rate of its own when set, otherwise the display's
+	VDFramePacerRef					mPacer;
 	// fbo
 	bool							mIsShutDown;
 	Anim<float>						mRenderWindowTimer;
@@ -54,18 +112,79 @@ private:
 	int								margin, tWidth, tHeight;
 	//! fbos
 	void							renderToFbo();
+	VDRenderTargetsRef				mRenderTargets;
 	gl::FboRef						mFbo;
 	//! shaders
-	gl::GlslProgRef					mGlsl;
+	VDShaderManagerRef				mShaders;
 	bool							mUseShader;
+	VDUniformBindingRef				mUniforms;
+	int								mUniformTime, mUniformResolution, mUniformExposure, mUniformSobel, mUniformChromatic;
+	VDPostGraphRef					mPostGraph;
+	// pixel sources with the shader on: effects on the cpu before upload, no shader pass or readback
+	bool							mCpuPost;
+	bool							mDefaultGraph;
+	VDFramePoolRef					mInputPool;
+	VDWorkerPoolRef					mEffectWorkers;
+	gl::Texture2dRef				mInputTexture, mCpuPostTexture;
+	VDFrameHandle					receivePixels();
+	// static input: the last output frame is sent again, without shader pass or readback,
+	// and the NDI outputs only get a keep-alive
+	bool							mStaticSkip;
+	VDChangeDetectorRef				mChangeDetector;
+	uint64_t						mSourceSignature;	// of the texture received in the last draw
+	uint64_t						mOutputKey;			// what mLastFrame was made from, 0 for unknown
+	VDFrameHandle					mLastFrame;
+	bool							mRepeated;			// this draw's frame is mLastFrame again
+	double							mKeepAliveTime;
+	uint64_t						mOutputFrames, mRepeatedFrames;
+	static constexpr double			KEEP_ALIVE_SECONDS = 0.25;
+	// luma statistics of the output frames; auto exposure drives the session's iExposure
+	VDLumaStats						mLumaStats;
+	VDWorkerPoolRef					mLumaWorkers;
+	VDExposureControllerRef			mExposureController;	// null while auto exposure is off
+	double							mExposureTime;
+	double							mLumaPublishTime;
+	std::string						lumaSummary() const;
 	// ndi
-	CinderNDISender					mNDISender;
-	ci::SurfaceRef 					mSurface;
+	// program output first, then the scaled proxies
+	std::vector<VDNDIOutputRef>		mNDIOutputs;
+	VDWorkerPoolRef					mScaleWorkers;
+	VDFramePoolRef					mFramePool;
+	VDReadbackRef					mReadback;
+	VDMetadataChannelRef			mMetadata;
+	int								mMetaFps, mMetaSender, mMetaWidth, mMetaHeight, mMetaShader;
+	int								mMetaExposure, mMetaSobel, mMetaChromatic;
+	int								mMetaLumaMean, mMetaLumaMin, mMetaLumaMax, mMetaLumaP5, mMetaLumaP50, mMetaLumaP95;
+	// recording: the frame sent to the outputs, written to disk from its own worker
+	VDRecordingSinkRef				mRecordingSink;
+	VDNDIOutputRef					mRecorder;
+	bool							mRecordCompressed;
+	VDWorkerPoolRef					mRecordWorkers;
+	void							startRecording(const fs::path &path);
+	void							stopRecording();
+	// preview
+	VDPreviewCompositorRef			mPreview;
+	// what each preview source was copied from, a version of 0 is unknown and copied every frame
+	gl::Texture2dRef				mPreviewTextures[VDPreviewCompositor::MAX_SOURCES];
+	uint64_t						mPreviewVersions[VDPreviewCompositor::MAX_SOURCES];
+	void							setPreviewSource(int index, const gl::Texture2dRef &texture, uint64_t version);
+	// hud
+	VDTextOverlayRef				mHud;
+	enum {
+		HUD_ORIGINAL, HUD_FLIPH, HUD_FLIPV, HUD_SHADER,
+		HUD_SENDER, HUD_FPS, HUD_HELP, HUD_NDI, HUD_PACING, HUD_RECORD, HUD_STATIC, HUD_LUMA, HUD_NOSENDER, HUD_YLEFT, HUD_COUNT
+	};
+	int								mHudLabels[HUD_COUNT];
+	// checks that need the GL context, run with --check=
+	VDChecks::Result				checkTextOverlay();
+	VDChecks::Result				checkCpuGolden();
+	VDChecks::Result				checkStaticReuse();
+	// the graph links in the background; false, and a failed result, if it does not
+	bool							waitForPostGraph(VDChecks::Result &result);
 };
 
 
 VDVisualizerApp::VDVisualizerApp()
-	: mNDISender("VDVisualizer")
 {
 	// Settings
 	mVDSettings = VDSettings::create("Visualizer");
@@ -75,6 +194,117 @@ VDVisualizerApp::VDVisualizerApp()
 
 	mFadeInDelay = true;
 
+	// [--headless [--frames=N] [--source=<image folder>] [--cpu-post]] [--replay=<file>] [--rate=fps] [--trace] [--record=<file>] [--compress]
+	// [--load=<senders> [--load-pattern=static|noise|gradient] [--load-spout]] [--load-scaling]
+	// [--load-sender=<index>,<width>x<height>,<fps>,<pattern> (repeatable, one sender's own format)]
+	// [--shared=<sender>] [--latency] [--no-static-skip] [--auto-exposure] [--check=all|<name>,...]
+	// [--proxies=<scale>,... (--proxies= for none)]
+	mHeadless = false;
+	bool autoExposure = false;
+	mStaticSkip = true;
+	mRecordCompressed = false;
+	bool sourcePixels = false;
+	int benchmarkFrames = 1000;
+	double outputRate = 0.0;
+	fs::path sourceFolder;
+	fs::path recordPath;
+	fs::path replayPath;
+	int loadSenders = 0;
+	bool loadScaling = false;
+	VDLoadGenerator::Format loadFormat;
+	std::vector<std::string> checkNames;
+	// additional outputs at a fraction of the render size, scaled from the same readback
+	std::vector<float> proxyScales = { 0.5f };
+	std::string sharedName;
+	mLatency = false;
+	for (const auto &arg : getCommandLineArgs()) {
+		if (arg == "--headless") mHeadless = true;
+		else if (arg.compare(0, 9, "--frames=") == 0) benchmarkFrames = fromString<int>(arg.substr(9));
+		else if (arg.compare(0, 9, "--source=") == 0) sourceFolder = arg.substr(9);
+		else if (arg == "--cpu-post") sourcePixels = true;
+		else if (arg.compare(0, 7, "--rate=") == 0) outputRate = fromString<double>(arg.substr(7));
+		else if (arg == "--trace") VDTracer::setEnabled(true);
+		else if (arg.compare(0, 9, "--record=") == 0) recordPath = arg.substr(9);
+		else if (arg == "--compress") mRecordCompressed = true;
+		else if (arg.compare(0, 7, "--load=") == 0) loadSenders = fromString<int>(arg.substr(7));
+		else if (arg == "--load-pattern=static") loadFormat.pattern(VDLoadPattern::Static);
+		else if (arg == "--load-pattern=noise") loadFormat.pattern(VDLoadPattern::Noise);
+		else if (arg == "--load-pattern=gradient") loadFormat.pattern(VDLoadPattern::Gradient);
+		else if (arg == "--load-spout") loadFormat.backend(VDLoadBackend::Spout);
+		else if (arg == "--load-scaling") loadScaling = true;
+		else if (arg.compare(0, 14, "--load-sender=") == 0) {
+			std::vector<std::string> fields = split(arg.substr(14), ",");
+			std::vector<std::string> size = fields.size() == 4 ? split(fields[1], "x") : std::vector<std::string>();
+			VDLoadPattern pattern;
+			if (size.size() == 2 && VDLoadGenerator::parsePattern(fields[3], pattern)) {
+				loadFormat.sender(fromString<int>(fields[0]), ivec2(fromString<int>(size[0]), fromString<int>(size[1])), fromString<double>(fields[2]), pattern);
+			}
+			else {
+				CI_LOG_W("ignored " << arg << ", expected --load-sender=<index>,<width>x<height>,<fps>,<pattern>");
+			}
+		}
+		else if (arg.compare(0, 9, "--shared=") == 0) sharedName = arg.substr(9);
+		else if (arg == "--latency") mLatency = true;
+		else if (arg == "--no-static-skip") mStaticSkip = false;
+		else if (arg == "--auto-exposure") autoExposure = true;
+		else if (arg.compare(0, 8, "--check=") == 0) checkNames = split(arg.substr(8), ",");
+		else if (arg.compare(0, 10, "--proxies=") == 0) {
+			proxyScales.clear();
+			for (const auto &scale : split(arg.substr(10), ",")) {
+				if (!scale.empty()) proxyScales.push_back(std::max(0.0625f, std::min(fromString<float>(scale), 1.0f)));
+			}
+		}
+		else if (arg.compare(0, 9, "--replay=") == 0) replayPath = arg.substr(9);
+	}
+	if (outputRate > 0.0) {
+		// the pacer sleeps to its own deadlines, vsync would add a second clock
+		gl::enableVerticalSync(false);
+		mPacer = VDFramePacer::create(VDFramePacer::Format().rate(outputRate));
+	}
+	// stages, in pipeline order
+	mProfiler = VDProfiler::create();
+	VDTracer::setThreadName("render");
+	mStageReceive = mProfiler->addStage("receive");
+	mStageDetect = mProfiler->addStage("change detect");
+	mStageCpuPost = mProfiler->addStage("cpu post");
+	mStageUpdate = mProfiler->addStage("update");
+	mStageShader = mProfiler->addStage("shader");
+	mStagePreview = mProfiler->addStage("preview");
+	mStageReadback = mProfiler->addStage("readback");
+	mStageLuma = mProfiler->addStage("luma stats");
+	mStagePush = mProfiler->addStage("push");
+	mStageHud = mProfiler->addStage("hud");
+	// recorded by the program output's worker thread
+	mStageSend = mProfiler->addStage("ndi send");
+	mStageLatencySend = mLatency ? mProfiler->addStage("latency send>recv") : -1;
+	mStageLatencyDisplay = mLatency ? mProfiler->addStage("latency recv>show") : -1;
+	mStageLatencyNdi = mLatency ? mProfiler->addStage("latency recv>ndi") : -1;
+	mStampShownSequence = -1;
+	mShowProfile = false;
+	if (mHeadless) {
+		getWindow()->hide();
+		gl::enableVerticalSync(false);
+		mFadeInDelay = false;
+		// headless replays as fast as possible, every recorded frame once per loop
+		if (!sharedName.empty()) mSource = VDSharedFrameSource::create(sharedName);
+		else if (!replayPath.empty()) mSource = VDReplaySource::create(replayPath, VDReplaySource::Format().realtime(false).pixels(sourcePixels));
+		else if (!sourceFolder.empty()) mSource = VDImageSequenceSource::create(sourceFolder);
+		else mSource = VDSyntheticSource::create(ivec2(mVDSettings->mRenderWidth, mVDSettings->mRenderHeight), 60, sourcePixels);
+		mBenchmark = VDBenchmark::create(benchmarkFrames);
+		mBenchmarkStartTimer.start();
+	}
+	else if (!sharedName.empty()) {
+		mSource = VDSharedFrameSource::create(sharedName);
+	}
+	else if (!replayPath.empty()) {
+		// stands in for the sender, at the recorded timing
+		mSource = VDReplaySource::create(replayPath);
+	}
+	else {
+		mSource = VDSpoutSource::create();
+	}
+	mSource->setReadStamps(mLatency);
+
 	xLeft = 0;
 	xRight = mVDSettings->mRenderWidth;
 	yLeft = 0;
@@ -84,22 +314,135 @@ VDVisualizerApp::VDVisualizerApp()
 	tHeight = mVDSettings->mFboHeight / 2;
 	// windows
 	mIsShutDown = false;
-	// fbo
-	gl::Fbo::Format format;
-	//format.setSamples( 4 ); // uncomment this to enable 4x antialiasing
-	mFbo = gl::Fbo::create(mVDSettings->mRenderWidth, mVDSettings->mRenderHeight, format.depthTexture());
-	// ndi
-	mSurface = ci::Surface::create(mVDSettings->mRenderWidth, mVDSettings->mRenderHeight, true, SurfaceChannelOrder::BGRA);
+	// fbo, the full screen passes never depth test
+	mRenderTargets = VDRenderTargets::create();
+	mFbo = mRenderTargets->acquire("output", VDRenderTargets::Desc(ivec2(mVDSettings->mRenderWidth, mVDSettings->mRenderHeight)));
+	// ndi, sent from its own thread
+	mFramePool = VDFramePool::create("output");
+	mReadback = VDReadback::create(mFramePool);
+	mInputPool = VDFramePool::create("input");
+	mCpuPost = false;
+	if (mStaticSkip) mChangeDetector = VDChangeDetector::create();
+	mSourceSignature = 0;
+	mOutputKey = 0;
+	mRepeated = false;
+	mKeepAliveTime = 0.0;
+	mOutputFrames = 0;
+	mRepeatedFrames = 0;
+	mLumaWorkers = VDWorkerPool::create("luma", 2);
+	if (autoExposure) mExposureController = VDExposureController::create();
+	mExposureTime = 0.0;
+	mLumaPublishTime = 0.0;
+	// outputs degrade on their own under backpressure, the display keeps its rate
+	VDOutputController::Format adaptive = VDOutputController::Format().budget(1000.0f / (mPacer ? (float)mPacer->getRate() : getFrameRate()));
+	auto createSink = [this](const std::string &name) -> VDFrameSinkRef {
+		if (mHeadless) return VDMockSink::create(name);
+		return VDNDISink::create(name);
+	};
+	mNDIOutputs.push_back(VDNDIOutput::create(createSink("VDVisualizer"), VDNDIOutput::Format().queueSize(3).dropPolicy(VDDropPolicy::DropOldest).adaptive(adaptive).profiler(mProfiler, mStageSend).latency(mStageLatencyNdi)));
+	if (!proxyScales.empty()) {
+		mScaleWorkers = VDWorkerPool::create("scale", 2);
+	}
+	// metadata fields, the payload is rebuilt only when one of them changes
+	mMetadata = VDMetadataChannel::create("ci_meta", 1.0);
+	mMetaFps = mMetadata->addField("fps");
+	mMetaSender = mMetadata->addField("sender");
+	mMetaWidth = mMetadata->addField("width");
+	mMetaHeight = mMetadata->addField("height");
+	mMetaShader = mMetadata->addField("shader");
+	mMetaExposure = mMetadata->addUniform("iExposure");
+	mMetaSobel = mMetadata->addUniform("iSobel");
+	mMetaChromatic = mMetadata->addUniform("iChromatic");
+	mMetaLumaMean = mMetadata->addField("lumaMean");
+	mMetaLumaMin = mMetadata->addField("lumaMin");
+	mMetaLumaMax = mMetadata->addField("lumaMax");
+	mMetaLumaP5 = mMetadata->addField("lumaP5");
+	mMetaLumaP50 = mMetadata->addField("lumaP50");
+	mMetaLumaP95 = mMetadata->addField("lumaP95");
+	for (float scale : proxyScales) {
+		std::string name = "VDVisualizer " + toString(VDDownscaler::scaledSize(mVDSettings->mRenderWidth, scale)) + "x" + toString(VDDownscaler::scaledSize(mVDSettings->mRenderHeight, scale));
+		mNDIOutputs.push_back(VDNDIOutput::create(createSink(name), VDNDIOutput::Format().scale(scale).workers(mScaleWorkers).adaptive(adaptive)));
+	}
+	if (!recordPath.empty()) startRecording(recordPath);
+	loadFormat.size(ivec2(mVDSettings->mRenderWidth, mVDSettings->mRenderHeight)).rate(outputRate > 0.0 ? outputRate : 60.0);
+	if (loadSenders > 0) mLoadGenerator = VDLoadGenerator::create(loadFormat.senders(loadSenders));
 
 	// shader
-	mUseShader = false;
-	mGlsl = gl::GlslProg::create(gl::GlslProg::Format().vertex(loadAsset("passthrough.vs")).fragment(loadAsset("post.glsl")));
+	mUseShader = mHeadless;
+	// compiled in the background, cached as a program binary and reloaded on save
+	mShaders = VDShaderManager::create(getAppPath() / "shadercache");
+	// post uniforms, in VDUniforms block order; exposure follows the session
+	mUniforms = VDUniformBinding::create("VDUniforms", 0);
+	mUniformResolution = mUniforms->addVec3("iResolution", vec3(mVDSettings->mRenderWidth, mVDSettings->mRenderHeight, 1.0));
+	mUniformTime = mUniforms->addFloat("iGlobalTime");
+	mUniformExposure = mUniforms->addSessionFloat("iExposure", mVDSettings->IEXPOSURE);
+	// effects off until asked for: the output matches the source
+	mUniformSobel = mUniforms->addFloat("iSobel", 0.0f);
+	mUniformChromatic = mUniforms->addFloat("iChromatic", 0.0f);
+	// post passes from postgraph.xml next to the other settings, or post.glsl alone
+	mPostGraph = VDPostGraph::create(mShaders, mUniforms, mRenderTargets);
+	fs::path graphPath = getAssetPath("postgraph.xml");
+	bool graphLoaded = false;
+	if (!graphPath.empty()) {
+		try {
+			graphLoaded = mPostGraph->load(XmlTree(loadFile(graphPath)).getChild("postgraph"), graphPath.parent_path(), getAssetPath("passthrough.vs"));
+		}
+		catch (const std::exception &e) {
+			CI_LOG_E("postgraph.xml: " << e.what());
+		}
+	}
+	if (!graphLoaded) {
+		// post.glsl ignores iGlobalTime, so a static source does not redraw the pass every frame
+		mPostGraph->addPass(VDPostGraph::PassFormat("post").vertex(getAssetPath("passthrough.vs")).fragment(getAssetPath("post.glsl")).input("source")
+			.uniform("iResolution").uniform("iExposure").uniform("iSobel").uniform("iChromatic"));
+	}
+	// VDCpuEffects mirrors post.glsl alone, any other graph is shaded on the gpu
+	mDefaultGraph = !graphLoaded && mPostGraph->getPassCount() == 1;
+
+	// preview tiles: original, flipH, flipV, shader
+	mPreview = VDPreviewCompositor::create();
+	for (int i = 0; i < VDPreviewCompositor::MAX_SOURCES; i++) mPreviewVersions[i] = 0;
+	std::vector<Rectf> cells = VDPreviewCompositor::grid(2, 2, vec2(tWidth, tHeight), margin);
+	mPreview->setTiles({
+		VDPreviewCompositor::Tile(cells[0], 0),
+		VDPreviewCompositor::Tile(cells[1], 0, true, false),
+		VDPreviewCompositor::Tile(cells[2], 0, false, true),
+		VDPreviewCompositor::Tile(cells[3], 1)
+	});
+	// hud, glyphs rasterised once
+	mHud = VDTextOverlay::create("Verdana");
+	for (int i = 0; i < HUD_COUNT; i++) {
+		mHudLabels[i] = mHud->addLabel(toPixels(i <= HUD_SHADER ? 16.0f : 24.0f));
+	}
+	for (size_t i = 0; i < mProfiler->getStageCount(); i++) {
+		mHudProfileLabels.push_back(mHud->addLabel(toPixels(16.0f)));
+	}
+
+	if (!checkNames.empty()) {
+		// self checks and microbenchmarks, then exit like a finished headless run
+		VDChecksRef checks = VDChecks::create();
+		checks->add("text-overlay", [this] { return checkTextOverlay(); });
+		checks->add("cpu-golden", [this] { return checkCpuGolden(); });
+		checks->add("static-reuse", [this] { return checkStaticReuse(); });
+		std::string report;
+		int failures = checks->run(checkNames, report);
+		CI_LOG_I("checks: " << failures << " failed\n" << report);
+		quit();
+		return;
+	}
+	if (loadScaling) {
+		// receive path under 1 to 64 senders, then exit like a finished headless run
+		CI_LOG_I("load scaling\n" << VDLoadGenerator::scalingReport(loadFormat, { 1, 2, 4, 8, 16, 32, 64 }, 2.0));
+		quit();
+		return;
+	}
 
 	gl::enableDepthRead();
 	gl::enableDepthWrite();
 #ifdef _DEBUG
 	
 #else
+	if (mHeadless) return;
 	mRenderWindowTimer = 0.0f;
 	timeline().apply(&mRenderWindowTimer, 1.0f, 2.0f).finishFn([&] { positionRenderWindow(); });
 	positionRenderWindow();
@@ -113,35 +456,275 @@ void VDVisualizerApp::positionRenderWindow() {
 	setWindowSize(mVDSettings->mRenderWidth, mVDSettings->mRenderHeight);
 }
 // Render into the FBO
+bool VDVisualizerApp::waitForPostGraph(VDChecks::Result &result)
+{
+	Timer timer(true);
+	while (!mPostGraph->isReady() && timer.getSeconds() < 10.0) {
+		mShaders->update();
+		ci::sleep(5.0f);
+	}
+	if (!mPostGraph->isReady()) {
+		result.fail("post graph did not link within 10 s");
+		return false;
+	}
+	return true;
+}
+VDChecks::Result VDVisualizerApp::checkStaticReuse()
+{
+	VDChecks::Result result;
+	if (!mDefaultGraph) {
+		result.line("postgraph.xml loaded, its passes may depend on time");
+		return result;
+	}
+	if (!waitForPostGraph(result)) return result;
+	// a still source while iGlobalTime runs, as renderToFbo sets it
+	const int32_t width = 640, height = 360;
+	const int frames = 120;
+	Surface8u still(width, height, true);
+	for (int32_t y = 0; y < height; y++) {
+		uint8_t *row = still.getData(ivec2(0, y));
+		for (int32_t x = 0; x < width; x++) {
+			row[x * 4 + 0] = (uint8_t)(x * 255 / width);
+			row[x * 4 + 1] = (uint8_t)(y * 255 / height);
+			row[x * 4 + 2] = 128;
+			row[x * 4 + 3] = 255;
+		}
+	}
+	gl::Texture2dRef source = gl::Texture2d::create(still, gl::Texture2d::Format().loadTopDown());
+	gl::FboRef target = mRenderTargets->acquire("static", VDRenderTargets::Desc(ivec2(width, height)));
+	mUniforms->setVec3(mUniformResolution, vec3(width, height, 1.0f));
+	// a detector of its own, the app's one keeps the live source's state
+	VDChangeDetector::Format format;
+	VDChangeDetectorRef detector = VDChangeDetector::create(format);
+	uint64_t version = mPostGraph->getOutputVersion();
+	int redraws = 0;
+	for (int frame = 0; frame < frames; frame++) {
+		mUniforms->setFloat(mUniformTime, frame / 60.0f);
+		mPostGraph->setSource(source, detector->signature(source));
+		mPostGraph->render(target);
+		if (mPostGraph->getOutputVersion() != version) redraws++;
+		version = mPostGraph->getOutputVersion();
+	}
+	// the first two frames have no signature to go by, then one forced change per refresh
+	const int expected = 2 + frames / format.mRefresh;
+	char line[160];
+	std::snprintf(line, sizeof(line), "%d frames of a still source: output drawn %d times (expected at most %d)", frames, redraws, expected);
+	result.line(line);
+	if (redraws > expected) result.fail("a still source redraws the post graph");
+	return result;
+}
 void VDVisualizerApp::renderToFbo()
 {
-	if (mSpoutTexture) {
-		// this will restore the old framebuffer binding when we leave this function
-		// on non-OpenGL ES platforms, you can just call mFbo->unbindFramebuffer() at the end of the function
-		// but this will restore the "screen" FBO on OpenGL ES, and does the right thing on both platforms
-		gl::ScopedFramebuffer fbScp(mFbo);
-		// clear out the FBO with black
-		gl::clear(Color::black());
-
-		// setup the viewport to match the dimensions of the FBO
-		gl::ScopedViewport scpVp(ivec2(0), mFbo->getSize());
-
-		// render
-
-		// texture binding must be before ScopedGlslProg
-		mSpoutTexture->bind(0);
-
-		gl::ScopedGlslProg prog(mGlsl);
-
-		mGlsl->uniform("iGlobalTime", (float)getElapsedSeconds());
-		mGlsl->uniform("iResolution", vec3(mVDSettings->mRenderWidth, mVDSettings->mRenderHeight, 1.0));
-		mGlsl->uniform("iChannel0", 0); // texture 0
-		mGlsl->uniform("iExposure", 1.0f);
-		mGlsl->uniform("iSobel", 1.0f);
-		mGlsl->uniform("iChromatic", 1.0f);
-
-		gl::drawSolidRect(getWindowBounds());
+	if (mSourceTexture) {
+		// only the passes whose inputs or uniforms changed are drawn,
+		// mFbo keeps the last complete result while an edited pass compiles
+		mUniforms->setFloat(mUniformTime, (float)getElapsedSeconds());
+		mPostGraph->render(mFbo);
+	}
+}
+void VDVisualizerApp::receiveStamp()
+{
+	VDFrameStamp stamp;
+	if (!mLatency || !mSource->getStamp(stamp)) return;
+	// a sender slower than the render loop repeats frames, each is counted once
+	if (mStampReceived.isValid() && stamp.sequence == mStampReceived.sequence) return;
+	stamp.receiveNs = VDFrameStamp::now();
+	mProfiler->addCpuSample(mStageLatencySend, (stamp.receiveNs - stamp.sendNs) / 1.0e6);
+	mStampReceived = stamp;
+}
+VDFrameHandle VDVisualizerApp::receivePixels()
+{
+	VDFrameHandle input;
+	{
+		VDProfiler::ScopedTimer timer(mProfiler.get(), mStageReceive);
+		input = mSource->receivePixels(*mInputPool);
+	}
+	receiveStamp();
+	if (!input) return input;
+	if (mChangeDetector) {
+		VDProfiler::ScopedTimer timer(mProfiler.get(), mStageDetect);
+		// the effects read nothing but the input and these three
+		const uint64_t key[] = { 2, mChangeDetector->signature(input), mUniforms->getVersion(mUniformExposure), mUniforms->getVersion(mUniformSobel), mUniforms->getVersion(mUniformChromatic) };
+		uint64_t outputKey = VDChangeDetector::hashBytes(key, sizeof(key), 0);
+		if (mLastFrame && outputKey == mOutputKey) {
+			mRepeated = true;
+			return mLastFrame;
+		}
+		mOutputKey = outputKey;
+	}
+	VDProfiler::ScopedTimer timer(mProfiler.get(), mStageCpuPost);
+	if (!mEffectWorkers) mEffectWorkers = VDWorkerPool::create("effects");
+	// straight into an output buffer, the outputs send it as is
+	VDFrameHandle output = mFramePool->acquire(input->getWidth(), input->getHeight());
+	VDCpuEffects::Params params(mUniforms->getFloat(mUniformExposure), mUniforms->getFloat(mUniformSobel), mUniforms->getFloat(mUniformChromatic));
+	VDCpuEffects::process(*input, *output, params, mEffectWorkers.get());
+	if (!mHeadless) {
+		// the result for the screen, the original only for the preview
+		auto upload = [](gl::Texture2dRef &texture, VDFrameBuffer &buffer) {
+			if (texture && texture->getSize() == ivec2(buffer.getWidth(), buffer.getHeight())) texture->update(buffer.getSurface());
+			else texture = gl::Texture2d::create(buffer.getSurface(), gl::Texture2d::Format().loadTopDown());
+		};
+		upload(mCpuPostTexture, *output);
+		if (mVDSettings->mCursorVisible) {
+			upload(mInputTexture, *input);
+			mSourceTexture = mInputTexture;
+		}
+	}
+	return output;
+}
+void VDVisualizerApp::startRecording(const fs::path &path)
+{
+	stopRecording();
+	VDRecordingSink::Format format = VDRecordingSink::Format().name(mSource->getName());
+	if (mRecordCompressed) {
+		// tiles are encoded in parallel, from the recorder's worker thread
+		if (!mRecordWorkers) mRecordWorkers = VDWorkerPool::create("record");
+		format.compress(true).workers(mRecordWorkers);
+	}
+	mRecordingSink = VDRecordingSink::create(path, format);
+	if (!mRecordingSink->isOpen()) {
+		mRecordingSink.reset();
+		return;
+	}
+	// a few frames of slack for disk hiccups, then the newest frames are dropped
+	mRecorder = VDNDIOutput::create(mRecordingSink, VDNDIOutput::Format().queueSize(8).dropPolicy(VDDropPolicy::DropNewest));
+}
+void VDVisualizerApp::stopRecording()
+{
+	if (!mRecorder) return;
+	mRecorder->stop();
+	mRecordingSink->close();
+	CI_LOG_I("recording " << mRecordingSink->getPath() << ": written " << mRecordingSink->getFramesWritten() << " dropped " << mRecorder->getDroppedCount() << " ratio " << mRecordingSink->getCompressionRatio());
+	mRecorder.reset();
+	mRecordingSink.reset();
+}
+void VDVisualizerApp::setPreviewSource(int index, const gl::Texture2dRef &texture, uint64_t version)
+{
+	// the copy and mip chain only for a frame the preview has not shown yet
+	if (version && texture == mPreviewTextures[index] && version == mPreviewVersions[index]) return;
+	mPreview->setSource(index, texture);
+	mPreviewTextures[index] = texture;
+	mPreviewVersions[index] = version;
+}
+std::string VDVisualizerApp::lumaSummary() const
+{
+	char summary[160];
+	std::snprintf(summary, sizeof(summary), "luma mean %.0f min %d max %d p5 %d p50 %d p95 %d exposure %.2f%s", mLumaStats.mean, mLumaStats.min, mLumaStats.max,
+		mLumaStats.percentile(0.05f), mLumaStats.percentile(0.5f), mLumaStats.percentile(0.95f), mUniforms->getFloat(mUniformExposure), mExposureController ? " auto" : "");
+	return summary;
+}
+VDChecks::Result VDVisualizerApp::checkTextOverlay()
+{
+	VDChecks::Result result;
+	// the HUD labels over a cleared target: none, the glyph atlases, and gl::drawString per
+	// label as before them; each frame waits on glFinish so the GPU side counts too
+	gl::FboRef target = gl::Fbo::create(mVDSettings->mRenderWidth, mVDSettings->mRenderHeight);
+	const Font small("Verdana", toPixels(16.0f)), large("Verdana", toPixels(24.0f));
+	const int frames = 300;
+	auto run = [&](int mode) {
+		gl::ScopedFramebuffer scpFb(target);
+		gl::ScopedViewport scpVp(ivec2(0), target->getSize());
+		gl::ScopedMatrices scpMat;
+		gl::setMatricesWindow(target->getSize());
+		Timer timer(true);
+		for (int frame = 0; frame < frames; frame++) {
+			gl::clear(Color::black());
+			mHud->beginFrame();
+			for (int i = 0; i < HUD_COUNT; i++) {
+				// the fps label changes every frame, the others once a second
+				std::string text = "label " + toString(i) + ": " + toString(i == HUD_FPS ? frame : frame / 60);
+				vec2 pos(toPixels(20.0f), toPixels(20.0f + 30.0f * i));
+				if (mode == 1) mHud->setText(mHudLabels[i], text, pos);
+				else if (mode == 2) gl::drawString(text, pos, ColorA::white(), i <= HUD_SHADER ? small : large);
+			}
+			if (mode == 1) mHud->draw();
+			glFinish();
+		}
+		return timer.getSeconds() * 1000.0 / frames;
+	};
+	double off = run(0), overlay = run(1), drawString = run(2);
+	mHud->beginFrame();
+	char line[160];
+	std::snprintf(line, sizeof(line), "%d labels, %d frames: hud off %.3f ms, glyph atlas %.3f ms (+%.3f), drawString %.3f ms (+%.3f)",
+		(int)HUD_COUNT, frames, off, overlay, overlay - off, drawString, drawString - off);
+	result.line(line);
+	if (overlay - off > drawString - off) result.fail("the glyph atlas HUD costs more than drawString");
+	return result;
+}
+VDChecks::Result VDVisualizerApp::checkCpuGolden()
+{
+	VDChecks::Result result;
+	if (!mDefaultGraph) {
+		result.line("postgraph.xml loaded, the cpu path is not used");
+		return result;
+	}
+	if (!waitForPostGraph(result)) return result;
+	// a gradient with hard edged bars, so the sobel and the channel shift have edges to work on
+	const int32_t width = 640, height = 360;
+	VDFrameHandle input = mFramePool->acquire(width, height);
+	for (int32_t y = 0; y < height; y++) {
+		uint8_t *row = input->getData() + y * input->getRowBytes();
+		for (int32_t x = 0; x < width; x++) {
+			bool bar = (x / 40 + y / 60) % 3 == 0;
+			row[x * 4 + 0] = (uint8_t)(bar ? 240 : x * 255 / width);
+			row[x * 4 + 1] = (uint8_t)(bar ? 32 : y * 255 / height);
+			row[x * 4 + 2] = (uint8_t)(bar ? 96 : (x + y) * 255 / (width + height));
+			row[x * 4 + 3] = 255;
+		}
 	}
+	gl::Texture2dRef source = gl::Texture2d::create(input->getSurface(), gl::Texture2d::Format().loadTopDown());
+	gl::FboRef target = mRenderTargets->acquire("golden", VDRenderTargets::Desc(ivec2(width, height)));
+	VDFrameHandle cpu = mFramePool->acquire(width, height);
+	const VDCpuEffects::Params params[] = {
+		VDCpuEffects::Params(1.0f, 0.0f, 0.0f),
+		VDCpuEffects::Params(1.5f, 0.0f, 0.0f),
+		VDCpuEffects::Params(1.0f, 1.0f, 0.0f),
+		VDCpuEffects::Params(1.0f, 0.0f, 1.0f),
+		VDCpuEffects::Params(1.2f, 0.5f, 0.5f)
+	};
+	for (const auto &param : params) {
+		mUniforms->setFloat(mUniformExposure, param.exposure);
+		mUniforms->setFloat(mUniformSobel, param.sobel);
+		mUniforms->setFloat(mUniformChromatic, param.chromatic);
+		mUniforms->setVec3(mUniformResolution, vec3(width, height, 1.0f));
+		mPostGraph->setSource(source);
+		mPostGraph->render(target);
+		VDFrameHandle gpu = mReadback->read(target->getColorTexture());
+		VDCpuEffects::process(*input, *cpu, param);
+		// per channel: mean difference, and the share off by more than a rounding step
+		uint64_t sum = 0, off = 0;
+		int maxDiff = 0;
+		for (int32_t y = 0; y < height; y++) {
+			const uint8_t *a = gpu->getData() + y * gpu->getRowBytes();
+			const uint8_t *b = cpu->getData() + y * cpu->getRowBytes();
+			for (int32_t i = 0; i < width * 4; i++) {
+				if ((i & 3) == 3) continue;
+				int diff = std::abs((int)a[i] - (int)b[i]);
+				sum += diff;
+				if (diff > 8) off++;
+				maxDiff = std::max(maxDiff, diff);
+			}
+		}
+		const double values = (double)width * height * 3;
+		char line[160];
+		std::snprintf(line, sizeof(line), "exposure %.2f sobel %.2f chromatic %.2f: mean diff %.3f, max %d, %.3f%% off by more than 8",
+			param.exposure, param.sobel, param.chromatic, sum / values, maxDiff, 100.0 * off / values);
+		result.line(line);
+		if (sum / values > 1.0 || off / values > 0.005) result.fail("cpu and gpu output differ");
+	}
+	return result;
+}
+void VDVisualizerApp::dumpProfile()
+{
+	fs::path path = getAppPath() / ("profile-" + toString(getElapsedFrames()) + ".txt");
+	std::ofstream file(path.string());
+	file << mProfiler->report();
+	CI_LOG_I("profile written to " << path << "\n" << mProfiler->report());
+}
+void VDVisualizerApp::dumpTrace()
+{
+	// chrome://tracing or ui.perfetto.dev
+	VDTracer::write(getAppPath() / ("trace-" + toString(getElapsedFrames()) + ".json"), 10.0);
 }
 void VDVisualizerApp::toggleCursorVisibility(bool visible)
 {
@@ -160,21 +743,62 @@ void VDVisualizerApp::fileDrop(FileDropEvent event)
 }
 void VDVisualizerApp::update()
 {
+	// receive, shader and readback start just in time for the next output deadline
+	if (mPacer) mPacer->waitForSlot();
+	mShaders->update();
+	VDTracer::instant("frame");
+	// gpu timings of earlier frames, whatever the driver has finished
+	mProfiler->collect();
+	if (mBenchmark) {
+		// measure from the first frame the whole chain is linked
+		if (!mBenchmark->isRunning() && (mCpuPost || mPostGraph->isReady())) mBenchmark->start();
+		if (!mBenchmark->isRunning()) {
+			std::string error = mPostGraph->getError();
+			if (error.empty() && mBenchmarkStartTimer.getSeconds() > BENCHMARK_START_TIMEOUT) error = "post graph did not link within " + toString((int)BENCHMARK_START_TIMEOUT) + " s";
+			if (!error.empty()) {
+				failHeadless(error);
+				return;
+			}
+		}
+		mBenchmark->beginFrame();
+		// timings cover the measured frames only
+		if (mBenchmark->isMeasuring() && mBenchmark->getMeasuredFrames() == 0) mProfiler->reset();
+	}
 	if (mFadeInDelay == false) {
-		mVDSession->setFloatUniformValueByIndex(mVDSettings->IFPS, getAverageFps());
-		mVDSession->update();
-		// render into our FBO
-		if (mUseShader) {
+		{
+			VDProfiler::ScopedTimer timer(mProfiler.get(), mStageUpdate);
+			mVDSession->setFloatUniformValueByIndex(mVDSettings->IFPS, getAverageFps());
+			mVDSession->update();
+			mUniforms->pull(mVDSession);
+		}
+		// render into our FBO, reallocated when the render size changes
+		mFbo = mRenderTargets->acquire("output", VDRenderTargets::Desc(ivec2(mVDSettings->mRenderWidth, mVDSettings->mRenderHeight)));
+		mUniforms->setVec3(mUniformResolution, vec3(mFbo->getSize(), 1.0f));
+		if (mUseShader && !mCpuPost) {
+			VDProfiler::ScopedTimer timer(mProfiler.get(), mStageShader, true);
 			renderToFbo();
+			mStampShaded = mStampReceived;
 		}
 	}
 }
+void VDVisualizerApp::failHeadless(const std::string &reason)
+{
+	CI_LOG_E("headless " << mSource->getName() << " failed: " << reason);
+	cleanup();
+	// quit() alone would exit with 0, scripts running the benchmark check the exit code
+	std::exit(EXIT_FAILURE);
+}
 void VDVisualizerApp::cleanup()
 {
 	if (!mIsShutDown)
 	{
 		mIsShutDown = true;
 		CI_LOG_V("shutdown");
+		for (auto &output : mNDIOutputs) {
+			output->stop();
+		}
+		stopRecording();
+		if (mLoadGenerator) mLoadGenerator->stop();
 		// save settings
 		mVDSettings->save();
 		mVDSession->save();
@@ -194,7 +818,7 @@ void VDVisualizerApp::mouseDown(MouseEvent event)
 		if (event.isRightDown()) { 
 			// Select a sender
 			// SpoutPanel.exe must be in the executable path
-			mSpoutIn.getSpoutReceiver().SelectSenderPanel(); // DirectX 11 by default
+			mSource->select(); // DirectX 11 by default
 		}
 	}
 }
@@ -231,8 +855,49 @@ void VDVisualizerApp::keyDown(KeyEvent event)
 		case KeyEvent::KEY_s:
 			mUseShader = !mUseShader;
 			break;
+		case KeyEvent::KEY_p:
+			// stage timings in the hud, shift writes them to a file
+			if (isShiftDown) {
+				dumpProfile();
+			}
+			else {
+				mShowProfile = !mShowProfile;
+			}
+			break;
+		case KeyEvent::KEY_t:
+			// record the pipeline, shift writes the last 10 seconds as a chrome trace
+			if (isShiftDown) {
+				dumpTrace();
+			}
+			else {
+				VDTracer::setEnabled(!VDTracer::isEnabled());
+				CI_LOG_I("tracing " << (VDTracer::isEnabled() ? "on" : "off"));
+			}
+			break;
 
 
+		case KeyEvent::KEY_r:
+			// record the output frames until pressed again
+			if (mRecorder) {
+				stopRecording();
+			}
+			else {
+				startRecording(getAppPath() / ("recording-" + toString(getElapsedFrames()) + ".vdraw"));
+			}
+			break;
+		case KeyEvent::KEY_e:
+			// auto exposure, iExposure stays where it is when turned off
+			if (mExposureController) mExposureController.reset();
+			else mExposureController = VDExposureController::create();
+			break;
+		case KeyEvent::KEY_o:
+			// sobel outline, off by default
+			mUniforms->setFloat(mUniformSobel, mUniforms->getFloat(mUniformSobel) > 0.0f ? 0.0f : 1.0f);
+			break;
+		case KeyEvent::KEY_a:
+			// chromatic aberration, off by default
+			mUniforms->setFloat(mUniformChromatic, mUniforms->getFloat(mUniformChromatic) > 0.0f ? 0.0f : 1.0f);
+			break;
 		case KeyEvent::KEY_c:
 			// mouse cursor and ui visibility
 			mVDSettings->mCursorVisible = !mVDSettings->mCursorVisible;
@@ -272,70 +937,198 @@ void VDVisualizerApp::draw()
 	}
 	Rectf rectangle = Rectf(xLeft, yLeft, xRight, yRight);
 	gl::setMatricesWindow(toPixels(getWindowSize()));
-	mSpoutTexture = mSpoutIn.receiveTexture();
-	if (mSpoutTexture) {
+	mHud->beginFrame();
+	// ready for the outputs when the effects ran on the cpu
+	VDFrameHandle frame;
+	mRepeated = false;
+	mCpuPost = mUseShader && mDefaultGraph && mSource->hasPixels();
+	if (mCpuPost) {
+		frame = receivePixels();
+	}
+	else {
+		VDProfiler::ScopedTimer timer(mProfiler.get(), mStageReceive);
+		mSourceTexture = mSource->receive();
+		receiveStamp();
+	}
+	if (!mCpuPost && mSourceTexture && mChangeDetector) {
+		VDProfiler::ScopedTimer timer(mProfiler.get(), mStageDetect, true);
+		mSourceSignature = mChangeDetector->signature(mSourceTexture);
+	}
+	gl::Texture2dRef shaded = mCpuPost ? mCpuPostTexture : mFbo->getColorTexture();
+	if (mCpuPost ? (bool)frame : (bool)mSourceTexture) {
+		if (!mCpuPost) mPostGraph->setSource(mSourceTexture, mSourceSignature);
 		// Otherwise draw the texture and fill the screen
-		if (mVDSettings->mCursorVisible) {
-			// original
-			gl::draw(mSpoutTexture, Rectf(0, 0, tWidth, tHeight));
-			gl::drawString("Original", vec2(toPixels(0), toPixels(tHeight)), Color(1, 1, 1), Font("Verdana", toPixels(16)));
-			// flipH
-			gl::draw(mSpoutTexture, Rectf(tWidth * 2 + margin, 0, tWidth + margin, tHeight));
-			gl::drawString("FlipH", vec2(toPixels(tWidth + margin), toPixels(tHeight)), Color(1, 1, 1), Font("Verdana", toPixels(16)));
-			// flipV
-			gl::draw(mSpoutTexture, Rectf(0, tHeight * 2 + margin, tWidth, tHeight + margin));
-			gl::drawString("FlipV", vec2(toPixels(0), toPixels(tHeight * 2  + margin)), Color(1, 1, 1), Font("Verdana", toPixels(16)));
-
+		if (mHeadless) {
+			// nothing on screen, the window is hidden
+		}
+		else if (mVDSettings->mCursorVisible) {
+			// original, flipH, flipV and the FBO color texture in one draw
+			{
+				VDProfiler::ScopedTimer timer(mProfiler.get(), mStagePreview, true);
+				// the cpu path uploads both textures only for a new output key
+				setPreviewSource(0, mSourceTexture, mCpuPost ? mOutputKey : mSourceSignature);
+				setPreviewSource(1, mUseShader ? shaded : nullptr, mCpuPost ? mOutputKey : mPostGraph->getOutputVersion());
+				mPreview->draw();
+			}
+			mHud->setText(mHudLabels[HUD_ORIGINAL], "Original", vec2(toPixels(0), toPixels(tHeight)));
+			mHud->setText(mHudLabels[HUD_FLIPH], "FlipH", vec2(toPixels(tWidth + margin), toPixels(tHeight)));
+			mHud->setText(mHudLabels[HUD_FLIPV], "FlipV", vec2(toPixels(0), toPixels(tHeight * 2  + margin)));
 			if (mUseShader) {
-				// show the FBO color texture 
-				gl::draw(mFbo->getColorTexture(), Rectf(tWidth + margin, tHeight + margin, tWidth * 2 + margin, tHeight * 2 + margin));
-				gl::drawString("Shader", vec2(toPixels(tWidth + margin), toPixels(tHeight * 2 + margin)), Color(1, 1, 1), Font("Verdana", toPixels(16)));
-			
+				mHud->setText(mHudLabels[HUD_SHADER], "Shader", vec2(toPixels(tWidth + margin), toPixels(tHeight * 2 + margin)));
 			}
 			// Show the user what it is receiving
-			gl::ScopedBlendAlpha alpha;
-			gl::enableAlphaBlending();
-			gl::drawString("Receiving from: " + mSpoutIn.getSenderName(), vec2(toPixels(20), getWindowHeight() - toPixels(30)), Color(1, 1, 1), Font("Verdana", toPixels(24)));
-			gl::drawString("fps: " + std::to_string((int)getAverageFps()), vec2(getWindowWidth() - toPixels(100), getWindowHeight() - toPixels(30)), Color(1, 1, 1), Font("Verdana", toPixels(24)));
-			gl::drawString("RH click to select a sender", vec2(toPixels(20), getWindowHeight() - toPixels(60)), Color(1, 1, 1), Font("Verdana", toPixels(24)));
+			mHud->setText(mHudLabels[HUD_SENDER], "Receiving from: " + mSource->getName(), vec2(toPixels(20), getWindowHeight() - toPixels(30)));
+			mHud->setText(mHudLabels[HUD_FPS], "fps: " + std::to_string((int)getAverageFps()), vec2(getWindowWidth() - toPixels(100), getWindowHeight() - toPixels(30)));
+			mHud->setText(mHudLabels[HUD_HELP], "RH click to select a sender", vec2(toPixels(20), getWindowHeight() - toPixels(60)));
+			if (mPacer) {
+				char pacing[128];
+				std::snprintf(pacing, sizeof(pacing), "pacing %.0f fps jitter: %.1f ms late: %.1f ms skipped: %llu", mPacer->getRate(), mPacer->getJitterMs(), mPacer->getMaxLatenessMs(), (unsigned long long)mPacer->getSkippedCount());
+				mHud->setText(mHudLabels[HUD_PACING], pacing, vec2(toPixels(20), getWindowHeight() - toPixels(120)));
+			}
+			if (mShowProfile) {
+				// p50/p95/p99 per stage, top right
+				for (size_t i = 0; i < mHudProfileLabels.size(); i++) {
+					mHud->setText(mHudProfileLabels[i], mProfiler->getSummary((int)i), vec2(getWindowWidth() - toPixels(420), toPixels(20 + 20 * i)));
+				}
+			}
+			if (mRecorder) {
+				char recording[160];
+				std::snprintf(recording, sizeof(recording), "recording: %llu frames dropped: %llu %.0f MB/s ratio %.2f", (unsigned long long)mRecordingSink->getFramesWritten(), (unsigned long long)mRecorder->getDroppedCount(), mRecordingSink->getThroughputMBps(), mRecordingSink->getCompressionRatio());
+				mHud->setText(mHudLabels[HUD_RECORD], recording, vec2(toPixels(20), getWindowHeight() - toPixels(150)));
+			}
+			if (mChangeDetector) {
+				char repeated[160];
+				std::snprintf(repeated, sizeof(repeated), "static: %.0f%% of frames reused, passes skipped: %llu", 100.0 * mRepeatedFrames / std::max<uint64_t>(mOutputFrames, 1), (unsigned long long)mPostGraph->getSkippedCount());
+				mHud->setText(mHudLabels[HUD_STATIC], repeated, vec2(toPixels(20), getWindowHeight() - toPixels(180)));
+			}
+			mHud->setText(mHudLabels[HUD_LUMA], lumaSummary(), vec2(toPixels(20), getWindowHeight() - toPixels(210)));
+			mHud->setText(mHudLabels[HUD_NDI], "ndi sent: " + toString(mNDIOutputs[0]->getSentCount()) + " dropped: " + toString(mNDIOutputs[0]->getDroppedCount()) + " " + VDOutputController::getLevelName(mNDIOutputs[0]->getController()->getLevel()) + " proxies: " + toString(mNDIOutputs.size() - 1) + " buffers: " + toString(mFramePool->getStats().allocations), vec2(toPixels(20), getWindowHeight() - toPixels(90)));
 		}
 		else {
 			if (mUseShader) {
-				gl::draw(mFbo->getColorTexture(), rectangle);
+				gl::draw(shaded, rectangle);
 			}
 			else {
-				gl::draw(mSpoutTexture, rectangle);
+				gl::draw(mSourceTexture, rectangle);
 				
 			}
 		}
-		// NDI
-		if (mUseShader) {
-			mSurface = Surface::create(mFbo->getColorTexture()->createSource());
+		// shown and sent now: the shader's input from update(), or this draw's frame;
+		// measured when the draw calls are issued, the display's own delay comes on top
+		const VDFrameStamp &shown = mUseShader && !mCpuPost ? mStampShaded : mStampReceived;
+		int64_t receiveNs = 0;
+		if (mLatency && shown.isValid() && (int64_t)shown.sequence != mStampShownSequence) {
+			mStampShownSequence = shown.sequence;
+			receiveNs = shown.receiveNs;
+			mProfiler->addCpuSample(mStageLatencyDisplay, (VDFrameStamp::now() - receiveNs) / 1.0e6);
 		}
-		else {
-			mSurface = Surface::create(mSpoutTexture->createSource());
+		// NDI: readback into a pooled buffer here, encode and send on the output thread
+		if (!frame && mChangeDetector) {
+			// the graph bumps its output version only when the last pass drew again
+			const uint64_t key[] = { (uint64_t)mUseShader, mUseShader ? mPostGraph->getOutputVersion() : mSourceSignature };
+			uint64_t outputKey = mUseShader || mSourceSignature ? VDChangeDetector::hashBytes(key, sizeof(key), 0) : 0;
+			if (mLastFrame && outputKey && outputKey == mOutputKey) {
+				frame = mLastFrame;
+				mRepeated = true;
+			}
+			mOutputKey = outputKey;
+		}
+		if (!frame) {
+			VDProfiler::ScopedTimer timer(mProfiler.get(), mStageReadback, true);
+			frame = mReadback->read(mUseShader ? mFbo->getColorTexture() : mSourceTexture);
+		}
+		if (mChangeDetector) mLastFrame = frame;
+		mOutputFrames++;
+		if (mRepeated) mRepeatedFrames++;
+		// a repeated frame keeps its statistics
+		if (!mRepeated) {
+			VDProfiler::ScopedTimer timer(mProfiler.get(), mStageLuma);
+			VDLumaStats::compute(*frame, mLumaStats, 4, mLumaWorkers.get());
 		}
+		if (mExposureController && mUseShader) {
+			// the frame was shaded with the current value, the new one goes into the
+			// session and arrives with the next snapshot
+			float exposure = mUniforms->getFloat(mUniformExposure);
+			float next = mExposureController->update(mLumaStats, exposure, getElapsedSeconds() - mExposureTime);
+			if (next != exposure) mVDSession->setFloatUniformValueByIndex(mVDSettings->IEXPOSURE, next);
+		}
+		mExposureTime = getElapsedSeconds();
 		long long timecode = getElapsedFrames();
-		XmlTree msg{ "ci_meta", mVDSettings->sFps + " fps VDViz" };
-		mNDISender.sendMetadata(msg, timecode);
-		mNDISender.sendSurface(*mSurface, timecode);
+		mMetadata->setText(mVDSettings->sFps + " fps VDViz");
+		mMetadata->set(mMetaFps, mVDSettings->sFps);
+		mMetadata->set(mMetaSender, mSource->getName());
+		mMetadata->set(mMetaWidth, frame->getWidth());
+		mMetadata->set(mMetaHeight, frame->getHeight());
+		mMetadata->set(mMetaShader, mUseShader);
+		mMetadata->set(mMetaExposure, mUniforms->getFloat(mUniformExposure));
+		mMetadata->set(mMetaSobel, mUniforms->getFloat(mUniformSobel));
+		mMetadata->set(mMetaChromatic, mUniforms->getFloat(mUniformChromatic));
+		if (getElapsedSeconds() - mLumaPublishTime >= 0.5) {
+			// twice a second, every frame would rebuild and send the payload on live input
+			mLumaPublishTime = getElapsedSeconds();
+			mMetadata->set(mMetaLumaMean, (int)std::lround(mLumaStats.mean));
+			mMetadata->set(mMetaLumaMin, mLumaStats.min);
+			mMetadata->set(mMetaLumaMax, mLumaStats.max);
+			mMetadata->set(mMetaLumaP5, mLumaStats.percentile(0.05f));
+			mMetadata->set(mMetaLumaP50, mLumaStats.percentile(0.5f));
+			mMetadata->set(mMetaLumaP95, mLumaStats.percentile(0.95f));
+		}
+		// null unless something changed or the keep-alive is due
+		std::shared_ptr<XmlTree> metadata = mMetadata->poll(getElapsedSeconds());
+		VDProfiler::ScopedTimer timer(mProfiler.get(), mStagePush);
+		// a repeated frame only goes out as a keep-alive, or to carry changed metadata
+		if (!mRepeated || metadata || getElapsedSeconds() - mKeepAliveTime >= KEEP_ALIVE_SECONDS) {
+			mKeepAliveTime = getElapsedSeconds();
+			// receive to sent is measured on the program output only
+			for (size_t i = 0; i < mNDIOutputs.size(); i++) {
+				mNDIOutputs[i]->push(frame, timecode, metadata, i == 0 ? receiveNs : 0);
+			}
+		}
+		if (mRecorder) mRecorder->push(frame, timecode);
 	}
 	else {
 		if (mVDSettings->mCursorVisible) {
-			gl::ScopedBlendAlpha alpha;
-			gl::enableAlphaBlending();
-			gl::drawString("No sender/texture detected", vec2(toPixels(20), toPixels(20)), Color(1, 1, 1), Font("Verdana", toPixels(24)));
-			gl::drawString("yLeft: " + std::to_string(yLeft), vec2(getWindowWidth() - toPixels(100), getWindowHeight() - toPixels(30)), Color(1, 1, 1), Font("Verdana", toPixels(24)));
+			mHud->setText(mHudLabels[HUD_NOSENDER], "No sender/texture detected", vec2(toPixels(20), toPixels(20)));
+			mHud->setText(mHudLabels[HUD_YLEFT], "yLeft: " + std::to_string(yLeft), vec2(getWindowWidth() - toPixels(100), getWindowHeight() - toPixels(30)));
 
 		}
 	}
-	
+	// all visible labels, one batch per font size
+	{
+		VDProfiler::ScopedTimer timer(mProfiler.get(), mStageHud, true);
+		mHud->draw();
+	}
+
 	getWindow()->setTitle(mVDSettings->sFps + " fps VDViz");
+	if (mPacer) mPacer->frameDone();
+	if (mBenchmark) {
+		mBenchmark->endFrame();
+		if (mBenchmark->isDone()) {
+			CI_LOG_I("headless " << mSource->getName() << " " << mFbo->getWidth() << "x" << mFbo->getHeight() << "\n" << mBenchmark->report() << mProfiler->report());
+			if (mPacer) {
+				CI_LOG_I("pacing " << mPacer->getRate() << " fps jitter " << mPacer->getJitterMs() << " ms mean late " << mPacer->getMeanLatenessMs() << " ms skipped " << mPacer->getSkippedCount());
+			}
+			CI_LOG_I(lumaSummary());
+			if (mChangeDetector) {
+				CI_LOG_I("static: " << mRepeatedFrames << " of " << mOutputFrames << " frames reused (" << 100.0 * mRepeatedFrames / std::max<uint64_t>(mOutputFrames, 1) << "%), post passes skipped " << mPostGraph->getSkippedCount() << " rendered " << mPostGraph->getRenderedCount());
+			}
+			for (const auto &output : mNDIOutputs) {
+				CI_LOG_I(output->getSink()->getName() << ": sent " << output->getSentCount() << " dropped " << output->getDroppedCount() << " skipped " << output->getSkippedCount());
+			}
+			stopRecording();
+			if (VDTracer::isEnabled()) dumpTrace();
+			cleanup();
+		}
+	}
 }
 
 void prepareSettings(App::Settings *settings)
 {
 	settings->setWindowSize(800, 600);
+	for (const auto &arg : settings->getCommandLineArgs()) {
+		// no frame limiter: headless runs flat out, a paced loop keeps its own time
+		if (arg == "--headless" || arg.compare(0, 7, "--rate=") == 0) settings->disableFrameRate();
+	}
 	settings->setConsoleWindowEnabled();
 }
 
@@ -0,0 +1,97 @@
+#include "VDWorkerPool.h"
+
+#include "cinder/Log.h"
+
+#include <algorithm>
+
+using namespace videodromm;
+
+// one parallelFor call, lives on the caller's stack
+struct VDWorkerPool::Batch {
+	Batch(const std::function<void(size_t, size_t)> &fn, size_t pending) : fn(fn), pending(pending) {}
+	const std::function<void(size_t, size_t)>	&fn;
+	size_t										pending;
+	std::mutex									mutex;
+	std::condition_variable						done;
+};
+
+VDWorkerPool::VDWorkerPool(const std::string &name, size_t threadCount)
+	: mName(name)
+	, mRunning(true)
+{
+	if (threadCount == 0) {
+		size_t hardware = std::thread::hardware_concurrency();
+		threadCount = hardware > 1 ? hardware - 1 : 0;
+	}
+	for (size_t i = 0; i < threadCount; i++) {
+		mThreads.push_back(std::thread(&VDWorkerPool::run, this));
+	}
+	CI_LOG_V("VDWorkerPool " << mName << " threads: " << threadCount);
+}
+VDWorkerPool::~VDWorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mRunning = false;
+	}
+	mCondition.notify_all();
+	for (auto &thread : mThreads) {
+		thread.join();
+	}
+}
+void VDWorkerPool::execute(const Task &task)
+{
+	task.batch->fn(task.begin, task.end);
+	// decrement under the lock so the caller cannot return and free the batch in between
+	std::lock_guard<std::mutex> lock(task.batch->mutex);
+	if (--task.batch->pending == 0) {
+		task.batch->done.notify_all();
+	}
+}
+void VDWorkerPool::run()
+{
+	for (;;) {
+		Task task;
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mCondition.wait(lock, [this] { return !mRunning || !mTasks.empty(); });
+			if (!mRunning && mTasks.empty()) return;
+			task = mTasks.front();
+			mTasks.pop_front();
+		}
+		execute(task);
+	}
+}
+void VDWorkerPool::parallelFor(size_t count, const std::function<void(size_t begin, size_t end)> &fn)
+{
+	if (count == 0) return;
+	size_t chunks = std::min(count, getConcurrency());
+	if (chunks == 1) {
+		fn(0, count);
+		return;
+	}
+	size_t step = (count + chunks - 1) / chunks;
+	Batch batch(fn, (count + step - 1) / step);
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		// the first chunk stays with the caller
+		for (size_t begin = step; begin < count; begin += step) {
+			mTasks.push_back(Task{ &batch, begin, std::min(count, begin + step) });
+		}
+	}
+	mCondition.notify_all();
+	execute(Task{ &batch, 0, std::min(count, step) });
+	// help with whatever is still queued (ours or another caller's) before waiting
+	for (;;) {
+		Task task;
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			if (mTasks.empty()) break;
+			task = mTasks.front();
+			mTasks.pop_front();
+		}
+		execute(task);
+	}
+	std::unique_lock<std::mutex> lock(batch.mutex);
+	batch.done.wait(lock, [&batch] { return batch.pending == 0; });
+}